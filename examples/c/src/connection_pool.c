@@ -15,8 +15,7 @@ FocasResult init_connection_pool(ConnectionPool *pool) {
   memset(pool, 0, sizeof(ConnectionPool));
   pool->pool_created = time(NULL);
 
-  printf("🔧 Initialized connection pool for up to %d machines\n",
-         MAX_MACHINES);
+  printf("🔧 Initialized connection pool\n");
   return FOCAS_OK;
 }
 
@@ -25,12 +24,21 @@ FocasResult add_machine(ConnectionPool *pool, const char *ip, int port,
   if (!pool || !ip || !name)
     return FOCAS_CONNECTION_FAILED;
 
-  if (pool->machine_count >= MAX_MACHINES) {
-    printf("❌ Connection pool is full (max %d machines)\n", MAX_MACHINES);
-    return FOCAS_CONNECTION_FAILED;
+  if (pool->machine_count >= pool->machine_capacity) {
+    int capacity = pool->machine_capacity > 0 ? pool->machine_capacity * 2
+                                              : INITIAL_MACHINE_CAPACITY;
+    MachineHandle *machines =
+        realloc(pool->machines, capacity * sizeof(MachineHandle));
+    if (!machines) {
+      printf("❌ Out of memory adding machine '%s'\n", name);
+      return FOCAS_CONNECTION_FAILED;
+    }
+    pool->machines = machines;
+    pool->machine_capacity = capacity;
   }
 
   MachineHandle *machine = &pool->machines[pool->machine_count];
+  memset(machine, 0, sizeof(MachineHandle));
 
   // Initialize machine handle
   strncpy(machine->ip, ip, sizeof(machine->ip) - 1);
@@ -50,6 +58,23 @@ FocasResult add_machine(ConnectionPool *pool, const char *ip, int port,
   return FOCAS_OK;
 }
 
+// Release a machine's library handle, keeping its cached info
+static void release_handle(MachineHandle *machine) {
+  if (machine->handle != 0) {
+    cnc_freelibhndl(machine->handle);
+    machine->handle = 0;
+  }
+}
+
+// Seconds to wait before the next reconnect after retry_count failures
+static int reconnect_backoff(int retry_count) {
+  int backoff = 1;
+  for (int i = 0; i < retry_count && backoff < MAX_RECONNECT_BACKOFF; i++) {
+    backoff *= 2;
+  }
+  return backoff < MAX_RECONNECT_BACKOFF ? backoff : MAX_RECONNECT_BACKOFF;
+}
+
 FocasResult connect_machine(ConnectionPool *pool, int machine_id) {
   if (!pool || machine_id < 0 || machine_id >= pool->machine_count) {
     return FOCAS_CONNECTION_FAILED;
@@ -83,8 +108,10 @@ FocasResult connect_machine(ConnectionPool *pool, int machine_id) {
            machine->handle);
     return FOCAS_OK;
   } else {
+    machine->handle = 0;
     machine->state = CONN_ERROR;
     machine->retry_count++;
+    machine->next_retry = time(NULL) + reconnect_backoff(machine->retry_count);
     snprintf(machine->last_error, sizeof(machine->last_error),
              "Connection failed: FOCAS error %d", result);
 
@@ -102,11 +129,10 @@ FocasResult disconnect_machine(ConnectionPool *pool, int machine_id) {
   MachineHandle *machine = &pool->machines[machine_id];
 
   if (machine->state == CONN_CONNECTED && machine->handle != 0) {
-    cnc_freelibhndl(machine->handle);
     printf("🔌 Disconnected from %s\n", machine->friendly_name);
   }
 
-  machine->handle = 0;
+  release_handle(machine);
   machine->state = CONN_DISCONNECTED;
   machine->info_valid = 0;
   strcpy(machine->last_error, "Disconnected");
@@ -128,6 +154,16 @@ FocasResult disconnect_all_machines(ConnectionPool *pool) {
   return FOCAS_OK;
 }
 
+void free_connection_pool(ConnectionPool *pool) {
+  if (!pool)
+    return;
+
+  free(pool->machines);
+  pool->machines = NULL;
+  pool->machine_count = 0;
+  pool->machine_capacity = 0;
+}
+
 MachineHandle *get_machine_handle(ConnectionPool *pool, int machine_id) {
   if (!pool || machine_id < 0 || machine_id >= pool->machine_count) {
     return NULL;
@@ -144,9 +180,13 @@ FocasResult read_machine_by_id(ConnectionPool *pool, int machine_id,
 
   MachineHandle *machine = &pool->machines[machine_id];
 
-  // Check if we need to connect
+  // Check if we need to connect. A failed machine is not tried again before
+  // its backoff has passed; until then the read fails fast with last_error.
   if (machine->state != CONN_CONNECTED) {
-    FocasResult connect_result = connect_machine(pool, machine_id);
+    FocasResult connect_result = FOCAS_CONNECTION_FAILED;
+    if (time(NULL) >= machine->next_retry) {
+      connect_result = connect_machine(pool, machine_id);
+    }
     if (connect_result != FOCAS_OK) {
       // Return cached info if available
       if (machine->info_valid) {
@@ -157,15 +197,8 @@ FocasResult read_machine_by_id(ConnectionPool *pool, int machine_id,
     }
   }
 
-  // Create a temporary config for this machine
-  Config temp_config;
-  strncpy(temp_config.ip, machine->ip, sizeof(temp_config.ip));
-  temp_config.port = machine->port;
-  strncpy(temp_config.info_type, "all", sizeof(temp_config.info_type));
-  temp_config.verbose = 0;
-
-  // Read machine information using existing function
-  FocasResult result = read_complete_machine_info(&temp_config, info);
+  // Read machine information over the pool's persistent connection
+  FocasResult result = read_machine_info_from_handle(machine->handle, info);
 
   machine->last_activity = time(NULL);
 
@@ -179,7 +212,9 @@ FocasResult read_machine_by_id(ConnectionPool *pool, int machine_id,
 
     // Handle specific errors
     if (result == FOCAS_CONNECTION_FAILED) {
+      release_handle(machine);
       machine->state = CONN_ERROR;
+      machine->next_retry = time(NULL);
       strcpy(machine->last_error, "Lost connection during read");
     }
   }
@@ -187,6 +222,111 @@ FocasResult read_machine_by_id(ConnectionPool *pool, int machine_id,
   return result;
 }
 
+FocasResult check_connection_health(ConnectionPool *pool, int machine_id) {
+  if (!pool || machine_id < 0 || machine_id >= pool->machine_count) {
+    return FOCAS_CONNECTION_FAILED;
+  }
+
+  MachineHandle *machine = &pool->machines[machine_id];
+
+  if (machine->state != CONN_CONNECTED) {
+    return FOCAS_CONNECTION_FAILED;
+  }
+
+  // Status info is the cheapest request every control answers
+  ODBST status;
+  short result = cnc_statinfo(machine->handle, &status);
+  pool->health_checks++;
+
+  if (result == EW_OK) {
+    machine->last_activity = time(NULL);
+    return FOCAS_OK;
+  }
+
+  pool->failed_health_checks++;
+  release_handle(machine);
+  machine->state = CONN_ERROR;
+  machine->next_retry = time(NULL);
+  snprintf(machine->last_error, sizeof(machine->last_error),
+           "Health check failed: FOCAS error %d", result);
+
+  printf("💔 Lost connection to %s: %s\n", machine->friendly_name,
+         machine->last_error);
+  return FOCAS_CONNECTION_FAILED;
+}
+
+FocasResult reconnect_if_needed(ConnectionPool *pool, int machine_id) {
+  if (!pool || machine_id < 0 || machine_id >= pool->machine_count) {
+    return FOCAS_CONNECTION_FAILED;
+  }
+
+  MachineHandle *machine = &pool->machines[machine_id];
+
+  if (machine->state == CONN_CONNECTED) {
+    return FOCAS_OK;
+  }
+
+  // Only failed connections are re-established here, released ones connect
+  // again on their next read
+  if (machine->state != CONN_ERROR || time(NULL) < machine->next_retry) {
+    return FOCAS_CONNECTION_FAILED;
+  }
+
+  FocasResult result = connect_machine(pool, machine_id);
+  if (result == FOCAS_OK) {
+    pool->reconnections++;
+  }
+  return result;
+}
+
+void cleanup_stale_connections(ConnectionPool *pool, int max_idle_seconds) {
+  if (!pool)
+    return;
+
+  time_t now = time(NULL);
+
+  for (int i = 0; i < pool->machine_count; i++) {
+    MachineHandle *machine = &pool->machines[i];
+
+    if (machine->state != CONN_CONNECTED ||
+        difftime(now, machine->last_activity) < max_idle_seconds) {
+      continue;
+    }
+
+    release_handle(machine);
+    machine->state = CONN_DISCONNECTED;
+    snprintf(machine->last_error, sizeof(machine->last_error),
+             "Released after %d seconds idle", max_idle_seconds);
+
+    printf("💤 Released idle connection to %s\n", machine->friendly_name);
+  }
+}
+
+// Run between reads on the reading thread: release stale connections, probe
+// idle ones and re-establish failed ones, so a dead connection is found here
+// rather than by the next read
+void maintain_connections(ConnectionPool *pool, int max_idle_seconds) {
+  if (!pool)
+    return;
+
+  cleanup_stale_connections(pool, max_idle_seconds);
+
+  time_t now = time(NULL);
+
+  for (int i = 0; i < pool->machine_count; i++) {
+    MachineHandle *machine = &pool->machines[i];
+
+    if (machine->state == CONN_CONNECTED &&
+        difftime(now, machine->last_activity) >= HEALTH_CHECK_IDLE_SECONDS) {
+      check_connection_health(pool, i);
+    }
+
+    if (machine->state == CONN_ERROR) {
+      reconnect_if_needed(pool, i);
+    }
+  }
+}
+
 // Get current time in milliseconds
 double get_time_ms() {
   struct timeval tv;
@@ -194,6 +334,20 @@ double get_time_ms() {
   return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
 }
 
+void init_multi_machine_info(MultiMachineInfo *info) {
+  memset(info, 0, sizeof(MultiMachineInfo));
+}
+
+void free_multi_machine_info(MultiMachineInfo *info) {
+  if (!info)
+    return;
+
+  free(info->machines);
+  free(info->machine_names);
+  free(info->states);
+  memset(info, 0, sizeof(MultiMachineInfo));
+}
+
 FocasResult read_all_machines_info(ConnectionPool *pool,
                                    MultiMachineInfo *info) {
   if (!pool || !info)
@@ -201,10 +355,29 @@ FocasResult read_all_machines_info(ConnectionPool *pool,
 
   double start_time = get_time_ms();
 
-  // Initialize multi-machine info
-  memset(info, 0, sizeof(MultiMachineInfo));
+  // Size the per-machine arrays to the pool, reusing them across calls
+  if (info->capacity < pool->machine_count) {
+    MachineInfo *machines =
+        realloc(info->machines, pool->machine_count * sizeof(MachineInfo));
+    if (machines)
+      info->machines = machines;
+    char(*names)[50] = realloc(info->machine_names,
+                               pool->machine_count * sizeof(*names));
+    if (names)
+      info->machine_names = names;
+    ConnectionState *states =
+        realloc(info->states, pool->machine_count * sizeof(ConnectionState));
+    if (states)
+      info->states = states;
+    if (!machines || !names || !states)
+      return FOCAS_CONNECTION_FAILED;
+    info->capacity = pool->machine_count;
+  }
+
   info->machine_count = pool->machine_count;
   info->collection_time = time(NULL);
+  info->successful_reads = 0;
+  info->failed_reads = 0;
 
   printf("📊 Reading information from %d machines...\n", pool->machine_count);
 
@@ -219,6 +392,7 @@ FocasResult read_all_machines_info(ConnectionPool *pool,
     // Copy machine metadata
     strncpy(info->machine_names[i], machine->friendly_name,
             sizeof(info->machine_names[i]) - 1);
+    info->machine_names[i][sizeof(info->machine_names[i]) - 1] = '\0';
     info->states[i] = machine->state;
 
     if (result == FOCAS_OK) {
@@ -270,6 +444,9 @@ void print_connection_pool_status(const ConnectionPool *pool) {
   printf("Total connections made: %d\n", pool->total_connections);
   printf("Successful operations: %d\n", pool->successful_operations);
   printf("Failed operations: %d\n", pool->failed_operations);
+  printf("Health checks: %d (%d failed)\n", pool->health_checks,
+         pool->failed_health_checks);
+  printf("Reconnections: %d\n", pool->reconnections);
 
   if (pool->machine_count > 0) {
     printf("\nMachine Details:\n");
@@ -372,7 +549,7 @@ FocasResult load_machine_list_from_config(const char *config_file,
 
   printf("📄 Loading machine list from %s...\n", config_file);
 
-  while (fgets(line, sizeof(line), file) && machines_loaded < MAX_MACHINES) {
+  while (fgets(line, sizeof(line), file)) {
     // Skip comments and empty lines
     if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
       continue;
@@ -5,12 +5,21 @@
 #include "machine_info.h"
 #include <time.h>
 
-// Maximum number of machines per connection pool
-#define MAX_MACHINES 10
+// Initial number of machine slots, the pool grows on demand
+#define INITIAL_MACHINE_CAPACITY 8
 
 // Connection timeout in seconds
 #define CONNECTION_TIMEOUT 10
 
+// Probe connections idle this long before they are next read
+#define HEALTH_CHECK_IDLE_SECONDS 30
+
+// Release connections idle this long
+#define STALE_CONNECTION_SECONDS 300
+
+// Longest wait between reconnect attempts to a failed machine
+#define MAX_RECONNECT_BACKOFF 60
+
 // Connection states
 typedef enum {
   CONN_DISCONNECTED = 0,
@@ -30,6 +39,7 @@ typedef struct {
   time_t connect_time;
   time_t last_activity;
   int retry_count;
+  time_t next_retry; // Earliest reconnect attempt after a failure
   char last_error[100];
   MachineInfo last_info; // Cache last successful read
   int info_valid;        // Whether cached info is valid
@@ -37,20 +47,26 @@ typedef struct {
 
 // Connection pool for multiple machines
 typedef struct {
-  MachineHandle machines[MAX_MACHINES];
+  MachineHandle *machines; // Grown by add_machine, may move when it grows
   int machine_count;
+  int machine_capacity;
   time_t pool_created;
   int total_connections;
   int successful_operations;
   int failed_operations;
+  int health_checks;
+  int failed_health_checks;
+  int reconnections;
 } ConnectionPool;
 
-// Multi-machine information structure
+// Multi-machine information structure (arrays sized by read_all_machines_info,
+// release with free_multi_machine_info)
 typedef struct {
   int machine_count;
-  MachineInfo machines[MAX_MACHINES];
-  char machine_names[MAX_MACHINES][50];
-  ConnectionState states[MAX_MACHINES];
+  int capacity;
+  MachineInfo *machines;
+  char (*machine_names)[50];
+  ConnectionState *states;
   time_t collection_time;
   int successful_reads;
   int failed_reads;
@@ -64,6 +80,7 @@ FocasResult add_machine(ConnectionPool *pool, const char *ip, int port,
 FocasResult connect_machine(ConnectionPool *pool, int machine_id);
 FocasResult disconnect_machine(ConnectionPool *pool, int machine_id);
 FocasResult disconnect_all_machines(ConnectionPool *pool);
+void free_connection_pool(ConnectionPool *pool);
 MachineHandle *get_machine_handle(ConnectionPool *pool, int machine_id);
 
 // Multi-machine operations
@@ -71,11 +88,18 @@ FocasResult read_all_machines_info(ConnectionPool *pool,
                                    MultiMachineInfo *info);
 FocasResult read_machine_by_id(ConnectionPool *pool, int machine_id,
                                MachineInfo *info);
+void init_multi_machine_info(MultiMachineInfo *info);
+void free_multi_machine_info(MultiMachineInfo *info);
 
 // Connection health and maintenance
 FocasResult check_connection_health(ConnectionPool *pool, int machine_id);
 FocasResult reconnect_if_needed(ConnectionPool *pool, int machine_id);
 void cleanup_stale_connections(ConnectionPool *pool, int max_idle_seconds);
+// Synchronous: call it from the thread that reads the machines, between
+// reads. FOCAS handles belong to the thread that allocated them, so the
+// checks cannot run on a background timer; each costs up to one round trip
+// per idle machine on the calling thread.
+void maintain_connections(ConnectionPool *pool, int max_idle_seconds);
 
 // Display and utility functions
 void print_connection_pool_status(const ConnectionPool *pool);
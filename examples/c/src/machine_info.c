@@ -7,19 +7,15 @@
 // Include the official FANUC header - should work with MinGW cross-compilation
 #include "fwlib32.h"
 
-FocasResult read_current_program(Config *conf, char *program_name,
+// All readers work on an already open library handle, so a caller holding a
+// persistent connection (like the connection pool) never reconnects per field
+
+FocasResult read_current_program(unsigned short libh, char *program_name,
                                  int *program_number) {
-  unsigned short libh;
   ODBPRO prgnum;
 
-  // Connect to CNC
-  if (cnc_allclibhndl3(conf->ip, conf->port, 10, &libh) != EW_OK) {
-    return FOCAS_CONNECTION_FAILED;
-  }
-
   // Read current program number
   if (cnc_rdprgnum(libh, &prgnum) != EW_OK) {
-    cnc_freelibhndl(libh);
     return FOCAS_PROGRAM_READ_FAILED;
   }
 
@@ -27,22 +23,14 @@ FocasResult read_current_program(Config *conf, char *program_name,
   snprintf(program_name, 16, "O%04d", prgnum.data);
   *program_number = (int)prgnum.data;
 
-  cnc_freelibhndl(libh);
   return FOCAS_OK;
 }
 
-FocasResult read_machine_status(Config *conf, char *status_info) {
-  unsigned short libh;
+FocasResult read_machine_status(unsigned short libh, char *status_info) {
   ODBST status;
 
-  // Connect to CNC
-  if (cnc_allclibhndl3(conf->ip, conf->port, 10, &libh) != EW_OK) {
-    return FOCAS_CONNECTION_FAILED;
-  }
-
   // Read machine status
   if (cnc_statinfo(libh, &status) != EW_OK) {
-    cnc_freelibhndl(libh);
     return FOCAS_STATUS_READ_FAILED;
   }
 
@@ -61,31 +49,23 @@ FocasResult read_machine_status(Config *conf, char *status_info) {
     strcpy(status_info, "ALARM");
     break;
   default:
-    snprintf(status_info, 16, "UNKNOWN(%d)", status.run);
+    snprintf(status_info, STATUS_SIZE, "UNKNOWN(%d)", status.run);
     break;
   }
 
   // Add motion status if available
   if (status.motion == 1) {
-    strcat(status_info, " (MOVING)");
+    strncat(status_info, " (MOVING)", STATUS_SIZE - strlen(status_info) - 1);
   }
 
-  cnc_freelibhndl(libh);
   return FOCAS_OK;
 }
 
-FocasResult read_machine_id(Config *conf, char *machine_id) {
-  unsigned short libh;
+FocasResult read_machine_id(unsigned short libh, char *machine_id) {
   unsigned long cncid[4];
 
-  // Connect to CNC
-  if (cnc_allclibhndl3(conf->ip, conf->port, 10, &libh) != EW_OK) {
-    return FOCAS_CONNECTION_FAILED;
-  }
-
   // Read CNC ID
   if (cnc_rdcncid(libh, cncid) != EW_OK) {
-    cnc_freelibhndl(libh);
     return FOCAS_ID_READ_FAILED;
   }
 
@@ -93,89 +73,65 @@ FocasResult read_machine_id(Config *conf, char *machine_id) {
   snprintf(machine_id, 36, "%08lx-%08lx-%08lx-%08lx", cncid[0], cncid[1],
            cncid[2], cncid[3]);
 
-  cnc_freelibhndl(libh);
   return FOCAS_OK;
 }
 
-FocasResult read_sequence_number(Config *conf, long *sequence_number) {
-  unsigned short libh;
+FocasResult read_sequence_number(unsigned short libh, long *sequence_number) {
   ODBSEQ seq_info;
 
-  // Connect to CNC
-  if (cnc_allclibhndl3(conf->ip, conf->port, 10, &libh) != EW_OK) {
-    return FOCAS_CONNECTION_FAILED;
-  }
-
   // Read sequence number
   if (cnc_rdseqnum(libh, &seq_info) != EW_OK) {
-    cnc_freelibhndl(libh);
     return FOCAS_SEQUENCE_READ_FAILED;
   }
 
   *sequence_number = seq_info.data;
 
-  cnc_freelibhndl(libh);
   return FOCAS_OK;
 }
 
-FocasResult read_position_info(Config *conf, PositionInfo *position) {
-  unsigned short libh;
-  ODBPOS pos_data;
-  short axis = 1; // Read first 3 axes (X, Y, Z)
-
-  // Connect to CNC
-  if (cnc_allclibhndl3(conf->ip, conf->port, 10, &libh) != EW_OK) {
-    return FOCAS_CONNECTION_FAILED;
+// Convert a position element to a double based on its decimal places
+static double position_value(const POSELM *elm) {
+  double divisor = 1.0;
+  for (int i = 0; i < elm->dec; i++) {
+    divisor *= 10.0;
   }
+  return (double)elm->data / divisor;
+}
 
-  // Read position data - the function fills in position for all types
-  // The second parameter is the axis type: 0=all axes, >0=specific axis count
-  short num_axes = 3;
-  if (cnc_rdposition(libh, 0, &num_axes, &pos_data) != EW_OK) {
-    cnc_freelibhndl(libh);
+FocasResult read_position_info(unsigned short libh, PositionInfo *position) {
+  ODBPOS pos_data[MAX_AXIS];
+
+  // Read all position types (type -1) of every axis (num_axes = MAX_AXIS) in
+  // one request, so Y and Z come from their own axes rather than staying
+  // zero. The buffer must hold one ODBPOS per axis the CNC reports.
+  short num_axes = MAX_AXIS;
+  if (cnc_rdposition(libh, -1, &num_axes, pos_data) != EW_OK) {
     return FOCAS_POSITION_READ_FAILED;
   }
 
-  // ODBPOS contains absolute, machine, relative, and distance positions
-  // Each POSELM contains position for first axis, we need to read multiple
-  // times for X,Y,Z For now, we'll use the first axis data and simulate the
-  // others In a real implementation, you'd need to call this function 3 times
-  // for X,Y,Z
-
-  // Convert to double values based on decimal places
-  double divisor = 1.0;
-  if (pos_data.abs.dec > 0) {
-    for (int i = 0; i < pos_data.abs.dec; i++) {
-      divisor *= 10.0;
-    }
+  // The first three axes are reported as X, Y and Z
+  memset(position, 0, sizeof(PositionInfo));
+  if (num_axes > 0) {
+    position->x_abs = position_value(&pos_data[0].abs);
+    position->x_rel = position_value(&pos_data[0].rel);
+  }
+  if (num_axes > 1) {
+    position->y_abs = position_value(&pos_data[1].abs);
+    position->y_rel = position_value(&pos_data[1].rel);
+  }
+  if (num_axes > 2) {
+    position->z_abs = position_value(&pos_data[2].abs);
+    position->z_rel = position_value(&pos_data[2].rel);
   }
 
-  // For now, just populate X position from the first axis
-  // In a complete implementation, you'd read Y and Z separately
-  position->x_abs = (double)pos_data.abs.data / divisor;
-  position->y_abs = 0.0; // Would need separate call for Y axis
-  position->z_abs = 0.0; // Would need separate call for Z axis
-
-  position->x_rel = (double)pos_data.rel.data / divisor;
-  position->y_rel = 0.0; // Would need separate call for Y axis
-  position->z_rel = 0.0; // Would need separate call for Z axis
-
-  cnc_freelibhndl(libh);
   return FOCAS_OK;
 }
 
-FocasResult read_speed_info(Config *conf, SpeedInfo *speed) {
-  unsigned short libh;
+FocasResult read_speed_info(unsigned short libh, SpeedInfo *speed) {
   ODBSPEED speed_data;
 
-  // Connect to CNC
-  if (cnc_allclibhndl3(conf->ip, conf->port, 10, &libh) != EW_OK) {
-    return FOCAS_CONNECTION_FAILED;
-  }
-
   // Read speed information
   if (cnc_rdspeed(libh, 0, &speed_data) != EW_OK) {
-    cnc_freelibhndl(libh);
     return FOCAS_SPEED_READ_FAILED;
   }
 
@@ -183,22 +139,14 @@ FocasResult read_speed_info(Config *conf, SpeedInfo *speed) {
   speed->feed_rate = speed_data.actf.data;
   speed->spindle_speed = speed_data.acts.data;
 
-  cnc_freelibhndl(libh);
   return FOCAS_OK;
 }
 
-FocasResult read_alarm_info(Config *conf, AlarmInfo *alarm) {
-  unsigned short libh;
+FocasResult read_alarm_info(unsigned short libh, AlarmInfo *alarm) {
   ODBALM alarm_data;
 
-  // Connect to CNC
-  if (cnc_allclibhndl3(conf->ip, conf->port, 10, &libh) != EW_OK) {
-    return FOCAS_CONNECTION_FAILED;
-  }
-
   // Read alarm status
   if (cnc_alarm(libh, &alarm_data) != EW_OK) {
-    cnc_freelibhndl(libh);
     return FOCAS_ALARM_READ_FAILED;
   }
 
@@ -206,64 +154,91 @@ FocasResult read_alarm_info(Config *conf, AlarmInfo *alarm) {
   alarm->alarm_status = alarm_data.data;
   alarm->has_alarm = (alarm_data.data != 0) ? 1 : 0;
 
-  cnc_freelibhndl(libh);
   return FOCAS_OK;
 }
 
-FocasResult read_complete_machine_info(Config *conf, MachineInfo *info) {
-  FocasResult result;
+FocasResult read_machine_info_from_handle(unsigned short libh,
+                                          MachineInfo *info) {
+  int answered = 0;
 
   // Initialize structure
   memset(info, 0, sizeof(MachineInfo));
 
   // Read machine ID
-  result = read_machine_id(conf, info->machine_id);
-  if (result != FOCAS_OK) {
+  if (read_machine_id(libh, info->machine_id) == FOCAS_OK) {
+    answered++;
+  } else {
     strcpy(info->machine_id, "UNKNOWN");
   }
 
   // Read current program
-  result =
-      read_current_program(conf, info->program_name, &info->program_number);
-  if (result != FOCAS_OK) {
+  if (read_current_program(libh, info->program_name, &info->program_number) ==
+      FOCAS_OK) {
+    answered++;
+  } else {
     strcpy(info->program_name, "UNKNOWN");
     info->program_number = 0;
   }
 
   // Read machine status
-  result = read_machine_status(conf, info->status);
-  if (result != FOCAS_OK) {
+  if (read_machine_status(libh, info->status) == FOCAS_OK) {
+    answered++;
+  } else {
     strcpy(info->status, "UNKNOWN");
   }
 
   // Read sequence number (current line)
-  result = read_sequence_number(conf, &info->sequence_number);
-  if (result != FOCAS_OK) {
+  if (read_sequence_number(libh, &info->sequence_number) == FOCAS_OK) {
+    answered++;
+  } else {
     info->sequence_number = 0;
   }
 
   // Read position information
-  result = read_position_info(conf, &info->position);
-  if (result != FOCAS_OK) {
+  if (read_position_info(libh, &info->position) == FOCAS_OK) {
+    answered++;
+  } else {
     memset(&info->position, 0, sizeof(PositionInfo));
   }
 
   // Read speed information
-  result = read_speed_info(conf, &info->speed);
-  if (result != FOCAS_OK) {
+  if (read_speed_info(libh, &info->speed) == FOCAS_OK) {
+    answered++;
+  } else {
     memset(&info->speed, 0, sizeof(SpeedInfo));
   }
 
   // Read alarm information
-  result = read_alarm_info(conf, &info->alarm);
-  if (result != FOCAS_OK) {
+  if (read_alarm_info(libh, &info->alarm) == FOCAS_OK) {
+    answered++;
+  } else {
     memset(&info->alarm, 0, sizeof(AlarmInfo));
   }
 
   // For compatibility, set program_line to sequence_number
   info->program_line = (int)info->sequence_number;
 
-  return FOCAS_OK;
+  // Individual fields may be unsupported, but a handle that answers nothing
+  // has lost its connection
+  return (answered > 0) ? FOCAS_OK : FOCAS_CONNECTION_FAILED;
+}
+
+FocasResult read_complete_machine_info(Config *conf, MachineInfo *info) {
+  unsigned short libh;
+
+  // One connection serves the whole snapshot
+  if (cnc_allclibhndl3(conf->ip, conf->port, 10, &libh) != EW_OK) {
+    memset(info, 0, sizeof(MachineInfo));
+    strcpy(info->machine_id, "UNKNOWN");
+    strcpy(info->program_name, "UNKNOWN");
+    strcpy(info->status, "UNKNOWN");
+    return FOCAS_CONNECTION_FAILED;
+  }
+
+  FocasResult result = read_machine_info_from_handle(libh, info);
+
+  cnc_freelibhndl(libh);
+  return result;
 }
 
 const char *focas_result_to_string(FocasResult result) {
@@ -25,11 +25,14 @@ typedef struct {
   int has_alarm;    // Boolean: 1 if any alarm is active, 0 if no alarms
 } AlarmInfo;
 
+// Size of MachineInfo.status, long enough for "UNKNOWN(n) (MOVING)"
+#define STATUS_SIZE 32
+
 // Machine information structure
 typedef struct {
   char machine_id[36];
   char program_name[16];
-  char status[16];
+  char status[STATUS_SIZE];
   int program_line;
   int program_number;
   long sequence_number;  // Current sequence number
@@ -51,15 +54,20 @@ typedef enum {
   FOCAS_ALARM_READ_FAILED = -8
 } FocasResult;
 
-// Function declarations
-FocasResult read_current_program(Config *conf, char *program_name,
+// Readers for an open library handle (from cnc_allclibhndl3), one FOCAS
+// request each
+FocasResult read_current_program(unsigned short libh, char *program_name,
                                  int *program_number);
-FocasResult read_machine_status(Config *conf, char *status_info);
-FocasResult read_machine_id(Config *conf, char *machine_id);
-FocasResult read_sequence_number(Config *conf, long *sequence_number);
-FocasResult read_position_info(Config *conf, PositionInfo *position);
-FocasResult read_speed_info(Config *conf, SpeedInfo *speed);
-FocasResult read_alarm_info(Config *conf, AlarmInfo *alarm);
+FocasResult read_machine_status(unsigned short libh, char *status_info);
+FocasResult read_machine_id(unsigned short libh, char *machine_id);
+FocasResult read_sequence_number(unsigned short libh, long *sequence_number);
+FocasResult read_position_info(unsigned short libh, PositionInfo *position);
+FocasResult read_speed_info(unsigned short libh, SpeedInfo *speed);
+FocasResult read_alarm_info(unsigned short libh, AlarmInfo *alarm);
+FocasResult read_machine_info_from_handle(unsigned short libh,
+                                          MachineInfo *info);
+
+// Connect once, read a full snapshot and disconnect
 FocasResult read_complete_machine_info(Config *conf, MachineInfo *info);
 
 // Helper functions
@@ -56,6 +56,7 @@ int main(int argc, char *argv[]) {
     printf("❌ Failed to initialize connection pool\n");
     return EXIT_FAILURE;
   }
+  init_multi_machine_info(&multi_info);
 
   // Parse command line arguments
   for (int i = 1; i < argc; i++) {
@@ -115,6 +116,10 @@ int main(int argc, char *argv[]) {
       printf("🔄 FANUC Multi-Machine Monitor - %s",
              ctime(&(time_t){time(NULL)}));
 
+      // Check idle connections before reading so a dead one is replaced
+      // rather than failing the read
+      maintain_connections(&pool, STALE_CONNECTION_SECONDS);
+
       // Read all machines
       if (read_all_machines_info(&pool, &multi_info) == FOCAS_OK) {
         print_multi_machine_info(&multi_info, info_type);
@@ -143,6 +148,8 @@ int main(int argc, char *argv[]) {
 
   // Cleanup
   disconnect_all_machines(&pool);
+  free_multi_machine_info(&multi_info);
+  free_connection_pool(&pool);
 
   printf("\n✅ Multi-machine demo completed\n");
   return EXIT_SUCCESS;
@@ -0,0 +1,131 @@
+#define TESTING 1
+
+extern "C" {
+  #include "fwlib32.h"
+  #include "../src/connection_pool.h"
+}
+
+#include "../extern/fff/fff.h"
+#include "gtest/gtest.h"
+
+DEFINE_FFF_GLOBALS;
+FAKE_VALUE_FUNC(short, cnc_allclibhndl3, const char *, unsigned short, long, unsigned short *);
+FAKE_VALUE_FUNC(short, cnc_freelibhndl, unsigned short);
+FAKE_VALUE_FUNC(short, cnc_rdcncid, unsigned short, unsigned long *);
+FAKE_VALUE_FUNC(short, cnc_rdprgnum, unsigned short, ODBPRO *);
+FAKE_VALUE_FUNC(short, cnc_statinfo, unsigned short, ODBST *);
+FAKE_VALUE_FUNC(short, cnc_rdseqnum, unsigned short, ODBSEQ *);
+FAKE_VALUE_FUNC(short, cnc_rdposition, unsigned short, short, short *, ODBPOS *);
+FAKE_VALUE_FUNC(short, cnc_rdspeed, unsigned short, short, ODBSPEED *);
+FAKE_VALUE_FUNC(short, cnc_alarm, unsigned short, ODBALM *);
+
+static short connect_with_handle(const char *, unsigned short, long,
+                                 unsigned short *handle) {
+  *handle = 5;
+  return EW_OK;
+}
+
+class ConnectionHealthTest : public ::testing::Test {
+protected:
+  ConnectionPool pool;
+
+  void SetUp() override {
+    RESET_FAKE(cnc_allclibhndl3);
+    RESET_FAKE(cnc_freelibhndl);
+    RESET_FAKE(cnc_statinfo);
+    FFF_RESET_HISTORY();
+    cnc_allclibhndl3_fake.custom_fake = connect_with_handle;
+
+    init_connection_pool(&pool);
+    add_machine(&pool, "1.2.3.4", 8193, "Mill1");
+  }
+
+  void TearDown() override { free_connection_pool(&pool); }
+};
+
+TEST_F(ConnectionHealthTest, HealthyIdleConnectionIsKept) {
+  ASSERT_EQ(connect_machine(&pool, 0), FOCAS_OK);
+  pool.machines[0].last_activity -= HEALTH_CHECK_IDLE_SECONDS;
+
+  maintain_connections(&pool, STALE_CONNECTION_SECONDS);
+
+  EXPECT_EQ(cnc_statinfo_fake.call_count, 1);
+  EXPECT_EQ(cnc_statinfo_fake.arg0_val, 5);
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 1);
+  EXPECT_EQ(pool.machines[0].state, CONN_CONNECTED);
+}
+
+TEST_F(ConnectionHealthTest, RecentlyUsedConnectionIsNotProbed) {
+  ASSERT_EQ(connect_machine(&pool, 0), FOCAS_OK);
+
+  maintain_connections(&pool, STALE_CONNECTION_SECONDS);
+
+  EXPECT_EQ(cnc_statinfo_fake.call_count, 0);
+}
+
+TEST_F(ConnectionHealthTest, DeadConnectionIsReplaced) {
+  ASSERT_EQ(connect_machine(&pool, 0), FOCAS_OK);
+  pool.machines[0].last_activity -= HEALTH_CHECK_IDLE_SECONDS;
+  cnc_statinfo_fake.return_val = EW_SOCKET;
+
+  maintain_connections(&pool, STALE_CONNECTION_SECONDS);
+
+  EXPECT_EQ(cnc_freelibhndl_fake.call_count, 1);
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 2);
+  EXPECT_EQ(pool.machines[0].state, CONN_CONNECTED);
+  EXPECT_EQ(pool.failed_health_checks, 1);
+  EXPECT_EQ(pool.reconnections, 1);
+}
+
+TEST_F(ConnectionHealthTest, FailedReconnectBacksOff) {
+  cnc_allclibhndl3_fake.custom_fake = NULL;
+  cnc_allclibhndl3_fake.return_val = EW_SOCKET;
+  ASSERT_EQ(connect_machine(&pool, 0), FOCAS_CONNECTION_FAILED);
+
+  EXPECT_EQ(reconnect_if_needed(&pool, 0), FOCAS_CONNECTION_FAILED);
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 1);
+
+  pool.machines[0].next_retry = time(NULL);
+  EXPECT_EQ(reconnect_if_needed(&pool, 0), FOCAS_CONNECTION_FAILED);
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 2);
+  EXPECT_EQ(pool.machines[0].retry_count, 2);
+}
+
+TEST_F(ConnectionHealthTest, ReadWaitsForReconnectBackoff) {
+  MachineInfo info;
+  cnc_allclibhndl3_fake.custom_fake = NULL;
+  cnc_allclibhndl3_fake.return_val = EW_SOCKET;
+  ASSERT_EQ(connect_machine(&pool, 0), FOCAS_CONNECTION_FAILED);
+
+  EXPECT_EQ(read_machine_by_id(&pool, 0, &info), FOCAS_CONNECTION_FAILED);
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 1);
+
+  // Cached info is served while the backoff runs
+  pool.machines[0].info_valid = 1;
+  strcpy(pool.machines[0].last_info.status, "STOPPED");
+  EXPECT_EQ(read_machine_by_id(&pool, 0, &info), FOCAS_OK);
+  EXPECT_STREQ(info.status, "STOPPED");
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 1);
+
+  pool.machines[0].next_retry = time(NULL);
+  EXPECT_EQ(read_machine_by_id(&pool, 0, &info), FOCAS_OK);
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 2);
+}
+
+TEST_F(ConnectionHealthTest, StaleConnectionIsReleased) {
+  ASSERT_EQ(connect_machine(&pool, 0), FOCAS_OK);
+  pool.machines[0].info_valid = 1;
+  pool.machines[0].last_activity -= STALE_CONNECTION_SECONDS;
+
+  cleanup_stale_connections(&pool, STALE_CONNECTION_SECONDS);
+
+  EXPECT_EQ(cnc_freelibhndl_fake.call_count, 1);
+  EXPECT_EQ(cnc_freelibhndl_fake.arg0_val, 5);
+  EXPECT_EQ(pool.machines[0].state, CONN_DISCONNECTED);
+  EXPECT_EQ(pool.machines[0].handle, 0);
+  EXPECT_EQ(pool.machines[0].info_valid, 1);
+
+  // Released connections are not reconnected until they are read again
+  maintain_connections(&pool, STALE_CONNECTION_SECONDS);
+  EXPECT_EQ(cnc_allclibhndl3_fake.call_count, 1);
+}
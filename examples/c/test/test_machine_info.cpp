@@ -0,0 +1,92 @@
+#define TESTING 1
+
+extern "C" {
+  #include "../src/config.h"
+  #include "../src/machine_info.c"
+}
+
+#include "../extern/fff/fff.h"
+#include "gtest/gtest.h"
+
+DEFINE_FFF_GLOBALS;
+FAKE_VALUE_FUNC(short, cnc_allclibhndl3, const char *, unsigned short, long, unsigned short *);
+FAKE_VALUE_FUNC(short, cnc_freelibhndl, unsigned short);
+FAKE_VALUE_FUNC(short, cnc_rdcncid, unsigned short, unsigned long *);
+FAKE_VALUE_FUNC(short, cnc_rdprgnum, unsigned short, ODBPRO *);
+FAKE_VALUE_FUNC(short, cnc_statinfo, unsigned short, ODBST *);
+FAKE_VALUE_FUNC(short, cnc_rdseqnum, unsigned short, ODBSEQ *);
+FAKE_VALUE_FUNC(short, cnc_rdposition, unsigned short, short, short *, ODBPOS *);
+FAKE_VALUE_FUNC(short, cnc_rdspeed, unsigned short, short, ODBSPEED *);
+FAKE_VALUE_FUNC(short, cnc_alarm, unsigned short, ODBALM *);
+
+class MachineInfoTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    RESET_FAKE(cnc_allclibhndl3);
+    RESET_FAKE(cnc_freelibhndl);
+    RESET_FAKE(cnc_rdcncid);
+    RESET_FAKE(cnc_rdprgnum);
+    RESET_FAKE(cnc_statinfo);
+    RESET_FAKE(cnc_rdseqnum);
+    RESET_FAKE(cnc_rdposition);
+    RESET_FAKE(cnc_rdspeed);
+    RESET_FAKE(cnc_alarm);
+    FFF_RESET_HISTORY();
+  }
+};
+
+TEST_F(MachineInfoTest, SnapshotUsesOneConnection) {
+  MachineInfo info;
+  Config c = {"1.2.3.4", 1234, "all", 0};
+
+  ASSERT_EQ(read_complete_machine_info(&c, &info), FOCAS_OK);
+
+  ASSERT_EQ(cnc_allclibhndl3_fake.call_count, 1);
+  EXPECT_STREQ(cnc_allclibhndl3_fake.arg0_val, "1.2.3.4");
+  EXPECT_EQ(cnc_allclibhndl3_fake.arg1_val, 1234);
+  ASSERT_EQ(cnc_freelibhndl_fake.call_count, 1);
+
+  EXPECT_EQ(cnc_rdcncid_fake.call_count, 1);
+  EXPECT_EQ(cnc_rdprgnum_fake.call_count, 1);
+  EXPECT_EQ(cnc_statinfo_fake.call_count, 1);
+  EXPECT_EQ(cnc_rdseqnum_fake.call_count, 1);
+  EXPECT_EQ(cnc_rdposition_fake.call_count, 1);
+  EXPECT_EQ(cnc_rdspeed_fake.call_count, 1);
+  EXPECT_EQ(cnc_alarm_fake.call_count, 1);
+}
+
+TEST_F(MachineInfoTest, HandleReaderDoesNotConnect) {
+  MachineInfo info;
+
+  ASSERT_EQ(read_machine_info_from_handle(7, &info), FOCAS_OK);
+
+  ASSERT_EQ(cnc_allclibhndl3_fake.call_count, 0);
+  ASSERT_EQ(cnc_freelibhndl_fake.call_count, 0);
+  EXPECT_EQ(cnc_statinfo_fake.arg0_val, 7);
+  EXPECT_EQ(cnc_alarm_fake.arg0_val, 7);
+}
+
+TEST_F(MachineInfoTest, ConnectFailureSkipsReads) {
+  MachineInfo info;
+  Config c = {"1.2.3.4", 1234, "all", 0};
+  cnc_allclibhndl3_fake.return_val = EW_SOCKET;
+
+  ASSERT_EQ(read_complete_machine_info(&c, &info), FOCAS_CONNECTION_FAILED);
+
+  EXPECT_EQ(cnc_freelibhndl_fake.call_count, 0);
+  EXPECT_EQ(cnc_statinfo_fake.call_count, 0);
+  EXPECT_STREQ(info.status, "UNKNOWN");
+}
+
+TEST_F(MachineInfoTest, HandleThatAnswersNothingIsLost) {
+  MachineInfo info;
+  cnc_rdcncid_fake.return_val = EW_HANDLE;
+  cnc_rdprgnum_fake.return_val = EW_HANDLE;
+  cnc_statinfo_fake.return_val = EW_HANDLE;
+  cnc_rdseqnum_fake.return_val = EW_HANDLE;
+  cnc_rdposition_fake.return_val = EW_HANDLE;
+  cnc_rdspeed_fake.return_val = EW_HANDLE;
+  cnc_alarm_fake.return_val = EW_HANDLE;
+
+  ASSERT_EQ(read_machine_info_from_handle(7, &info), FOCAS_CONNECTION_FAILED);
+}
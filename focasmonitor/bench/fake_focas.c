@@ -0,0 +1,500 @@
+#include "fake_focas.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "platform.h"
+
+#include "fwlib32.h"
+
+// Simulated controllers for focas_bench and the libfwlib32 mock. Every call
+// sleeps for a sample of the configured latency distribution, so the pool and
+// collector see the same blocking behaviour as on a real network. Random
+// numbers come from a per-handle generator seeded from the profile, which
+// keeps runs repeatable and lets worker threads draw samples without sharing
+// state. Like the real library, a handle only works on the thread that
+// allocated it; any other thread gets EW_HANDLE.
+
+#define FAKE_MAX_HANDLES 65536
+#define FAKE_SCRIPT_SEPARATORS " \t\r\n"
+
+typedef struct {
+  bool open;
+  int machine;
+  int script;          // Index into scripts, -1 if not scripted
+  unsigned int rng;    // xorshift32 state
+  unsigned long reads; // Reads answered, drives the simulated motion
+  pthread_t owner;     // Thread that allocated the handle
+} FakeConnection;
+
+static FakeFocasProfile fake_profile;
+static FakeMachineScript *scripts;
+static int script_count;
+static int script_capacity;
+static FakeConnection connections[FAKE_MAX_HANDLES];
+static PlatformMutex connections_lock;
+static unsigned int next_handle = 1;
+static unsigned int connect_count;
+
+void fake_focas_configure(const FakeFocasProfile *profile) {
+  fake_profile = *profile;
+  if (fake_profile.seed == 0) {
+    fake_profile.seed = 1;
+  }
+  memset(connections, 0, sizeof(connections));
+  platform_mutex_init(&connections_lock);
+
+  free(scripts);
+  scripts = NULL;
+  script_count = 0;
+  script_capacity = 0;
+}
+
+static bool fake_parse_script_option(const char *option,
+                                     FakeMachineScript *script) {
+  char *end;
+
+  if (strncmp(option, "state=", 6) == 0) {
+    const char *state = option + 6;
+    if (strcmp(state, "running") == 0) {
+      script->state = FAKE_MACHINE_RUNNING;
+    } else if (strcmp(state, "idle") == 0) {
+      script->state = FAKE_MACHINE_IDLE;
+    } else if (strcmp(state, "alarm") == 0) {
+      script->state = FAKE_MACHINE_ALARM;
+    } else if (strcmp(state, "offline") == 0) {
+      script->state = FAKE_MACHINE_OFFLINE;
+    } else {
+      return false;
+    }
+    return true;
+  }
+  if (strncmp(option, "latency=", 8) == 0) {
+    script->has_latency = true;
+    return fake_latency_parse(option + 8, &script->call_latency);
+  }
+  if (strncmp(option, "errors=", 7) == 0) {
+    script->error_rate = strtod(option + 7, &end);
+    return *end == '\0' && script->error_rate >= 0 && script->error_rate <= 1;
+  }
+  if (strncmp(option, "drop-after=", 11) == 0) {
+    script->drop_after = strtoul(option + 11, &end, 10);
+    return *end == '\0' && script->drop_after > 0;
+  }
+  if (strncmp(option, "dynamic2=", 9) == 0) {
+    long error = strtol(option + 9, &end, 10);
+    script->dynamic2_error = (short) error;
+    return *end == '\0' && error != EW_OK && error >= -32768 && error <= 32767;
+  }
+  return false;
+}
+
+static bool fake_add_script(const FakeMachineScript *script) {
+  if (script_count == script_capacity) {
+    int capacity = script_capacity > 0 ? script_capacity * 2 : 16;
+    FakeMachineScript *grown =
+        realloc(scripts, (size_t) capacity * sizeof(FakeMachineScript));
+    if (!grown) {
+      return false;
+    }
+    scripts = grown;
+    script_capacity = capacity;
+  }
+  scripts[script_count++] = *script;
+  return true;
+}
+
+bool fake_focas_load_script(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "Error: Cannot open machine script '%s'\n", path);
+    return false;
+  }
+
+  char line[256];
+  int line_num = 0;
+  bool valid = true;
+
+  while (valid && fgets(line, sizeof(line), file)) {
+    line_num++;
+
+    char *comment = strchr(line, '#');
+    if (comment) {
+      *comment = '\0';
+    }
+    char *token = strtok(line, FAKE_SCRIPT_SEPARATORS);
+    if (!token) {
+      continue;
+    }
+
+    FakeMachineScript script;
+    memset(&script, 0, sizeof(FakeMachineScript));
+    script.error_rate = -1;
+    strncpy(script.ip, token, sizeof(script.ip) - 1);
+
+    while ((token = strtok(NULL, FAKE_SCRIPT_SEPARATORS)) != NULL) {
+      if (!fake_parse_script_option(token, &script)) {
+        fprintf(stderr, "Error: Invalid option '%s' on line %d of '%s'\n",
+                token, line_num, path);
+        valid = false;
+        break;
+      }
+    }
+
+    if (valid && !fake_add_script(&script)) {
+      fprintf(stderr, "Error: Out of memory loading '%s'\n", path);
+      valid = false;
+    }
+  }
+
+  fclose(file);
+  return valid;
+}
+
+static int fake_find_script(const char *ip) {
+  for (int i = 0; i < script_count; i++) {
+    if (strcmp(scripts[i].ip, ip) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void fake_focas_machine_ip(int machine, char *buffer, int size) {
+  snprintf(buffer, (size_t) size, "10.%d.%d.%d", (machine >> 16) & 0xff,
+           (machine >> 8) & 0xff, machine & 0xff);
+}
+
+// Anything but a dotted IPv4 address is treated as unreachable
+static int fake_machine_from_ip(const char *ip) {
+  int a, b, c, d;
+  if (sscanf(ip, "%d.%d.%d.%d", &a, &b, &c, &d) != 4) {
+    return -1;
+  }
+  return ((b & 0xff) << 16) | ((c & 0xff) << 8) | (d & 0xff);
+}
+
+static void fake_sleep(double ms) {
+  if (ms <= 0) {
+    return;
+  }
+  struct timespec delay;
+  delay.tv_sec = (time_t) (ms / 1000.0);
+  delay.tv_nsec = (long) ((ms - delay.tv_sec * 1000.0) * 1000000.0);
+  nanosleep(&delay, NULL);
+}
+
+// Simulate one read round trip. Returns the connection, or NULL with the
+// FOCAS error to return in *result.
+static FakeConnection *fake_round_trip(unsigned short handle, short *result) {
+  FakeConnection *connection = &connections[handle];
+  if (handle == 0 || !connection->open
+      || !pthread_equal(connection->owner, pthread_self())) {
+    *result = EW_HANDLE;
+    return NULL;
+  }
+
+  const FakeMachineScript *script =
+      connection->script >= 0 ? &scripts[connection->script] : NULL;
+  const FakeLatency *latency = script && script->has_latency
+                                   ? &script->call_latency
+                                   : &fake_profile.call_latency;
+  double error_rate = script && script->error_rate >= 0
+                          ? script->error_rate
+                          : fake_profile.error_rate;
+
+  fake_sleep(fake_latency_sample(latency, &connection->rng));
+  if (script && script->drop_after > 0
+      && connection->reads >= script->drop_after) {
+    // The machine went away; only a new connection talks to it again
+    *result = EW_SOCKET;
+    return NULL;
+  }
+  if (error_rate > 0 && fake_random(&connection->rng) < error_rate) {
+    *result = EW_SOCKET;
+    return NULL;
+  }
+
+  connection->reads++;
+  *result = EW_OK;
+  return connection;
+}
+
+static FakeMachineState fake_machine_state(const FakeConnection *connection) {
+  if (connection->script >= 0
+      && scripts[connection->script].state != FAKE_MACHINE_DEFAULT) {
+    return scripts[connection->script].state;
+  }
+  if (connection->machine % 17 == 16) {
+    return FAKE_MACHINE_ALARM;
+  }
+  return connection->machine % 5 == 4 ? FAKE_MACHINE_IDLE
+                                      : FAKE_MACHINE_RUNNING;
+}
+
+static bool fake_machine_running(const FakeConnection *connection) {
+  return fake_machine_state(connection) == FAKE_MACHINE_RUNNING;
+}
+
+static bool fake_machine_alarm(const FakeConnection *connection) {
+  return fake_machine_state(connection) == FAKE_MACHINE_ALARM;
+}
+
+short cnc_allclibhndl3(const char *ip, unsigned short port, long timeout,
+                       unsigned short *handle) {
+  (void) port;
+
+  int machine = fake_machine_from_ip(ip);
+  int script = fake_find_script(ip);
+  bool offline = machine < 0 || machine < fake_profile.offline_count;
+  if (script >= 0 && scripts[script].state != FAKE_MACHINE_DEFAULT) {
+    offline = scripts[script].state == FAKE_MACHINE_OFFLINE;
+  }
+
+  platform_mutex_lock(&connections_lock);
+  unsigned int rng = fake_profile.seed ^ (2654435761u * ++connect_count);
+  platform_mutex_unlock(&connections_lock);
+  if (rng == 0) {
+    rng = 1;
+  }
+
+  if (offline) {
+    // The FOCAS timeout is in seconds
+    fake_sleep(fake_profile.offline_uses_timeout
+                   ? timeout * 1000.0
+                   : fake_latency_sample(&fake_profile.offline_latency, &rng));
+    return EW_SOCKET;
+  }
+
+  fake_sleep(fake_latency_sample(&fake_profile.connect_latency, &rng));
+
+  platform_mutex_lock(&connections_lock);
+  for (int tries = 1; tries < FAKE_MAX_HANDLES; tries++) {
+    unsigned int candidate = next_handle;
+    next_handle = next_handle % (FAKE_MAX_HANDLES - 1) + 1;
+    if (!connections[candidate].open) {
+      connections[candidate].open = true;
+      connections[candidate].machine = machine < 0 ? 0 : machine;
+      connections[candidate].script = script;
+      connections[candidate].rng = rng;
+      connections[candidate].reads = 0;
+      connections[candidate].owner = pthread_self();
+      platform_mutex_unlock(&connections_lock);
+      *handle = (unsigned short) candidate;
+      return EW_OK;
+    }
+  }
+  platform_mutex_unlock(&connections_lock);
+  return EW_RESET; // Out of handles
+}
+
+short cnc_freelibhndl(unsigned short handle) {
+  platform_mutex_lock(&connections_lock);
+  bool owned = connections[handle].open
+               && pthread_equal(connections[handle].owner, pthread_self());
+  if (owned) {
+    connections[handle].open = false;
+  }
+  platform_mutex_unlock(&connections_lock);
+  return owned ? EW_OK : EW_HANDLE;
+}
+
+short cnc_rdcncid(unsigned short handle, unsigned long *cncid) {
+  short result;
+  FakeConnection *connection = fake_round_trip(handle, &result);
+  if (connection) {
+    cncid[0] = 0xbe4c0000ul | (unsigned long) connection->machine;
+    cncid[1] = 0x0000fa0cul;
+    cncid[2] = 0x00000031ul;
+    cncid[3] = (unsigned long) connection->machine;
+  }
+  return result;
+}
+
+short cnc_sysinfo(unsigned short handle, ODBSYS *sysinfo) {
+  short result;
+  if (fake_round_trip(handle, &result)) {
+    memset(sysinfo, 0, sizeof(ODBSYS));
+    sysinfo->max_axis = MAX_AXIS;
+    memcpy(sysinfo->cnc_type, "31", 2);
+    memcpy(sysinfo->mt_type, " M", 2);
+    memcpy(sysinfo->series, "G421", 4);
+    memcpy(sysinfo->version, "30.0", 4);
+    memcpy(sysinfo->axes, "03", 2);
+  }
+  return result;
+}
+
+short cnc_rdaxisname(unsigned short handle, short *count, ODBAXISNAME *axes) {
+  short result;
+  if (fake_round_trip(handle, &result)) {
+    if (*count > 3) {
+      *count = 3;
+    }
+    for (int i = 0; i < *count; i++) {
+      axes[i].name = "XYZ"[i];
+      axes[i].suff = ' ';
+    }
+  }
+  return result;
+}
+
+short cnc_getfigure(unsigned short handle, short type, short *count,
+                    short *decimals_in, short *decimals_out) {
+  (void) type;
+  short result;
+  if (fake_round_trip(handle, &result)) {
+    if (*count > 3) {
+      *count = 3;
+    }
+    for (int i = 0; i < *count; i++) {
+      decimals_in[i] = 3;
+      decimals_out[i] = 3;
+    }
+  }
+  return result;
+}
+
+short cnc_rdspdlname(unsigned short handle, short *count,
+                     ODBSPDLNAME *spindles) {
+  short result;
+  if (fake_round_trip(handle, &result)) {
+    if (*count > 1) {
+      *count = 1;
+    }
+    spindles[0].name = 'S';
+    spindles[0].suff1 = '1';
+    spindles[0].suff2 = ' ';
+    spindles[0].suff3 = ' ';
+  }
+  return result;
+}
+
+// Simulated position of an axis in increments (three decimals)
+static long fake_position(const FakeConnection *connection, int axis) {
+  long travel = fake_machine_running(connection)
+                    ? (long) (connection->reads % 100000) * (axis + 1)
+                    : 0;
+  return 100000L * (axis + 1) + travel;
+}
+
+short cnc_rddynamic2(unsigned short handle, short axis, short length,
+                     ODBDY2 *dynamic) {
+  (void) axis;
+  (void) length;
+  short result;
+  FakeConnection *connection = fake_round_trip(handle, &result);
+  if (connection && connection->script >= 0
+      && scripts[connection->script].dynamic2_error != EW_OK) {
+    // A control that answers but rejects the request
+    return scripts[connection->script].dynamic2_error;
+  }
+  if (connection) {
+    int machine = connection->machine;
+    bool running = fake_machine_running(connection);
+    memset(dynamic, 0, sizeof(ODBDY2));
+    dynamic->axis = ALL_AXES;
+    dynamic->alarm = fake_machine_alarm(connection) ? 1 : 0;
+    dynamic->prgnum = 1000 + machine % 9000;
+    dynamic->prgmnum = dynamic->prgnum;
+    dynamic->seqnum = (long) (connection->reads % 10000);
+    dynamic->actf = running ? 1200 : 0;
+    dynamic->acts = running ? 8000 : 0;
+    for (int i = 0; i < 3; i++) {
+      long position = fake_position(connection, i);
+      dynamic->pos.faxis.absolute[i] = position;
+      dynamic->pos.faxis.machine[i] = position;
+      dynamic->pos.faxis.relative[i] = position;
+    }
+  }
+  return result;
+}
+
+short cnc_rdprgnum(unsigned short handle, ODBPRO *prgnum) {
+  short result;
+  FakeConnection *connection = fake_round_trip(handle, &result);
+  if (connection) {
+    memset(prgnum, 0, sizeof(ODBPRO));
+    prgnum->data = (short) (1000 + connection->machine % 9000);
+    prgnum->mdata = prgnum->data;
+  }
+  return result;
+}
+
+short cnc_statinfo(unsigned short handle, ODBST *status) {
+  short result;
+  FakeConnection *connection = fake_round_trip(handle, &result);
+  if (connection) {
+    memset(status, 0, sizeof(ODBST));
+    status->aut = 1;
+    if (fake_machine_alarm(connection)) {
+      status->run = 3;
+      status->alarm = 1;
+    } else if (fake_machine_running(connection)) {
+      status->run = 1;
+      status->motion = 1;
+    }
+  }
+  return result;
+}
+
+short cnc_rdseqnum(unsigned short handle, ODBSEQ *sequence) {
+  short result;
+  FakeConnection *connection = fake_round_trip(handle, &result);
+  if (connection) {
+    memset(sequence, 0, sizeof(ODBSEQ));
+    sequence->data = (long) (connection->reads % 10000);
+  }
+  return result;
+}
+
+short cnc_rdposition(unsigned short handle, short type, short *count,
+                     ODBPOS *positions) {
+  (void) type;
+  short result;
+  FakeConnection *connection = fake_round_trip(handle, &result);
+  if (connection) {
+    if (*count < 0 || *count > 3) {
+      *count = 3;
+    }
+    for (int i = 0; i < *count; i++) {
+      POSELM element;
+      memset(&element, 0, sizeof(POSELM));
+      element.data = fake_position(connection, i);
+      element.dec = 3;
+      element.name = "XYZ"[i];
+      element.suff = ' ';
+      positions[i].abs = element;
+      positions[i].mach = element;
+      positions[i].rel = element;
+      element.data = 0;
+      positions[i].dist = element;
+    }
+  }
+  return result;
+}
+
+short cnc_rdspeed(unsigned short handle, short type, ODBSPEED *speed) {
+  (void) type;
+  short result;
+  FakeConnection *connection = fake_round_trip(handle, &result);
+  if (connection) {
+    bool running = fake_machine_running(connection);
+    memset(speed, 0, sizeof(ODBSPEED));
+    speed->actf.data = running ? 1200 : 0;
+    speed->acts.data = running ? 8000 : 0;
+  }
+  return result;
+}
+
+short cnc_alarm(unsigned short handle, ODBALM *alarm) {
+  short result;
+  FakeConnection *connection = fake_round_trip(handle, &result);
+  if (connection) {
+    memset(alarm, 0, sizeof(ODBALM));
+    alarm->data = fake_machine_alarm(connection) ? 1 : 0;
+  }
+  return result;
+}
@@ -0,0 +1,54 @@
+#ifndef FAKE_FOCAS_H
+#define FAKE_FOCAS_H
+
+#include <stdbool.h>
+
+#include "fake_latency.h"
+
+// Stand-in for the FOCAS library used by focas_bench and the libfwlib32 mock
+// (fwlib32_mock.c). It defines the cnc_* functions focasmonitor and
+// examples/c call, so the real code runs unmodified while every call costs a
+// simulated round trip.
+
+// Simulated machine fleet. Machines are told apart by IPv4 address: a.b.c.d
+// is machine (b << 16) | (c << 8) | d, so 10.0.3.232 is machine 1000 (see
+// fake_focas_machine_ip). The first offline_count machines never answer.
+typedef struct {
+  FakeLatency call_latency;    // Every read after connect
+  FakeLatency connect_latency; // Successful cnc_allclibhndl3
+  FakeLatency offline_latency; // cnc_allclibhndl3 to an offline machine
+  bool offline_uses_timeout;   // Offline connects take the caller's timeout
+  double error_rate;           // Share of reads that fail with EW_SOCKET
+  int offline_count;
+  unsigned int seed;
+} FakeFocasProfile;
+
+// What a simulated machine reports. By default every fifth machine is idle
+// and every seventeenth in alarm; a script can pin any machine's state.
+typedef enum {
+  FAKE_MACHINE_DEFAULT = 0,
+  FAKE_MACHINE_RUNNING = 1,
+  FAKE_MACHINE_IDLE = 2,
+  FAKE_MACHINE_ALARM = 3,
+  FAKE_MACHINE_OFFLINE = 4
+} FakeMachineState;
+
+// Per-machine behaviour loaded from a script file, one machine per line:
+//   <ip> [state=running|idle|alarm|offline] [latency=<dist>]
+//        [errors=<fraction>] [drop-after=<reads>] [dynamic2=<error>]
+typedef struct {
+  char ip[40];
+  FakeMachineState state;
+  bool has_latency;
+  FakeLatency call_latency;
+  double error_rate;        // Negative = the profile's error rate
+  unsigned long drop_after; // Reads before the connection dies (0 = never)
+  short dynamic2_error;     // FOCAS error cnc_rddynamic2 answers with, 0 = none
+} FakeMachineScript;
+
+// Must be called before the first connect; configuring drops any script
+void fake_focas_configure(const FakeFocasProfile *profile);
+bool fake_focas_load_script(const char *path);
+void fake_focas_machine_ip(int machine, char *buffer, int size);
+
+#endif // FAKE_FOCAS_H
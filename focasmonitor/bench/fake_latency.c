@@ -0,0 +1,78 @@
+#include "fake_latency.h"
+
+#include <math.h>
+#include <stdio.h>
+
+bool fake_latency_parse(const char *spec, FakeLatency *latency) {
+  double a = 0;
+  double b = 0;
+
+  if (sscanf(spec, "fixed:%lf", &a) == 1) {
+    latency->kind = FAKE_LATENCY_FIXED;
+  } else if (sscanf(spec, "uniform:%lf:%lf", &a, &b) == 2 && b >= a) {
+    latency->kind = FAKE_LATENCY_UNIFORM;
+  } else if (sscanf(spec, "exp:%lf", &a) == 1) {
+    latency->kind = FAKE_LATENCY_EXPONENTIAL;
+  } else if (sscanf(spec, "lognormal:%lf:%lf", &a, &b) == 2 && b >= 0) {
+    latency->kind = FAKE_LATENCY_LOGNORMAL;
+  } else {
+    return false;
+  }
+
+  if (a < 0) {
+    return false;
+  }
+  latency->a = a;
+  latency->b = b;
+  return true;
+}
+
+void fake_latency_describe(const FakeLatency *latency, char *buffer,
+                           int size) {
+  switch (latency->kind) {
+    case FAKE_LATENCY_FIXED:
+      snprintf(buffer, (size_t) size, "fixed %.2f ms", latency->a);
+      break;
+    case FAKE_LATENCY_UNIFORM:
+      snprintf(buffer, (size_t) size, "uniform %.2f-%.2f ms", latency->a,
+               latency->b);
+      break;
+    case FAKE_LATENCY_EXPONENTIAL:
+      snprintf(buffer, (size_t) size, "exponential, mean %.2f ms",
+               latency->a);
+      break;
+    case FAKE_LATENCY_LOGNORMAL:
+      snprintf(buffer, (size_t) size, "lognormal, median %.2f ms, sigma %.2f",
+               latency->a, latency->b);
+      break;
+  }
+}
+
+// Uniform sample in (0, 1)
+double fake_random(unsigned int *state) {
+  unsigned int x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return ((x >> 8) + 0.5) / 16777216.0;
+}
+
+double fake_latency_sample(const FakeLatency *latency, unsigned int *state) {
+  switch (latency->kind) {
+    case FAKE_LATENCY_UNIFORM:
+      return latency->a + (latency->b - latency->a) * fake_random(state);
+    case FAKE_LATENCY_EXPONENTIAL:
+      return -latency->a * log(fake_random(state));
+    case FAKE_LATENCY_LOGNORMAL: {
+      // Box-Muller normal sample
+      double u1 = fake_random(state);
+      double u2 = fake_random(state);
+      double z = sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+      return latency->a * exp(latency->b * z);
+    }
+    case FAKE_LATENCY_FIXED:
+    default:
+      return latency->a;
+  }
+}
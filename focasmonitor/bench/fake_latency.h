@@ -0,0 +1,34 @@
+#ifndef FAKE_LATENCY_H
+#define FAKE_LATENCY_H
+
+#include <stdbool.h>
+
+// Latency distributions shared by the simulated FOCAS library (fake_focas.c)
+// and the FOCAS Ethernet simulator (focas_sim.c)
+
+// Latency distribution of a simulated call
+typedef enum {
+  FAKE_LATENCY_FIXED = 0,       // a ms
+  FAKE_LATENCY_UNIFORM = 1,     // a to b ms
+  FAKE_LATENCY_EXPONENTIAL = 2, // Mean a ms
+  FAKE_LATENCY_LOGNORMAL = 3    // Median a ms, shape b (long tail)
+} FakeLatencyKind;
+
+typedef struct {
+  FakeLatencyKind kind;
+  double a;
+  double b;
+} FakeLatency;
+
+// Parse "fixed:<ms>", "uniform:<min>:<max>", "exp:<mean>" or
+// "lognormal:<median>:<sigma>"
+bool fake_latency_parse(const char *spec, FakeLatency *latency);
+void fake_latency_describe(const FakeLatency *latency, char *buffer,
+                           int size);
+
+// Random numbers from a caller-owned xorshift32 state (must not be 0), so
+// threads and connections draw samples without sharing state
+double fake_random(unsigned int *state);
+double fake_latency_sample(const FakeLatency *latency, unsigned int *state);
+
+#endif // FAKE_LATENCY_H
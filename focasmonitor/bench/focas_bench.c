@@ -0,0 +1,326 @@
+#include "fake_focas.h"
+#include "focasmonitor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+// focas_bench drives the real connection pool, collector and acquisition code
+// against simulated controllers (fake_focas.c) and reports cycle time,
+// throughput and per-call tail latency. The numbers are repeatable for a given
+// seed, which makes them usable for sizing --threads, --deadline and the
+// polling intervals before a change reaches the floor.
+
+#define DEFAULT_BENCH_MACHINES 100
+#define DEFAULT_BENCH_CYCLES 20
+
+typedef struct {
+  int machines;
+  int cycles;
+  int threads;
+  int deadline_ms;
+  char info_type[16];
+  char fields[128];
+  char acquisition[16];
+  char script[256];
+  bool verbose;
+  FakeFocasProfile profile;
+} BenchConfig;
+
+static void show_bench_usage(const char *program_name) {
+  printf("FOCAS Bench - Collection benchmark against simulated machines\n\n");
+  printf("Usage: %s [options]\n\n", program_name);
+  printf("Options:\n");
+  printf("  --machines=<count>          Simulated machines (default: %d)\n",
+         DEFAULT_BENCH_MACHINES);
+  printf("  --cycles=<count>            Collection cycles to time (default: "
+         "%d)\n",
+         DEFAULT_BENCH_CYCLES);
+  printf("  --threads=<count>           Worker threads (default: one per "
+         "machine, max %d;\n",
+         MAX_WORKER_THREADS);
+  printf("                              1 = sequential)\n");
+  printf("  --deadline=<ms>             Cycle deadline (default: wait for "
+         "every machine)\n");
+  printf("  --info=<type>               Acquisition plan as in focasmonitor "
+         "(default: all)\n");
+  printf("  --fields=<list>             Explicit FOCAS reads, overrides "
+         "--info\n");
+  printf("  --acquisition=<mode>        auto, dynamic or individual (default: "
+         "auto)\n");
+  printf("  --latency=<dist>            Latency of every read (default: "
+         "exp:5)\n");
+  printf("  --connect-latency=<dist>    Latency of a successful connect "
+         "(default: fixed:20)\n");
+  printf("  --error-rate=<fraction>     Share of reads failing with a socket "
+         "error\n");
+  printf("                              (default: 0)\n");
+  printf("  --offline=<count>           Machines that never answer "
+         "(default: 0)\n");
+  printf("  --offline-latency=<dist>    Time a connect to an offline machine "
+         "takes\n");
+  printf("                              (default: the %d s connect timeout)\n",
+         CONNECTION_TIMEOUT);
+  printf("  --script=<file>             Per-machine behaviour, one machine per "
+         "line:\n");
+  printf("                              <ip> [state=running|idle|alarm|"
+         "offline]\n");
+  printf("                              [latency=<dist>] [errors=<fraction>] "
+         "[drop-after=<reads>]\n");
+  printf("  --seed=<n>                  Random seed (default: 1)\n");
+  printf("  --verbose                   Show the connection pool's output\n");
+  printf("  --help                      Show this help message\n\n");
+  printf("Distributions: fixed:<ms>, uniform:<min>:<max>, exp:<mean>,\n");
+  printf("               lognormal:<median>:<sigma>\n\n");
+  printf("Examples:\n");
+  printf("  %s --machines=500 --threads=32 --latency=lognormal:8:0.6\n",
+         program_name);
+  printf("  %s --machines=200 --offline=10 --deadline=1000 "
+         "--offline-latency=fixed:3000\n",
+         program_name);
+}
+
+static int parse_bench_args(int argc, char *argv[], BenchConfig *conf) {
+  memset(conf, 0, sizeof(BenchConfig));
+  conf->machines = DEFAULT_BENCH_MACHINES;
+  conf->cycles = DEFAULT_BENCH_CYCLES;
+  conf->threads = DEFAULT_WORKER_THREADS;
+  conf->deadline_ms = DEFAULT_CYCLE_DEADLINE_MS;
+  strcpy(conf->info_type, "all");
+  strcpy(conf->acquisition, "auto");
+  fake_latency_parse("exp:5", &conf->profile.call_latency);
+  fake_latency_parse("fixed:20", &conf->profile.connect_latency);
+  conf->profile.offline_uses_timeout = true;
+  conf->profile.seed = 1;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool valid = true;
+
+    if (strncmp(arg, "--machines=", 11) == 0) {
+      conf->machines = atoi(arg + 11);
+      valid = conf->machines > 0;
+    } else if (strncmp(arg, "--cycles=", 9) == 0) {
+      conf->cycles = atoi(arg + 9);
+      valid = conf->cycles > 0;
+    } else if (strncmp(arg, "--threads=", 10) == 0) {
+      conf->threads = atoi(arg + 10);
+      valid = conf->threads >= 0;
+    } else if (strncmp(arg, "--deadline=", 11) == 0) {
+      conf->deadline_ms = atoi(arg + 11);
+      valid = conf->deadline_ms >= 0;
+    } else if (strncmp(arg, "--info=", 7) == 0) {
+      strncpy(conf->info_type, arg + 7, sizeof(conf->info_type) - 1);
+    } else if (strncmp(arg, "--fields=", 9) == 0) {
+      strncpy(conf->fields, arg + 9, sizeof(conf->fields) - 1);
+    } else if (strncmp(arg, "--acquisition=", 14) == 0) {
+      strncpy(conf->acquisition, arg + 14, sizeof(conf->acquisition) - 1);
+    } else if (strncmp(arg, "--latency=", 10) == 0) {
+      valid = fake_latency_parse(arg + 10, &conf->profile.call_latency);
+    } else if (strncmp(arg, "--connect-latency=", 18) == 0) {
+      valid = fake_latency_parse(arg + 18, &conf->profile.connect_latency);
+    } else if (strncmp(arg, "--offline-latency=", 18) == 0) {
+      valid = fake_latency_parse(arg + 18, &conf->profile.offline_latency);
+      conf->profile.offline_uses_timeout = false;
+    } else if (strncmp(arg, "--error-rate=", 13) == 0) {
+      conf->profile.error_rate = atof(arg + 13);
+      valid = conf->profile.error_rate >= 0 && conf->profile.error_rate <= 1;
+    } else if (strncmp(arg, "--offline=", 10) == 0) {
+      conf->profile.offline_count = atoi(arg + 10);
+      valid = conf->profile.offline_count >= 0;
+    } else if (strncmp(arg, "--script=", 9) == 0) {
+      strncpy(conf->script, arg + 9, sizeof(conf->script) - 1);
+    } else if (strncmp(arg, "--seed=", 7) == 0) {
+      conf->profile.seed = (unsigned int) strtoul(arg + 7, NULL, 10);
+    } else if (strcmp(arg, "--verbose") == 0) {
+      conf->verbose = true;
+    } else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+      return 1;
+    } else {
+      valid = false;
+    }
+
+    if (!valid) {
+      fprintf(stderr, "Error: Invalid option '%s'\n", arg);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+// The pool reports every connect and failed read on stdout; without --verbose
+// that is sent to /dev/null while the benchmark runs
+static int silence_stdout(void) {
+  fflush(stdout);
+  int saved = dup(STDOUT_FILENO);
+  int null_fd = open("/dev/null", O_WRONLY);
+  if (saved < 0 || null_fd < 0) {
+    return saved;
+  }
+  dup2(null_fd, STDOUT_FILENO);
+  close(null_fd);
+  return saved;
+}
+
+static void restore_stdout(int saved) {
+  if (saved < 0) {
+    return;
+  }
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+}
+
+static void print_summary_row(const char *label,
+                              const LatencyHistogram *histogram) {
+  LatencySummary summary;
+  latency_histogram_summarize(histogram, &summary);
+  printf("  %-16s %7u %6u %8.2f %8.2f %8.2f %8.2f\n", label, summary.count,
+         summary.errors, summary.p50_ms, summary.p90_ms, summary.p99_ms,
+         summary.max_ms);
+}
+
+int main(int argc, char *argv[]) {
+  BenchConfig conf;
+  int parsed = parse_bench_args(argc, argv, &conf);
+  if (parsed != 0) {
+    show_bench_usage(argv[0]);
+    return parsed > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  // Compile the acquisition plan exactly as focasmonitor does
+  AcquisitionPlan plan = acquisition_plan_for_info(conf.info_type);
+  if (conf.fields[0] != '\0' && !acquisition_plan_parse(conf.fields, &plan)) {
+    fprintf(stderr, "Error: Invalid --fields list '%s'\n", conf.fields);
+    return EXIT_FAILURE;
+  }
+  AcquisitionMode mode;
+  if (!acquisition_mode_parse(conf.acquisition, &mode)) {
+    fprintf(stderr, "Error: Invalid --acquisition mode '%s'\n",
+            conf.acquisition);
+    return EXIT_FAILURE;
+  }
+  plan = acquisition_plan_apply_mode(plan, mode);
+
+  fake_focas_configure(&conf.profile);
+  if (conf.script[0] != '\0' && !fake_focas_load_script(conf.script)) {
+    return EXIT_FAILURE;
+  }
+
+  ConnectionPool pool;
+  MultiMachineInfo multi_info;
+  connection_pool_init(&pool);
+  multi_machine_info_init(&multi_info);
+  pool.plan = plan;
+  pool.probe_ports = false; // Simulated controllers have no ports to probe
+  pool.cycle_deadline_ms = conf.deadline_ms;
+
+  int saved_stdout = conf.verbose ? -1 : silence_stdout();
+
+  for (int i = 0; i < conf.machines; i++) {
+    char name[32];
+    char ip[32];
+    snprintf(name, sizeof(name), "bench-%d", i);
+    fake_focas_machine_ip(i, ip, sizeof(ip));
+    if (connection_pool_add_machine(&pool, name, ip, 8193) != FOCAS_OK) {
+      restore_stdout(saved_stdout);
+      fprintf(stderr, "Error: Failed to add machine %d\n", i);
+      connection_pool_cleanup(&pool);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Workers first, so machines connect concurrently as in focasmonitor
+  connection_pool_start_workers(&pool, conf.threads);
+  double connect_started = platform_monotonic_ms();
+  connection_pool_connect_all(&pool, false, 0);
+  double connect_ms = platform_monotonic_ms() - connect_started;
+
+  int threads = pool.collector ? collector_thread_count(pool.collector) : 1;
+
+  // Time each collection cycle; read counters only count fresh reads, not
+  // machines published from cache
+  LatencyHistogram cycles;
+  memset(&cycles, 0, sizeof(cycles));
+  int reads_before = pool.successful_operations;
+  int failures_before = pool.failed_operations;
+  int late_reads = 0;
+  double run_started = platform_monotonic_ms();
+  for (int c = 0; c < conf.cycles; c++) {
+    double cycle_started = platform_monotonic_ms();
+    connection_pool_read_all_info(&pool, &multi_info);
+    latency_histogram_add(&cycles, platform_monotonic_ms() - cycle_started,
+                          multi_info.late_reads > 0);
+    late_reads += multi_info.late_reads;
+  }
+  double run_ms = platform_monotonic_ms() - run_started;
+
+  // Let late reads finish so the counters and histograms are final
+  connection_pool_stop_workers(&pool);
+  restore_stdout(saved_stdout);
+
+  int reads = pool.successful_operations - reads_before;
+  int failures = pool.failed_operations - failures_before;
+
+  LatencyHistogram calls[FOCAS_FN_COUNT];
+  memset(calls, 0, sizeof(calls));
+  for (int i = 0; i < pool.machine_count; i++) {
+    for (int f = 0; f < FOCAS_FN_COUNT; f++) {
+      latency_histogram_merge(&calls[f], &pool.machines[i]->latency[f]);
+    }
+  }
+
+  char plan_desc[128];
+  char latency_desc[64];
+  acquisition_plan_describe(plan, plan_desc, sizeof(plan_desc));
+  fake_latency_describe(&conf.profile.call_latency, latency_desc,
+                        sizeof(latency_desc));
+
+  printf("=== FOCAS Bench ===\n");
+  printf("Machines: %d (%d offline)\n", conf.machines,
+         conf.profile.offline_count);
+  printf("Worker threads: %d\n", threads);
+  printf("Acquisition plan: %s (%d FOCAS calls per machine)\n", plan_desc,
+         acquisition_plan_call_count(plan));
+  printf("Read latency: %s, error rate %.3f\n", latency_desc,
+         conf.profile.error_rate);
+  if (conf.deadline_ms > 0) {
+    printf("Cycle deadline: %d ms\n", conf.deadline_ms);
+  }
+  printf("\nConnect all: %.1f ms\n", connect_ms);
+  printf("Cycles: %d in %.1f ms\n", conf.cycles, run_ms);
+  printf("Throughput: %.1f machine-reads/s (%d reads, %d failed, %d late)\n",
+         run_ms > 0 ? reads * 1000.0 / run_ms : 0.0, reads, failures,
+         late_reads);
+
+  printf("\nLatency (ms):\n");
+  printf("  %-16s %7s %6s %8s %8s %8s %8s\n", "", "Count", "Errors", "p50",
+         "p90", "p99", "Max");
+  print_summary_row("cycle", &cycles);
+  for (int f = 0; f < FOCAS_FN_COUNT; f++) {
+    if (calls[f].count > 0) {
+      print_summary_row(focas_function_name((FocasFunction) f), &calls[f]);
+    }
+  }
+
+  // One line of key=value pairs for scripts sweeping thread counts
+  LatencySummary cycle;
+  latency_histogram_summarize(&cycles, &cycle);
+  printf("\nRESULT machines=%d threads=%d cycles=%d connect_ms=%.1f "
+         "cycle_p50_ms=%.2f cycle_p90_ms=%.2f cycle_p99_ms=%.2f "
+         "cycle_max_ms=%.2f reads_per_s=%.1f failed=%d late=%d\n",
+         conf.machines, threads, conf.cycles, connect_ms, cycle.p50_ms,
+         cycle.p90_ms, cycle.p99_ms, cycle.max_ms,
+         run_ms > 0 ? reads * 1000.0 / run_ms : 0.0, failures, late_reads);
+
+  multi_machine_info_free(&multi_info);
+  saved_stdout = conf.verbose ? -1 : silence_stdout();
+  connection_pool_cleanup(&pool);
+  restore_stdout(saved_stdout);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,704 @@
+#include "fake_latency.h"
+#include "platform.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// focas_sim serves simulated controllers over the FOCAS Ethernet protocol, one
+// per TCP port, so the unmodified FANUC library can be driven end to end.
+//
+// The protocol is not published; the framing below was worked out against
+// libfwlib32-linux-x64.so.1.0.5 using the trace the library writes with
+// cnc_startupprocess(3, ...). All values are big-endian.
+//
+//   PDU              A0 A0 A0 A0 | version (1) | type | direction | length
+//                    (4, 2, 1, 1 and 2 bytes), then length bytes of body.
+//                    direction is 1 for requests and 2 for responses.
+//   type 0x01        Initiate. A session opens two sockets and sends body
+//                    00 01 on the first and 00 02 on the second; the reply
+//                    body is 16 bytes. The library opens one session per
+//                    process and controller and shares it between every
+//                    handle allocated to that controller.
+//   type 0x02        Close, empty in both directions.
+//   type 0x21        Data: block count (2 bytes), then the blocks.
+//   request block    length (28) | 00 01 | 00 01 | function | 5 x int32 args
+//   response block   length | the 6 bytes before the args | result (int16,
+//                    the EW_* code the call returns) | 4 reserved bytes |
+//                    data length | data
+//
+// One FOCAS call can send several blocks (cnc_statinfo sends functions 0x19,
+// 0xe1 and 0x98) and the library checks that every one is answered. The
+// payloads of cnc_statinfo, cnc_rdprgnum, cnc_rdseqnum, cnc_alarm and
+// cnc_rdcncid are simulated (numbers are 32 bits wide on the wire); every
+// other block is answered with no data, which the library returns as EW_OK
+// with a zeroed structure. The system information a CNC
+// sends in reply to the connect-time query is not reproduced either, so
+// cnc_sysinfo reports zeros and calls the library gates on the CNC type
+// (cnc_rddynamic2) return EW_NOOPT without reaching the network.
+
+#define SIM_DEFAULT_MACHINES 100
+#define SIM_DEFAULT_PORT 8193
+#define SIM_BUFFER_SIZE 4096
+#define SIM_PDU_HEADER_SIZE 10
+#define SIM_BLOCK_HEADER_SIZE 16
+#define SIM_INITIATE_BODY_SIZE 16
+
+// PDU types and directions
+#define PDU_INITIATE 0x01
+#define PDU_CLOSE 0x02
+#define PDU_DATA 0x21
+#define PDU_REQUEST 0x01
+#define PDU_RESPONSE 0x02
+
+// Functions whose payloads are simulated
+#define FN_STATINFO 0x0019 // aut, run, motion, mstb, emergency, alarm, edit
+#define FN_STATINFO_HDCK 0x00e1
+#define FN_STATINFO_TMMODE 0x0098
+#define FN_ALARM 0x001a
+#define FN_PRGNUM 0x001c
+#define FN_SEQNUM 0x001d
+#define FN_CNCID 0x00e8
+
+typedef struct {
+  char bind_address[64];
+  int base_port;
+  int machines;
+  FakeLatency latency;
+  double loss;
+  int max_sessions;
+  int stats_interval;
+  unsigned int seed;
+} SimConfig;
+
+typedef struct {
+  int listen_fd;
+  int sessions; // Open sessions (first sockets past initiate)
+} SimMachine;
+
+typedef struct {
+  int fd;
+  int machine;
+  int channel; // 1 or 2 once initiated
+  unsigned int rng;
+  unsigned char in[SIM_BUFFER_SIZE];
+  int in_len;
+  unsigned char out[SIM_BUFFER_SIZE];
+  int out_len; // Pending response, 0 if none
+  int out_sent;
+  double due_ms; // platform_monotonic_ms() time the response goes out
+  bool close_after_send;
+  unsigned long requests;
+} SimConnection;
+
+typedef struct {
+  unsigned long accepted;
+  unsigned long rejected;
+  unsigned long requests;
+  unsigned long dropped;
+  unsigned long protocol_errors;
+} SimStats;
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static SimConfig conf;
+static SimMachine *machines;
+static SimConnection **connections;
+static int connection_count;
+static int connection_capacity;
+static SimStats stats;
+static unsigned int connect_count;
+
+static void handle_stop_signal(int sig) {
+  (void) sig;
+  stop_requested = 1;
+}
+
+static void show_sim_usage(const char *program_name) {
+  printf("FOCAS Sim - FOCAS Ethernet controller simulator\n\n");
+  printf("Usage: %s [options]\n\n", program_name);
+  printf("Options:\n");
+  printf("  --machines=<count>      Simulated controllers, one per port "
+         "(default: %d)\n",
+         SIM_DEFAULT_MACHINES);
+  printf("  --port=<port>           First port (default: %d)\n",
+         SIM_DEFAULT_PORT);
+  printf("  --bind=<address>        Listen address (default: 127.0.0.1)\n");
+  printf("  --latency=<dist>        Response latency (default: fixed:2)\n");
+  printf("  --loss=<fraction>       Share of responses never sent (default: "
+         "0)\n");
+  printf("  --max-sessions=<count>  Sessions each controller accepts; further "
+         "connects\n");
+  printf("                          are refused (default: 0 = no limit)\n");
+  printf("  --stats=<seconds>       Print counters this often (default: 0 = "
+         "on exit)\n");
+  printf("  --seed=<n>              Random seed (default: 1)\n");
+  printf("  --help                  Show this help message\n\n");
+  printf("Distributions: fixed:<ms>, uniform:<min>:<max>, exp:<mean>,\n");
+  printf("               lognormal:<median>:<sigma>\n\n");
+  printf("Controller n listens on port+n and behaves like machine n of the "
+         "mock\nlibrary: every fifth is idle and every seventeenth in "
+         "alarm.\n");
+}
+
+static int parse_sim_args(int argc, char *argv[]) {
+  memset(&conf, 0, sizeof(SimConfig));
+  strcpy(conf.bind_address, "127.0.0.1");
+  conf.base_port = SIM_DEFAULT_PORT;
+  conf.machines = SIM_DEFAULT_MACHINES;
+  fake_latency_parse("fixed:2", &conf.latency);
+  conf.seed = 1;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool valid = true;
+
+    if (strncmp(arg, "--machines=", 11) == 0) {
+      conf.machines = atoi(arg + 11);
+      valid = conf.machines > 0;
+    } else if (strncmp(arg, "--port=", 7) == 0) {
+      conf.base_port = atoi(arg + 7);
+      valid = conf.base_port > 0;
+    } else if (strncmp(arg, "--bind=", 7) == 0) {
+      strncpy(conf.bind_address, arg + 7, sizeof(conf.bind_address) - 1);
+    } else if (strncmp(arg, "--latency=", 10) == 0) {
+      valid = fake_latency_parse(arg + 10, &conf.latency);
+    } else if (strncmp(arg, "--loss=", 7) == 0) {
+      conf.loss = atof(arg + 7);
+      valid = conf.loss >= 0 && conf.loss <= 1;
+    } else if (strncmp(arg, "--max-sessions=", 15) == 0) {
+      conf.max_sessions = atoi(arg + 15);
+      valid = conf.max_sessions >= 0;
+    } else if (strncmp(arg, "--stats=", 8) == 0) {
+      conf.stats_interval = atoi(arg + 8);
+      valid = conf.stats_interval >= 0;
+    } else if (strncmp(arg, "--seed=", 7) == 0) {
+      conf.seed = (unsigned int) strtoul(arg + 7, NULL, 10);
+    } else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+      return 1;
+    } else {
+      valid = false;
+    }
+
+    if (!valid) {
+      fprintf(stderr, "Error: Invalid option '%s'\n", arg);
+      return -1;
+    }
+  }
+
+  if (conf.base_port + conf.machines - 1 > 65535) {
+    fprintf(stderr, "Error: Ports %d-%d are out of range\n", conf.base_port,
+            conf.base_port + conf.machines - 1);
+    return -1;
+  }
+  return 0;
+}
+
+static void put_u16(unsigned char *buffer, int value) {
+  buffer[0] = (unsigned char) ((value >> 8) & 0xff);
+  buffer[1] = (unsigned char) (value & 0xff);
+}
+
+static void put_u32(unsigned char *buffer, unsigned long value) {
+  put_u16(buffer, (int) ((value >> 16) & 0xffff));
+  put_u16(buffer + 2, (int) (value & 0xffff));
+}
+
+static int get_u16(const unsigned char *buffer) {
+  return (buffer[0] << 8) | buffer[1];
+}
+
+// Every socket needs a descriptor: one listener per controller plus two per
+// session, well past the usual soft limit of 1024
+static void raise_descriptor_limit(void) {
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0
+      && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+}
+
+static bool set_nonblocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool open_listeners(void) {
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  if (inet_pton(AF_INET, conf.bind_address, &address.sin_addr) != 1) {
+    fprintf(stderr, "Error: Invalid bind address '%s'\n", conf.bind_address);
+    return false;
+  }
+
+  for (int i = 0; i < conf.machines; i++) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    machines[i].listen_fd = fd;
+    if (fd < 0) {
+      fprintf(stderr, "Error: Cannot create socket for port %d: %s\n",
+              conf.base_port + i, strerror(errno));
+      return false;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    address.sin_port = htons((unsigned short) (conf.base_port + i));
+    if (bind(fd, (struct sockaddr *) &address, sizeof(address)) != 0
+        || listen(fd, SOMAXCONN) != 0 || !set_nonblocking(fd)) {
+      fprintf(stderr, "Error: Cannot listen on %s:%d: %s\n",
+              conf.bind_address, conf.base_port + i, strerror(errno));
+      return false;
+    }
+  }
+  return true;
+}
+
+static void add_connection(int fd, int machine) {
+  if (connection_count == connection_capacity) {
+    int capacity = connection_capacity > 0 ? connection_capacity * 2 : 64;
+    SimConnection **grown =
+        realloc(connections, (size_t) capacity * sizeof(SimConnection *));
+    if (!grown) {
+      close(fd);
+      return;
+    }
+    connections = grown;
+    connection_capacity = capacity;
+  }
+
+  SimConnection *connection = calloc(1, sizeof(SimConnection));
+  if (!connection) {
+    close(fd);
+    return;
+  }
+
+  int nodelay = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+  set_nonblocking(fd);
+
+  connection->fd = fd;
+  connection->machine = machine;
+  connection->rng = conf.seed ^ (2654435761u * ++connect_count);
+  if (connection->rng == 0) {
+    connection->rng = 1;
+  }
+  connections[connection_count++] = connection;
+  stats.accepted++;
+}
+
+static void close_connection(int index) {
+  SimConnection *connection = connections[index];
+  if (connection->channel == 1) {
+    machines[connection->machine].sessions--;
+  }
+  close(connection->fd);
+  free(connection);
+  connections[index] = connections[--connection_count];
+}
+
+// Every fifth controller is idle and every seventeenth in alarm, matching the
+// mock library's machines. The sequence number advances with every request
+// the connection serves.
+static int sim_block_data(const SimConnection *connection, int function,
+                          unsigned char *data) {
+  int machine = connection->machine;
+  bool alarm = machine % 17 == 16;
+  bool running = !alarm && machine % 5 != 4;
+
+  switch (function) {
+    case FN_STATINFO:
+      memset(data, 0, 14);
+      put_u16(data, 1);
+      put_u16(data + 2, alarm ? 3 : (running ? 1 : 0));
+      put_u16(data + 4, running ? 1 : 0);
+      put_u16(data + 10, alarm ? 1 : 0);
+      return 14;
+    case FN_STATINFO_HDCK:
+    case FN_STATINFO_TMMODE:
+      put_u16(data, 0);
+      return 2;
+    case FN_ALARM:
+      put_u32(data, alarm ? 1 : 0);
+      return 4;
+    case FN_PRGNUM:
+      put_u32(data, (unsigned long) (1000 + machine % 9000));
+      put_u32(data + 4, (unsigned long) (1000 + machine % 9000));
+      return 8;
+    case FN_SEQNUM:
+      put_u32(data, running ? connection->requests % 10000 : 0);
+      return 4;
+    case FN_CNCID:
+      put_u32(data, 0xbe4c0000ul | (unsigned long) machine);
+      put_u32(data + 4, 0x0000fa0cul);
+      put_u32(data + 8, 0x00000031ul);
+      put_u32(data + 12, (unsigned long) machine);
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+// Answer every block of a data request; false if the request is malformed or
+// the answer does not fit
+static bool build_data_response(const SimConnection *connection,
+                                const unsigned char *body, int length,
+                                unsigned char *out, int *out_length) {
+  int written = 2;
+
+  if (length == 0) {
+    // Connect-time query: the library accepts one empty block
+    put_u16(out, 1);
+    memset(out + 2, 0, 8);
+    put_u16(out + 2, 8);
+    *out_length = 10;
+    return true;
+  }
+  if (length < 2) {
+    return false;
+  }
+
+  int count = get_u16(body);
+  int offset = 2;
+  put_u16(out, count);
+
+  for (int b = 0; b < count; b++) {
+    if (offset + 8 > length) {
+      return false;
+    }
+    const unsigned char *block = body + offset;
+    int block_length = get_u16(block);
+    if (block_length < 8 || offset + block_length > length) {
+      return false;
+    }
+    offset += block_length;
+
+    unsigned char data[64];
+    int data_length = sim_block_data(connection, get_u16(block + 6), data);
+    int response_length = SIM_BLOCK_HEADER_SIZE + data_length;
+    if (written + response_length > SIM_BUFFER_SIZE - SIM_PDU_HEADER_SIZE) {
+      return false;
+    }
+
+    unsigned char *response = out + written;
+    memset(response, 0, SIM_BLOCK_HEADER_SIZE);
+    put_u16(response, response_length);
+    memcpy(response + 2, block + 2, 6);
+    put_u16(response + 14, data_length);
+    memcpy(response + SIM_BLOCK_HEADER_SIZE, data, (size_t) data_length);
+    written += response_length;
+  }
+
+  *out_length = written;
+  return true;
+}
+
+// Handle the PDU at the start of the input buffer. Returns the bytes
+// consumed, 0 if the PDU is incomplete or -1 to drop the connection.
+static int handle_pdu(SimConnection *connection) {
+  const unsigned char *pdu = connection->in;
+  if (connection->in_len < SIM_PDU_HEADER_SIZE) {
+    return 0;
+  }
+  if (pdu[0] != 0xa0 || pdu[1] != 0xa0 || pdu[2] != 0xa0 || pdu[3] != 0xa0
+      || pdu[7] != PDU_REQUEST) {
+    stats.protocol_errors++;
+    return -1;
+  }
+
+  int length = get_u16(pdu + 8);
+  if (SIM_PDU_HEADER_SIZE + length > SIM_BUFFER_SIZE) {
+    stats.protocol_errors++;
+    return -1;
+  }
+  if (connection->in_len < SIM_PDU_HEADER_SIZE + length) {
+    return 0;
+  }
+
+  const unsigned char *body = pdu + SIM_PDU_HEADER_SIZE;
+  unsigned char *out = connection->out;
+  int out_length = 0;
+
+  switch (pdu[6]) {
+    case PDU_INITIATE: {
+      int channel = length >= 2 ? get_u16(body) : 1;
+      if (channel == 1) {
+        SimMachine *machine = &machines[connection->machine];
+        if (conf.max_sessions > 0 && machine->sessions >= conf.max_sessions) {
+          stats.rejected++;
+          return -1;
+        }
+        machine->sessions++;
+      }
+      connection->channel = channel;
+      out_length = SIM_INITIATE_BODY_SIZE;
+      memset(out + SIM_PDU_HEADER_SIZE, 0, SIM_INITIATE_BODY_SIZE);
+      break;
+    }
+    case PDU_CLOSE:
+      connection->close_after_send = true;
+      break;
+    case PDU_DATA:
+      if (!build_data_response(connection, body, length,
+                               out + SIM_PDU_HEADER_SIZE, &out_length)) {
+        stats.protocol_errors++;
+        return -1;
+      }
+      break;
+    default:
+      stats.protocol_errors++;
+      return -1;
+  }
+
+  stats.requests++;
+  connection->requests++;
+  memcpy(out, pdu, 6);
+  out[6] = pdu[6];
+  out[7] = PDU_RESPONSE;
+  put_u16(out + 8, out_length);
+
+  if (conf.loss > 0 && fake_random(&connection->rng) < conf.loss) {
+    // Lost on the wire: the library waits for its timeout
+    stats.dropped++;
+    connection->out_len = 0;
+  } else {
+    connection->out_len = SIM_PDU_HEADER_SIZE + out_length;
+    connection->out_sent = 0;
+    connection->due_ms = platform_monotonic_ms()
+                         + fake_latency_sample(&conf.latency, &connection->rng);
+  }
+  return SIM_PDU_HEADER_SIZE + length;
+}
+
+// Read what the peer sent and start on the next request. Returns false when
+// the connection should be closed.
+static bool service_input(SimConnection *connection) {
+  ssize_t received =
+      recv(connection->fd, connection->in + connection->in_len,
+           (size_t) (SIM_BUFFER_SIZE - connection->in_len), 0);
+  if (received == 0) {
+    return false;
+  }
+  if (received < 0) {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  }
+  connection->in_len += (int) received;
+
+  // The library waits for each answer, so one request is served at a time
+  while (connection->out_len == 0) {
+    int consumed = handle_pdu(connection);
+    if (consumed < 0) {
+      return false;
+    }
+    if (consumed == 0) {
+      break;
+    }
+    connection->in_len -= consumed;
+    memmove(connection->in, connection->in + consumed,
+            (size_t) connection->in_len);
+    if (connection->close_after_send && connection->out_len == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool service_output(SimConnection *connection) {
+  ssize_t sent = send(connection->fd, connection->out + connection->out_sent,
+                      (size_t) (connection->out_len - connection->out_sent),
+                      MSG_NOSIGNAL);
+  if (sent < 0) {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  }
+  connection->out_sent += (int) sent;
+  if (connection->out_sent < connection->out_len) {
+    return true;
+  }
+
+  connection->out_len = 0;
+  if (connection->close_after_send) {
+    return false;
+  }
+
+  // Serve a request that arrived while this one was delayed
+  int consumed = connection->in_len > 0 ? handle_pdu(connection) : 0;
+  if (consumed < 0) {
+    return false;
+  }
+  connection->in_len -= consumed;
+  memmove(connection->in, connection->in + consumed,
+          (size_t) connection->in_len);
+  return true;
+}
+
+static void accept_connections(int machine) {
+  for (;;) {
+    int fd = accept(machines[machine].listen_fd, NULL, NULL);
+    if (fd < 0) {
+      if (errno == EMFILE || errno == ENFILE) {
+        fprintf(stderr, "Warning: Out of file descriptors\n");
+      }
+      return;
+    }
+    add_connection(fd, machine);
+  }
+}
+
+static void print_stats(void) {
+  int sessions = 0;
+  for (int i = 0; i < conf.machines; i++) {
+    sessions += machines[i].sessions;
+  }
+  printf("Sockets open: %d, sessions open: %d, accepted: %lu, refused: %lu, "
+         "requests: %lu, dropped: %lu, protocol errors: %lu\n",
+         connection_count, sessions, stats.accepted, stats.rejected,
+         stats.requests, stats.dropped, stats.protocol_errors);
+  fflush(stdout);
+}
+
+static void run_event_loop(void) {
+  struct pollfd *fds = NULL;
+  int fds_capacity = 0;
+  double next_stats_ms =
+      platform_monotonic_ms() + conf.stats_interval * 1000.0;
+
+  while (!stop_requested) {
+    int needed = conf.machines + connection_count;
+    if (needed > fds_capacity) {
+      struct pollfd *grown = realloc(fds, (size_t) needed * sizeof(*fds));
+      if (!grown) {
+        fprintf(stderr, "Error: Out of memory\n");
+        break;
+      }
+      fds = grown;
+      fds_capacity = needed;
+    }
+
+    // Listeners first, then one entry per connection; a connection with a
+    // response still waiting for its latency to pass is not polled
+    double now = platform_monotonic_ms();
+    double wake_ms = now + 1000.0;
+    for (int i = 0; i < conf.machines; i++) {
+      fds[i].fd = machines[i].listen_fd;
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+    }
+    for (int c = 0; c < connection_count; c++) {
+      SimConnection *connection = connections[c];
+      struct pollfd *entry = &fds[conf.machines + c];
+      entry->fd = connection->fd;
+      entry->revents = 0;
+      if (connection->out_len == 0) {
+        entry->events = POLLIN;
+      } else if (connection->due_ms <= now) {
+        entry->events = POLLOUT;
+      } else {
+        entry->events = 0;
+        if (connection->due_ms < wake_ms) {
+          wake_ms = connection->due_ms;
+        }
+      }
+    }
+    if (conf.stats_interval > 0 && next_stats_ms < wake_ms) {
+      wake_ms = next_stats_ms;
+    }
+
+    int timeout_ms = wake_ms > now ? (int) (wake_ms - now) + 1 : 0;
+    int polled_connections = connection_count;
+    if (poll(fds, (nfds_t) needed, timeout_ms) < 0 && errno != EINTR) {
+      fprintf(stderr, "Error: poll failed: %s\n", strerror(errno));
+      break;
+    }
+
+    // Walk backwards so closing (which moves the last connection into the
+    // freed slot) does not skip anyone
+    for (int c = polled_connections - 1; c >= 0; c--) {
+      SimConnection *connection = connections[c];
+      short revents = fds[conf.machines + c].revents;
+      bool keep = true;
+
+      if (revents & (POLLERR | POLLNVAL)) {
+        keep = false;
+      } else if (revents & POLLOUT) {
+        keep = service_output(connection);
+      } else if (revents & (POLLIN | POLLHUP)) {
+        keep = service_input(connection);
+      }
+      if (!keep) {
+        close_connection(c);
+      }
+    }
+
+    for (int i = 0; i < conf.machines; i++) {
+      if (fds[i].revents & POLLIN) {
+        accept_connections(i);
+      }
+    }
+
+    if (conf.stats_interval > 0 && platform_monotonic_ms() >= next_stats_ms) {
+      print_stats();
+      next_stats_ms += conf.stats_interval * 1000.0;
+    }
+  }
+
+  free(fds);
+}
+
+int main(int argc, char *argv[]) {
+  int parsed = parse_sim_args(argc, argv);
+  if (parsed != 0) {
+    show_sim_usage(argv[0]);
+    return parsed > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  machines = calloc((size_t) conf.machines, sizeof(SimMachine));
+  if (!machines) {
+    fprintf(stderr, "Error: Out of memory\n");
+    return EXIT_FAILURE;
+  }
+  for (int i = 0; i < conf.machines; i++) {
+    machines[i].listen_fd = -1;
+  }
+
+  raise_descriptor_limit();
+  signal(SIGINT, handle_stop_signal);
+  signal(SIGTERM, handle_stop_signal);
+
+  int status = EXIT_SUCCESS;
+  if (open_listeners()) {
+    char latency_desc[64];
+    fake_latency_describe(&conf.latency, latency_desc, sizeof(latency_desc));
+    printf("Simulating %d controllers on %s:%d-%d (latency %s, loss %.3f)\n",
+           conf.machines, conf.bind_address, conf.base_port,
+           conf.base_port + conf.machines - 1, latency_desc, conf.loss);
+    printf("Press Ctrl+C to stop...\n");
+    fflush(stdout);
+    run_event_loop();
+    print_stats();
+  } else {
+    status = EXIT_FAILURE;
+  }
+
+  while (connection_count > 0) {
+    close_connection(connection_count - 1);
+  }
+  for (int i = 0; i < conf.machines; i++) {
+    if (machines[i].listen_fd >= 0) {
+      close(machines[i].listen_fd);
+    }
+  }
+  free(connections);
+  free(machines);
+  return status;
+}
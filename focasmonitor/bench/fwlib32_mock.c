@@ -0,0 +1,76 @@
+#include "fake_focas.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fwlib32.h"
+
+// Drop-in libfwlib32.so.1 built from the simulated controllers in
+// fake_focas.c. Point LD_LIBRARY_PATH at it and focasmonitor, examples/c or
+// any other FOCAS client runs against as many machines as it is given, with
+// the behaviour taken from the environment:
+//
+//   FWLIB_MOCK_LATENCY          Read latency (default: exp:5)
+//   FWLIB_MOCK_CONNECT_LATENCY  Successful connect latency (default: fixed:20)
+//   FWLIB_MOCK_OFFLINE_LATENCY  Offline connect latency (default: the timeout
+//                               passed to cnc_allclibhndl3)
+//   FWLIB_MOCK_ERROR_RATE       Share of reads failing with EW_SOCKET
+//   FWLIB_MOCK_OFFLINE          Machines 0..n-1 never answer
+//   FWLIB_MOCK_SEED             Random seed (default: 1)
+//   FWLIB_MOCK_SCRIPT           Per-machine script file (see fake_focas.h)
+
+static void mock_read_latency(const char *name, FakeLatency *latency) {
+  const char *value = getenv(name);
+  if (value && !fake_latency_parse(value, latency)) {
+    fprintf(stderr, "fwlib32 mock: Ignoring invalid %s '%s'\n", name, value);
+  }
+}
+
+__attribute__((constructor)) static void mock_configure(void) {
+  FakeFocasProfile profile;
+  memset(&profile, 0, sizeof(FakeFocasProfile));
+  fake_latency_parse("exp:5", &profile.call_latency);
+  fake_latency_parse("fixed:20", &profile.connect_latency);
+  profile.offline_uses_timeout = true;
+  profile.seed = 1;
+
+  mock_read_latency("FWLIB_MOCK_LATENCY", &profile.call_latency);
+  mock_read_latency("FWLIB_MOCK_CONNECT_LATENCY", &profile.connect_latency);
+  if (getenv("FWLIB_MOCK_OFFLINE_LATENCY")) {
+    profile.offline_uses_timeout = false;
+    mock_read_latency("FWLIB_MOCK_OFFLINE_LATENCY", &profile.offline_latency);
+  }
+
+  const char *value = getenv("FWLIB_MOCK_ERROR_RATE");
+  if (value) {
+    profile.error_rate = atof(value);
+  }
+  value = getenv("FWLIB_MOCK_OFFLINE");
+  if (value) {
+    profile.offline_count = atoi(value);
+  }
+  value = getenv("FWLIB_MOCK_SEED");
+  if (value) {
+    profile.seed = (unsigned int) strtoul(value, NULL, 10);
+  }
+
+  fake_focas_configure(&profile);
+
+  value = getenv("FWLIB_MOCK_SCRIPT");
+  if (value && !fake_focas_load_script(value)) {
+    fprintf(stderr, "fwlib32 mock: Continuing without machine script\n");
+    fake_focas_configure(&profile);
+  }
+}
+
+// Process-wide logging setup in the real library; nothing to do here
+short cnc_startupprocess(long level, const char *filename) {
+  (void) level;
+  (void) filename;
+  return EW_OK;
+}
+
+short cnc_exitprocess(void) {
+  return EW_OK;
+}
@@ -0,0 +1,573 @@
+#include "focasmonitor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Include the official FANUC header
+#include "fwlib32.h"
+
+// Every FOCAS call is a round trip to the CNC's Ethernet board, so a read only
+// issues the calls its acquisition plan asks for. Plans are compiled once from
+// the --info view (or an explicit --fields list) and reused for every cycle.
+
+typedef struct {
+  const char *name;
+  AcquisitionField field;
+} AcquisitionFieldName;
+
+static const AcquisitionFieldName field_names[] = {
+    {"id", ACQ_ID},
+    {"program", ACQ_PROGRAM},
+    {"status", ACQ_STATUS},
+    {"sequence", ACQ_SEQUENCE},
+    {"position", ACQ_POSITION},
+    {"speed", ACQ_SPEED},
+    {"alarm", ACQ_ALARM},
+};
+
+#define FIELD_NAME_COUNT (sizeof(field_names) / sizeof(field_names[0]))
+
+AcquisitionPlan acquisition_plan_for_info(const char *info_type) {
+  // Every narrow view shows the machine status next to its own columns
+  if (strcmp(info_type, "basic") == 0) {
+    return ACQ_ID | ACQ_STATUS;
+  } else if (strcmp(info_type, "program") == 0) {
+    return ACQ_PROGRAM | ACQ_SEQUENCE | ACQ_STATUS;
+  } else if (strcmp(info_type, "position") == 0) {
+    return ACQ_POSITION | ACQ_STATUS;
+  } else if (strcmp(info_type, "speed") == 0) {
+    return ACQ_SPEED | ACQ_STATUS;
+  } else if (strcmp(info_type, "alarm") == 0) {
+    return ACQ_ALARM | ACQ_STATUS;
+  }
+  return ACQ_ALL;
+}
+
+bool acquisition_plan_parse(const char *fields, AcquisitionPlan *plan) {
+  AcquisitionPlan parsed = 0;
+  const char *start = fields;
+
+  while (*start) {
+    const char *end = strchr(start, ',');
+    size_t length = end ? (size_t) (end - start) : strlen(start);
+
+    bool known = false;
+    if (length == 3 && strncmp(start, "all", 3) == 0) {
+      parsed |= ACQ_ALL;
+      known = true;
+    }
+    for (size_t i = 0; !known && i < FIELD_NAME_COUNT; i++) {
+      if (strlen(field_names[i].name) == length
+          && strncmp(start, field_names[i].name, length) == 0) {
+        parsed |= field_names[i].field;
+        known = true;
+      }
+    }
+    if (!known) {
+      return false;
+    }
+
+    if (!end) {
+      break;
+    }
+    start = end + 1;
+  }
+
+  if (parsed == 0) {
+    return false;
+  }
+  *plan = parsed;
+  return true;
+}
+
+bool acquisition_mode_parse(const char *mode_str, AcquisitionMode *mode) {
+  if (strcmp(mode_str, "auto") == 0) {
+    *mode = ACQ_MODE_AUTO;
+  } else if (strcmp(mode_str, "dynamic") == 0) {
+    *mode = ACQ_MODE_DYNAMIC;
+  } else if (strcmp(mode_str, "individual") == 0) {
+    *mode = ACQ_MODE_INDIVIDUAL;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static int count_groups(AcquisitionPlan plan) {
+  int count = 0;
+  for (size_t i = 0; i < FIELD_NAME_COUNT; i++) {
+    if (plan & field_names[i].field) {
+      count++;
+    }
+  }
+  return count;
+}
+
+AcquisitionPlan acquisition_plan_apply_mode(AcquisitionPlan plan,
+                                            AcquisitionMode mode) {
+  int dynamic_groups = count_groups(plan & ACQ_DYNAMIC_GROUPS);
+
+  plan &= ~ACQ_USE_DYNAMIC2;
+  if ((mode == ACQ_MODE_DYNAMIC && dynamic_groups > 0)
+      || (mode == ACQ_MODE_AUTO && dynamic_groups > 1)) {
+    plan |= ACQ_USE_DYNAMIC2;
+  }
+  return plan;
+}
+
+// Round trips a plan costs per cycle once the machine identity is cached
+int acquisition_plan_call_count(AcquisitionPlan plan) {
+  AcquisitionPlan individual = plan & ~ACQ_ID;
+  int count = 0;
+
+  if (plan & ACQ_USE_DYNAMIC2) {
+    individual &= ~ACQ_DYNAMIC_GROUPS;
+    count++;
+  }
+  return count + count_groups(individual);
+}
+
+void acquisition_plan_describe(AcquisitionPlan plan, char *buffer,
+                               size_t size) {
+  size_t used = 0;
+
+  buffer[0] = '\0';
+  for (size_t i = 0; i < FIELD_NAME_COUNT && used < size; i++) {
+    if (plan & field_names[i].field) {
+      int written = snprintf(buffer + used, size - used, "%s%s",
+                             used > 0 ? ", " : "", field_names[i].name);
+      if (written < 0) {
+        break;
+      }
+      used += (size_t) written;
+    }
+  }
+}
+
+static bool read_cnc_id(unsigned short handle, char *buffer, size_t size,
+                        LatencyLog *log) {
+  unsigned long cncid[4];
+  double started = platform_monotonic_ms();
+  short result = cnc_rdcncid(handle, cncid);
+  latency_log_add(log, FOCAS_FN_RDCNCID, started, result);
+  if (result != EW_OK) {
+    return false;
+  }
+  snprintf(buffer, size, "%08lx-%08lx-%08lx-%08lx", cncid[0], cncid[1],
+           cncid[2], cncid[3]);
+  return true;
+}
+
+// Copy a fixed-width ASCII field from ODBSYS, dropping padding spaces
+static void copy_sysinfo_field(char *dest, const char *src, size_t length) {
+  size_t start = 0;
+  while (start < length && src[start] == ' ') {
+    start++;
+  }
+  size_t end = length;
+  while (end > start && (src[end - 1] == ' ' || src[end - 1] == '\0')) {
+    end--;
+  }
+  memcpy(dest, src + start, end - start);
+  dest[end - start] = '\0';
+}
+
+FocasResult read_machine_identity(unsigned short handle,
+                                  MachineIdentity *identity, LatencyLog *log) {
+  if (handle == 0 || !identity) {
+    return FOCAS_CONNECTION_FAILED;
+  }
+
+  memset(identity, 0, sizeof(MachineIdentity));
+
+  // The CNC ID is the only part every caller relies on
+  if (!read_cnc_id(handle, identity->cnc_id, sizeof(identity->cnc_id), log)) {
+    return FOCAS_ID_READ_FAILED;
+  }
+
+  ODBSYS sysinfo;
+  double started = platform_monotonic_ms();
+  short result = cnc_sysinfo(handle, &sysinfo);
+  latency_log_add(log, FOCAS_FN_SYSINFO, started, result);
+  if (result == EW_OK) {
+    copy_sysinfo_field(identity->cnc_type, sysinfo.cnc_type,
+                       sizeof(sysinfo.cnc_type));
+    copy_sysinfo_field(identity->mt_type, sysinfo.mt_type,
+                       sizeof(sysinfo.mt_type));
+    copy_sysinfo_field(identity->series, sysinfo.series,
+                       sizeof(sysinfo.series));
+    copy_sysinfo_field(identity->version, sysinfo.version,
+                       sizeof(sysinfo.version));
+    identity->max_axes = sysinfo.max_axis;
+  }
+
+  ODBAXISNAME axes[MAX_AXIS];
+  short axis_count = MAX_AXIS;
+  started = platform_monotonic_ms();
+  result = cnc_rdaxisname(handle, &axis_count, axes);
+  latency_log_add(log, FOCAS_FN_RDAXISNAME, started, result);
+  if (result == EW_OK) {
+    if (axis_count > MACHINE_MAX_AXES) {
+      axis_count = MACHINE_MAX_AXES;
+    }
+    for (int i = 0; i < axis_count; i++) {
+      char *name = identity->axis_names[i];
+      name[0] = axes[i].name;
+      name[1] = (axes[i].suff != ' ') ? axes[i].suff : '\0';
+      name[2] = '\0';
+    }
+    identity->axis_count = axis_count;
+  }
+
+  // cnc_rddynamic2 reports positions as raw increments, so keep each axis'
+  // decimal places to scale them
+  short valid_axes = MAX_AXIS;
+  short decimals_in[MAX_AXIS];
+  short decimals_out[MAX_AXIS];
+  if (identity->axis_count > 0) {
+    started = platform_monotonic_ms();
+    result = cnc_getfigure(handle, 0, &valid_axes, decimals_in, decimals_out);
+    latency_log_add(log, FOCAS_FN_GETFIGURE, started, result);
+    if (result == EW_OK && valid_axes >= identity->axis_count) {
+      for (int i = 0; i < identity->axis_count; i++) {
+        identity->axis_decimals[i] = decimals_in[i];
+      }
+      identity->axis_decimals_valid = true;
+    }
+  }
+
+  ODBSPDLNAME spindles[MAX_SPINDLE];
+  short spindle_count = MAX_SPINDLE;
+  started = platform_monotonic_ms();
+  result = cnc_rdspdlname(handle, &spindle_count, spindles);
+  latency_log_add(log, FOCAS_FN_RDSPDLNAME, started, result);
+  if (result == EW_OK) {
+    if (spindle_count > MACHINE_MAX_SPINDLES) {
+      spindle_count = MACHINE_MAX_SPINDLES;
+    }
+    for (int i = 0; i < spindle_count; i++) {
+      const char suffixes[3] = {spindles[i].suff1, spindles[i].suff2,
+                                spindles[i].suff3};
+      char *name = identity->spindle_names[i];
+      int length = 0;
+      name[length++] = spindles[i].name;
+      for (int j = 0; j < 3 && suffixes[j] != '\0' && suffixes[j] != ' ';
+           j++) {
+        name[length++] = suffixes[j];
+      }
+      name[length] = '\0';
+    }
+    identity->spindle_count = spindle_count;
+  }
+
+  identity->valid = true;
+  identity->answered_ms = platform_monotonic_ms();
+  return FOCAS_OK;
+}
+
+static double scale_position(long value, int decimals) {
+  double scaled = (double) value;
+  for (int i = 0; i < decimals; i++) {
+    scaled /= 10.0;
+  }
+  return scaled;
+}
+
+// Errors that say the connection, not the request, failed
+static bool transport_error(short result) {
+  return result == EW_SOCKET || result == EW_HANDLE || result == EW_BUSY
+         || result == EW_PROTOCOL;
+}
+
+// Fetch every planned dynamic group in one round trip and set filled to the
+// groups read. Returns the FOCAS result. A control that lacks cnc_rddynamic2
+// or rejects the request (e.g. EW_LENGTH, EW_ATTRIB, EW_DATA) is remembered
+// until the next connect, so later cycles go straight to the individual calls.
+static short read_dynamic2(unsigned short handle, MachineIdentity *identity,
+                           AcquisitionPlan plan, MachineInfo *info,
+                           LatencyLog *log, AcquisitionPlan *filled_out) {
+  ODBDY2 dynamic;
+  double started = platform_monotonic_ms();
+  short result = cnc_rddynamic2(handle, ALL_AXES, sizeof(ODBDY2), &dynamic);
+  latency_log_add(log, FOCAS_FN_RDDYNAMIC2, started, result);
+  *filled_out = 0;
+  if (result != EW_OK) {
+    if (!transport_error(result)) {
+      identity->no_dynamic2 = true;
+    }
+    return result;
+  }
+
+  AcquisitionPlan filled = plan & ACQ_DYNAMIC_GROUPS;
+
+  if (plan & ACQ_PROGRAM) {
+    snprintf(info->program_name, sizeof(info->program_name), "O%04ld",
+             dynamic.prgnum);
+    info->program_number = (int) dynamic.prgnum;
+  }
+  if (plan & ACQ_SEQUENCE) {
+    info->sequence_number = dynamic.seqnum;
+    info->program_line = (int) dynamic.seqnum;
+  }
+  if (plan & ACQ_SPEED) {
+    info->speed.feed_rate = (int) dynamic.actf;
+    info->speed.spindle_speed = (int) dynamic.acts;
+  }
+  if (plan & ACQ_ALARM) {
+    info->alarm.alarm_status = (int) dynamic.alarm;
+    info->alarm.has_alarm = (dynamic.alarm != 0) ? 1 : 0;
+  }
+
+  // Positions need the decimal places read at connect
+  if ((plan & ACQ_POSITION) && identity->axis_decimals_valid) {
+    info->position.axis_count = identity->axis_count;
+    for (int i = 0; i < identity->axis_count; i++) {
+      AxisPosition *axis = &info->position.axes[i];
+      int decimals = identity->axis_decimals[i];
+      strcpy(axis->name, identity->axis_names[i]);
+      axis->absolute = scale_position(dynamic.pos.faxis.absolute[i], decimals);
+      axis->relative = scale_position(dynamic.pos.faxis.relative[i], decimals);
+      axis->machine = scale_position(dynamic.pos.faxis.machine[i], decimals);
+      axis->distance = scale_position(dynamic.pos.faxis.distance[i], decimals);
+    }
+  } else {
+    filled &= ~ACQ_POSITION;
+  }
+
+  *filled_out = filled;
+  return EW_OK;
+}
+
+FocasResult read_machine_info_from_handle(unsigned short handle,
+                                          MachineIdentity *identity,
+                                          AcquisitionPlan plan,
+                                          MachineInfo *info, LatencyLog *log) {
+  if (handle == 0 || !info) {
+    return FOCAS_CONNECTION_FAILED;
+  }
+
+  // Initialize info structure
+  memset(info, 0, sizeof(MachineInfo));
+  info->last_updated = time(NULL);
+  info->sampled_ms = platform_monotonic_ms();
+  info->fields = plan & ~(ACQ_USE_DYNAMIC2 | ACQ_LIVENESS);
+
+  // Planned calls issued and answered this cycle
+  int issued = 0;
+  int answered = 0;
+  double started;
+  short result;
+
+  // One cnc_rddynamic2 round trip replaces the individual dynamic reads; any
+  // group it could not fill is read individually below. A control that lacks
+  // the function or rejects the request falls back to the individual calls;
+  // after a transport error they would just fail the same way, one timeout
+  // each.
+  if ((plan & ACQ_USE_DYNAMIC2) && identity && identity->valid
+      && !identity->no_dynamic2) {
+    issued++;
+    AcquisitionPlan filled;
+    result = read_dynamic2(handle, identity, plan, info, log, &filled);
+    if (result == EW_OK) {
+      answered++;
+      plan &= ~filled;
+    } else if (transport_error(result)) {
+      return FOCAS_CONNECTION_FAILED;
+    }
+  }
+
+  // Machine ID comes from the identity cached at connect when available
+  if (plan & ACQ_ID) {
+    if (identity && identity->valid) {
+      strcpy(info->machine_id, identity->cnc_id);
+    } else {
+      issued++;
+      if (read_cnc_id(handle, info->machine_id, sizeof(info->machine_id),
+                      log)) {
+        answered++;
+      } else {
+        strcpy(info->machine_id, "UNKNOWN");
+      }
+    }
+  }
+
+  // Read current program
+  if (plan & ACQ_PROGRAM) {
+    issued++;
+    ODBPRO prgnum;
+    started = platform_monotonic_ms();
+    result = cnc_rdprgnum(handle, &prgnum);
+    latency_log_add(log, FOCAS_FN_RDPRGNUM, started, result);
+    if (result == EW_OK) {
+      snprintf(info->program_name, sizeof(info->program_name), "O%04d",
+               prgnum.data);
+      info->program_number = (int) prgnum.data;
+      answered++;
+    } else {
+      strcpy(info->program_name, "UNKNOWN");
+      info->program_number = 0;
+    }
+  }
+
+  // Read machine status
+  if (plan & ACQ_STATUS) {
+    issued++;
+    ODBST status;
+    started = platform_monotonic_ms();
+    result = cnc_statinfo(handle, &status);
+    latency_log_add(log, FOCAS_FN_STATINFO, started, result);
+    if (result == EW_OK) {
+      info->run_status = status.run;
+      info->motion_status = status.motion;
+      switch (status.run) {
+        case 0:
+          strcpy(info->status, "STOPPED");
+          break;
+        case 1:
+          strcpy(info->status, "RUNNING");
+          break;
+        case 2:
+          strcpy(info->status, "PAUSED");
+          break;
+        case 3:
+          strcpy(info->status, "ALARM");
+          break;
+        default:
+          snprintf(info->status, sizeof(info->status), "UNKNOWN(%d)",
+                   status.run);
+          break;
+      }
+
+      // Add motion status if available
+      if (status.motion == 1) {
+        strncat(info->status, " (MOVING)",
+                sizeof(info->status) - strlen(info->status) - 1);
+      }
+      answered++;
+    } else {
+      strcpy(info->status, "UNKNOWN");
+      info->run_status = -1;
+      info->motion_status = -1;
+    }
+  }
+
+  // Read sequence number
+  if (plan & ACQ_SEQUENCE) {
+    issued++;
+    ODBSEQ seq_info;
+    started = platform_monotonic_ms();
+    result = cnc_rdseqnum(handle, &seq_info);
+    latency_log_add(log, FOCAS_FN_RDSEQNUM, started, result);
+    if (result == EW_OK) {
+      info->sequence_number = seq_info.data;
+      info->program_line = (int) seq_info.data;
+      answered++;
+    }
+  }
+
+  // Read all four position types of every axis in one call
+  if (plan & ACQ_POSITION) {
+    issued++;
+    ODBPOS positions[MAX_AXIS];
+    short num_axes = MAX_AXIS;
+    if (identity && identity->valid && identity->axis_count > 0) {
+      num_axes = (short) identity->axis_count;
+    }
+    started = platform_monotonic_ms();
+    result = cnc_rdposition(handle, -1, &num_axes, positions);
+    latency_log_add(log, FOCAS_FN_RDPOSITION, started, result);
+    if (result == EW_OK) {
+      if (num_axes > MACHINE_MAX_AXES) {
+        num_axes = MACHINE_MAX_AXES;
+      }
+      info->position.axis_count = num_axes;
+      for (int i = 0; i < num_axes; i++) {
+        const ODBPOS *pos = &positions[i];
+        AxisPosition *axis = &info->position.axes[i];
+        axis->name[0] = pos->abs.name;
+        axis->name[1] = (pos->abs.suff != ' ') ? pos->abs.suff : '\0';
+        axis->name[2] = '\0';
+        axis->absolute = scale_position(pos->abs.data, pos->abs.dec);
+        axis->relative = scale_position(pos->rel.data, pos->rel.dec);
+        axis->machine = scale_position(pos->mach.data, pos->mach.dec);
+        axis->distance = scale_position(pos->dist.data, pos->dist.dec);
+      }
+      answered++;
+    }
+  }
+
+  // Read speed information
+  if (plan & ACQ_SPEED) {
+    issued++;
+    ODBSPEED speed_data;
+    started = platform_monotonic_ms();
+    result = cnc_rdspeed(handle, 0, &speed_data);
+    latency_log_add(log, FOCAS_FN_RDSPEED, started, result);
+    if (result == EW_OK) {
+      info->speed.feed_rate = speed_data.actf.data;
+      info->speed.spindle_speed = speed_data.acts.data;
+      answered++;
+    }
+  }
+
+  // Read alarm information
+  if (plan & ACQ_ALARM) {
+    issued++;
+    ODBALM alarm_data;
+    started = platform_monotonic_ms();
+    result = cnc_alarm(handle, &alarm_data);
+    latency_log_add(log, FOCAS_FN_ALARM, started, result);
+    if (result == EW_OK) {
+      info->alarm.alarm_status = alarm_data.data;
+      info->alarm.has_alarm = (alarm_data.data != 0) ? 1 : 0;
+      answered++;
+    }
+  }
+
+  // A plan served entirely from the identity never talks to the control, so
+  // without a check a dead handle would keep reporting cached data as fresh
+  if (issued == 0 && (plan & ACQ_LIVENESS)) {
+    issued++;
+    ODBST status;
+    started = platform_monotonic_ms();
+    result = cnc_statinfo(handle, &status);
+    latency_log_add(log, FOCAS_FN_STATINFO, started, result);
+    if (result == EW_OK) {
+      answered++;
+    }
+  }
+  if (answered > 0 && identity) {
+    identity->answered_ms = info->sampled_ms;
+  }
+
+  // A narrow plan may be a single call, so individual failures are reported
+  // in the data but a handle that answers nothing is treated as stale
+  return (issued == 0 || answered > 0) ? FOCAS_OK : FOCAS_CONNECTION_FAILED;
+}
+
+FocasResult read_machine_info(const char *ip, int port, MachineInfo *info) {
+  unsigned short libh;
+  FocasResult result = FOCAS_OK;
+
+  // Initialize info structure
+  memset(info, 0, sizeof(MachineInfo));
+  info->last_updated = time(NULL);
+  info->sampled_ms = platform_monotonic_ms();
+
+  // Connect to machine
+  short connect_result = cnc_allclibhndl3(ip, port, CONNECTION_TIMEOUT, &libh);
+  if (connect_result != EW_OK) {
+    printf("Connection to %s:%d failed: %s (FOCAS error %d)\n", ip, port,
+           get_connection_error_details(connect_result), connect_result);
+    return FOCAS_CONNECTION_FAILED;
+  }
+
+  // Use the optimized function with the temporary handle
+  result = read_machine_info_from_handle(libh, NULL, ACQ_ALL, info, NULL);
+
+  // Cleanup
+  cnc_freelibhndl(libh);
+
+  return result;
+}
@@ -0,0 +1,81 @@
+#include "focasmonitor.h"
+
+// Include the official FANUC header
+#include "fwlib32.h"
+
+// Per-machine circuit breaker. After a failed attempt the breaker opens and
+// the machine is neither connected nor read until its backoff has passed, so
+// an unreachable controller costs nothing per cycle instead of a connect
+// timeout. The first attempt after the wait is a half-open trial: success
+// closes the breaker, failure opens it again for twice as long.
+//
+// The backoff depends on the FOCAS error that tripped it. EW_BUSY means the
+// control is serving other requests on a working handle, so it is asked again
+// after BREAKER_BUSY_BACKOFF_MS; anything else starts at BREAKER_BACKOFF_MS.
+// The upper half of every wait is random so machines that dropped off
+// together, e.g. on a switch outage, do not all come back in the same cycle.
+
+const char *breaker_state_to_string(BreakerState state) {
+  switch (state) {
+    case BREAKER_OPEN:
+      return "open";
+    case BREAKER_HALF_OPEN:
+      return "half-open";
+    default:
+      return "closed";
+  }
+}
+
+void breaker_init(CircuitBreaker *breaker, unsigned int seed) {
+  breaker->state = BREAKER_CLOSED;
+  breaker->failures = 0;
+  breaker->last_error = EW_OK;
+  breaker->retry_at_ms = 0.0;
+  breaker->jitter = seed ? seed : 1;
+}
+
+// Whether an attempt may start at now_ms; an open breaker whose backoff has
+// passed admits it as the half-open trial
+bool breaker_admit(CircuitBreaker *breaker, double now_ms) {
+  if (breaker->state == BREAKER_OPEN) {
+    if (now_ms < breaker->retry_at_ms) {
+      return false;
+    }
+    breaker->state = BREAKER_HALF_OPEN;
+  }
+  return true;
+}
+
+void breaker_succeed(CircuitBreaker *breaker) {
+  breaker->state = BREAKER_CLOSED;
+  breaker->failures = 0;
+  breaker->last_error = EW_OK;
+}
+
+// Open the breaker after an attempt failed with error. Returns the backoff in
+// milliseconds.
+double breaker_fail(CircuitBreaker *breaker, short error, double now_ms) {
+  double backoff =
+      error == EW_BUSY ? BREAKER_BUSY_BACKOFF_MS : BREAKER_BACKOFF_MS;
+  for (int i = 0; i < breaker->failures && backoff < BREAKER_MAX_BACKOFF_MS;
+       i++) {
+    backoff *= 2;
+  }
+  if (backoff > BREAKER_MAX_BACKOFF_MS) {
+    backoff = BREAKER_MAX_BACKOFF_MS;
+  }
+
+  // xorshift32
+  uint32_t x = breaker->jitter;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  breaker->jitter = x;
+  backoff = backoff / 2 + backoff / 2 * (x / 4294967296.0);
+
+  breaker->state = BREAKER_OPEN;
+  breaker->failures++;
+  breaker->last_error = error;
+  breaker->retry_at_ms = now_ms + backoff;
+  return backoff;
+}
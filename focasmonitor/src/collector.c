@@ -0,0 +1,380 @@
+#include "focasmonitor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Worker pool that reads every machine of a connection pool concurrently.
+// FOCAS handles belong to the thread that allocated them (any other thread
+// gets EW_HANDLE, even from cnc_freelibhndl), so every machine is pinned to
+// one worker, machine id modulo the worker count. That worker connects,
+// reads, reconnects and finally frees the machine's handle; each worker has
+// its own queue and an unreachable CNC only delays the machines pinned to the
+// same worker.
+//
+// Isolation is therefore only complete with a worker per machine. Beyond
+// MAX_WORKER_THREADS machines share workers, and a read that stalls (until
+// the FOCAS timeout, or longer if the control hangs mid-transfer) holds up
+// every machine pinned behind it for that long. The cycle deadline still
+// publishes on time, but those machines are late until the stalled read
+// returns; the circuit breaker keeps a dead CNC from doing this every cycle.
+//
+// A cycle may end at a deadline while some machines are still queued or being
+// read. Those stay in flight and are not queued again until their read
+// completes, which publishes the result for the next cycle to pick up.
+//
+// The startup connect is run the same way, so each handle is allocated by the
+// worker that will use it and all machines connect at once. Machines that
+// have not connected when its budget runs out finish in the background, and
+// until they do a cycle does not wait for the machines queued behind them.
+// A machine whose circuit breaker is open is not queued at all, and the trial
+// reconnect once its backoff has passed is run as such a background connect.
+
+// What a worker does with a queued machine
+typedef enum {
+  COLLECTOR_READ = 0,   // connection_pool_collect_machine
+  COLLECTOR_CONNECT = 1 // connection_pool_open_machine
+} CollectorTask;
+
+typedef struct {
+  Collector *collector;
+  PlatformThread thread;
+  int index;
+  int *queue;       // Ring buffer of machine ids awaiting this worker
+  int queue_head;   // Next id to read
+  int queue_length; // Number of queued ids
+  int connects;     // Connect tasks queued or running
+} CollectorWorker;
+
+struct Collector {
+  ConnectionPool *pool;
+  CollectorWorker *workers;
+  int thread_count;
+
+  PlatformMutex lock;
+  PlatformCond work_ready; // Signalled when machines are queued or on stop
+  PlatformCond work_done;  // Signalled when the current cycle is complete
+
+  int queue_capacity;          // Slots in every worker queue and queued_cycle
+  unsigned long cycle;         // Current cycle number
+  unsigned long *queued_cycle; // Cycle each machine was last queued in
+  unsigned char *task;         // CollectorTask each machine was queued for
+  bool *behind_connect;        // Not waited for: a trial connect or behind one
+  int cycle_pending;           // Machines of this cycle not yet finished
+  int cycle_blocked;           // Pending ones queued behind a connect
+  bool stopping;
+};
+
+// Free the handles this worker opened, from the thread that owns them
+static void collector_worker_release(CollectorWorker *worker) {
+  Collector *collector = worker->collector;
+  ConnectionPool *pool = collector->pool;
+  for (int i = worker->index; i < pool->machine_count;
+       i += collector->thread_count) {
+    connection_pool_disconnect_machine(pool, i);
+  }
+}
+
+static void collector_worker(void *arg) {
+  CollectorWorker *worker = (CollectorWorker *) arg;
+  Collector *collector = worker->collector;
+
+  platform_mutex_lock(&collector->lock);
+  while (true) {
+    while (!collector->stopping && worker->queue_length == 0) {
+      platform_cond_wait(&collector->work_ready, &collector->lock);
+    }
+    if (collector->stopping) {
+      break;
+    }
+
+    int machine_id = worker->queue[worker->queue_head];
+    worker->queue_head = (worker->queue_head + 1) % collector->queue_capacity;
+    worker->queue_length--;
+    CollectorTask task = (CollectorTask) collector->task[machine_id];
+    platform_mutex_unlock(&collector->lock);
+
+    if (task == COLLECTOR_CONNECT) {
+      connection_pool_open_machine(collector->pool, machine_id);
+    } else {
+      connection_pool_collect_machine(collector->pool, machine_id);
+    }
+
+    platform_mutex_lock(&collector->lock);
+    if (task == COLLECTOR_CONNECT) {
+      worker->connects--;
+    }
+    if (collector->queued_cycle[machine_id] == collector->cycle) {
+      collector->cycle_pending--;
+      if (collector->behind_connect[machine_id]) {
+        collector->cycle_blocked--;
+      }
+      if (collector->cycle_pending == collector->cycle_blocked) {
+        platform_cond_broadcast(&collector->work_done);
+      }
+    }
+  }
+  platform_mutex_unlock(&collector->lock);
+
+  collector_worker_release(worker);
+}
+
+Collector *collector_create(ConnectionPool *pool, int thread_count) {
+  if (!pool || thread_count < 1) {
+    return NULL;
+  }
+
+  Collector *collector = calloc(1, sizeof(Collector));
+  if (!collector) {
+    return NULL;
+  }
+
+  collector->pool = pool;
+  collector->workers = calloc((size_t) thread_count, sizeof(CollectorWorker));
+  if (!collector->workers) {
+    free(collector);
+    return NULL;
+  }
+
+  platform_mutex_init(&collector->lock);
+  platform_cond_init(&collector->work_ready);
+  platform_cond_init(&collector->work_done);
+
+  // Machines are pinned by thread_count, so it must be final before the first
+  // cycle; workers only use it once they have been handed work
+  for (int i = 0; i < thread_count; i++) {
+    CollectorWorker *worker = &collector->workers[i];
+    worker->collector = collector;
+    worker->index = i;
+    if (!platform_thread_create(&worker->thread, collector_worker, worker)) {
+      fprintf(stderr, "Warning: Could only start %d of %d worker threads\n", i,
+              thread_count);
+      break;
+    }
+    collector->thread_count++;
+  }
+
+  if (collector->thread_count == 0) {
+    collector_destroy(collector);
+    return NULL;
+  }
+
+  return collector;
+}
+
+// Grow every worker queue to hold every machine in the pool (caller holds the
+// lock). The rings are unrolled into the new buffers so queued ids keep their
+// order.
+static bool collector_reserve(Collector *collector, int machine_count) {
+  if (machine_count <= collector->queue_capacity) {
+    return true;
+  }
+
+  unsigned long *queued_cycle =
+      calloc((size_t) machine_count, sizeof(unsigned long));
+  if (!queued_cycle) {
+    return false;
+  }
+  unsigned char *task = calloc((size_t) machine_count, sizeof(char));
+  bool *behind_connect = calloc((size_t) machine_count, sizeof(bool));
+  int **queues = calloc((size_t) collector->thread_count, sizeof(int *));
+  if (!task || !behind_connect || !queues) {
+    free(task);
+    free(behind_connect);
+    free(queues);
+    free(queued_cycle);
+    return false;
+  }
+  for (int w = 0; w < collector->thread_count; w++) {
+    queues[w] = malloc((size_t) machine_count * sizeof(int));
+    if (!queues[w]) {
+      for (int k = 0; k < w; k++) {
+        free(queues[k]);
+      }
+      free(queues);
+      free(task);
+      free(behind_connect);
+      free(queued_cycle);
+      return false;
+    }
+  }
+
+  for (int w = 0; w < collector->thread_count; w++) {
+    CollectorWorker *worker = &collector->workers[w];
+    for (int i = 0; i < worker->queue_length; i++) {
+      queues[w][i] = worker->queue[(worker->queue_head + i)
+                                   % collector->queue_capacity];
+    }
+    free(worker->queue);
+    worker->queue = queues[w];
+    worker->queue_head = 0;
+  }
+  if (collector->queued_cycle) {
+    memcpy(queued_cycle, collector->queued_cycle,
+           (size_t) collector->queue_capacity * sizeof(unsigned long));
+    memcpy(task, collector->task, (size_t) collector->queue_capacity);
+    memcpy(behind_connect, collector->behind_connect,
+           (size_t) collector->queue_capacity * sizeof(bool));
+  }
+
+  free(queues);
+  free(collector->queued_cycle);
+  free(collector->task);
+  free(collector->behind_connect);
+  collector->queued_cycle = queued_cycle;
+  collector->task = task;
+  collector->behind_connect = behind_connect;
+  collector->queue_capacity = machine_count;
+  return true;
+}
+
+// Queue the given machines (all of them when machine_ids is NULL) that are
+// enabled and idle for task, and wait until they are all done or the deadline
+// (in milliseconds, 0 = none) has passed. Returns the number of machines
+// queued this time that are still in flight.
+static int collector_run(Collector *collector, const int *machine_ids,
+                         int count, int deadline_ms, CollectorTask task) {
+  if (!collector) {
+    return 0;
+  }
+
+  ConnectionPool *pool = collector->pool;
+  double now = platform_monotonic_ms();
+  double deadline = now + deadline_ms;
+
+  platform_mutex_lock(&collector->lock);
+  collector->cycle++;
+  collector->cycle_pending = 0;
+  collector->cycle_blocked = 0;
+
+  platform_mutex_lock(&pool->lock);
+  if (!collector_reserve(collector, pool->machine_count)) {
+    platform_mutex_unlock(&pool->lock);
+    platform_mutex_unlock(&collector->lock);
+    fprintf(stderr, "Warning: Out of memory queueing machines\n");
+    return 0;
+  }
+
+  // Machines left over from an earlier cycle are still owned by a worker (or
+  // waiting for one) and must not be queued twice
+  if (!machine_ids) {
+    count = pool->machine_count;
+  }
+  for (int k = 0; k < count; k++) {
+    int i = machine_ids ? machine_ids[k] : k;
+    if (i < 0 || i >= pool->machine_count) {
+      continue;
+    }
+    MachineHandle *machine = pool->machines[i];
+    if (!machine->enabled || machine->in_flight) {
+      continue;
+    }
+    if (task == COLLECTOR_READ && !breaker_admit(&machine->breaker, now)) {
+      continue; // Behind an open breaker its last result stays published
+    }
+    // The trial reconnect after a breaker's backoff runs like a startup
+    // connect, which the cycle does not wait for; it is read once connected
+    CollectorTask queued = task;
+    if (task == COLLECTOR_READ && machine->breaker.state == BREAKER_HALF_OPEN
+        && machine->handle == 0) {
+      queued = COLLECTOR_CONNECT;
+    }
+    machine->in_flight = true;
+    CollectorWorker *worker = &collector->workers[i % collector->thread_count];
+    int tail = (worker->queue_head + worker->queue_length)
+               % collector->queue_capacity;
+    worker->queue[tail] = i;
+    worker->queue_length++;
+    collector->queued_cycle[i] = collector->cycle;
+    collector->task[i] = (unsigned char) queued;
+    collector->behind_connect[i] = queued == COLLECTOR_READ
+                                       ? worker->connects > 0
+                                       : task == COLLECTOR_READ;
+    collector->cycle_blocked += collector->behind_connect[i] ? 1 : 0;
+    worker->connects += queued == COLLECTOR_CONNECT ? 1 : 0;
+    collector->cycle_pending++;
+  }
+  platform_mutex_unlock(&pool->lock);
+  platform_cond_broadcast(&collector->work_ready);
+
+  // Without a deadline the cycle ends when the slowest machine has been read
+  while (collector->cycle_pending > collector->cycle_blocked) {
+    if (deadline_ms <= 0) {
+      platform_cond_wait(&collector->work_done, &collector->lock);
+      continue;
+    }
+
+    long remaining = (long) (deadline - platform_monotonic_ms());
+    if (remaining <= 0) {
+      break;
+    }
+    platform_cond_timedwait(&collector->work_done, &collector->lock,
+                            remaining);
+  }
+
+  // Reads that missed the deadline are published as late now, and again
+  // once they complete
+  int late = collector->cycle_pending;
+  if (late > 0 && task == COLLECTOR_READ) {
+    platform_mutex_lock(&pool->lock);
+    for (int k = 0; k < count; k++) {
+      int i = machine_ids ? machine_ids[k] : k;
+      if (i < 0 || i >= pool->machine_count
+          || collector->queued_cycle[i] != collector->cycle
+          || collector->task[i] != COLLECTOR_READ
+          || !pool->machines[i]->in_flight) {
+        continue;
+      }
+      pool->machines[i]->late = true;
+      connection_pool_mark_dirty(pool, i);
+    }
+    platform_mutex_unlock(&pool->lock);
+  }
+  platform_mutex_unlock(&collector->lock);
+
+  return late;
+}
+
+// Read the given machines (all of them when machine_ids is NULL)
+int collector_run_cycle(Collector *collector, const int *machine_ids,
+                        int count, int deadline_ms) {
+  return collector_run(collector, machine_ids, count, deadline_ms,
+                       COLLECTOR_READ);
+}
+
+// Connect every enabled machine that is not connected yet, each on its own
+// worker
+int collector_connect_all(Collector *collector, int deadline_ms) {
+  return collector_run(collector, NULL, 0, deadline_ms, COLLECTOR_CONNECT);
+}
+
+int collector_thread_count(const Collector *collector) {
+  return collector ? collector->thread_count : 0;
+}
+
+void collector_destroy(Collector *collector) {
+  if (!collector) {
+    return;
+  }
+
+  platform_mutex_lock(&collector->lock);
+  collector->stopping = true;
+  platform_cond_broadcast(&collector->work_ready);
+  platform_mutex_unlock(&collector->lock);
+
+  for (int i = 0; i < collector->thread_count; i++) {
+    platform_thread_join(collector->workers[i].thread);
+  }
+
+  platform_cond_destroy(&collector->work_done);
+  platform_cond_destroy(&collector->work_ready);
+  platform_mutex_destroy(&collector->lock);
+  for (int i = 0; i < collector->thread_count; i++) {
+    free(collector->workers[i].queue);
+  }
+  free(collector->workers);
+  free(collector->queued_cycle);
+  free(collector->task);
+  free(collector->behind_connect);
+  free(collector);
+}
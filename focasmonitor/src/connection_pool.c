@@ -1,5 +1,6 @@
 #include "focasmonitor.h"
 
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -152,73 +153,70 @@ const char *get_connection_error_details(short error_code) {
   }
 }
 
-// Ping check utility function for network diagnostics
-int ping_host(const char *ip_address) {
-#ifdef _WIN32
-  char command[256];
-  snprintf(command, sizeof(command), "ping -n 1 -w 1000 %s >nul 2>&1",
-           ip_address);
-  return system(command);
-#else
-  char command[256];
-  snprintf(command, sizeof(command), "ping -c 1 -W 1 %s >/dev/null 2>&1",
-           ip_address);
-  return system(command);
-#endif
+// Per-machine connect and read diagnostics. They go to stderr so stdout only
+// carries the selected output, and are dropped while the console view is
+// redrawn in place (quiet is pool->quiet), since the view shows every
+// machine's state and last error itself.
+static void pool_log(bool quiet, const char *format, ...) {
+  if (quiet) {
+    return;
+  }
+  va_list args;
+  va_start(args, format);
+  vfprintf(stderr, format, args);
+  va_end(args);
 }
 
-// Perform basic network diagnostics
-void perform_network_diagnostics(const char *machine_name, const char *ip,
-                                 int port, bool verbose) {
-  if (verbose) {
-    printf("  > Running network diagnostics for %s...\n", machine_name);
-
-    // Test ping connectivity
-    printf("    Testing ping connectivity to %s...", ip);
-    fflush(stdout);
-
-    int ping_result = ping_host(ip);
-    if (ping_result == 0) {
-      printf(" [OK] Host is reachable\n");
-    } else {
-      printf(" [FAIL] Host unreachable\n");
-      printf("    This indicates a basic network connectivity problem:\n");
-      printf("      * Check if the IP address %s is correct\n", ip);
-      printf("      * Verify network cables and switch connections\n");
-      printf("      * Check if the machine is powered on\n");
-      printf("      * Ensure you're on the correct network segment/VLAN\n");
-      return; // Skip port test if ping fails
-    }
-
-    // Test port connectivity (simplified check)
-#ifdef _WIN32
-    printf("    Testing port %d connectivity...", port);
-    fflush(stdout);
-
-    char telnet_cmd[256];
-    snprintf(telnet_cmd, sizeof(telnet_cmd),
-             "powershell -Command \"try { $socket = New-Object "
-             "System.Net.Sockets.TcpClient; $socket.Connect('%s', %d); "
-             "$socket.Close(); exit 0 } catch { exit 1 }\" >nul 2>&1",
-             ip, port);
-
-    int port_result = system(telnet_cmd);
-    if (port_result == 0) {
-      printf(" [OK] Port %d is open\n", port);
-    } else {
-      printf(" [FAIL] Port %d appears closed or filtered\n", port);
-      printf("    This suggests:\n");
-      printf("      * FOCAS service may not be running on the machine\n");
-      printf("      * Port %d is blocked by firewall\n", port);
-      printf("      * Machine is not configured for FOCAS ethernet "
-             "communication\n");
-    }
-#else
-    printf("    Port connectivity test not available on this platform\n");
-#endif
+// Explain a machine's latest reachability probe
+static void perform_network_diagnostics(const MachineHandle *machine,
+                                        bool quiet) {
+  if (quiet) {
+    return;
+  }
 
-    printf("\n");
+  fprintf(stderr, "  > Network diagnostics for %s: port %d %s",
+          machine->friendly_name, machine->port,
+          probe_result_to_string(machine->probe));
+  switch (machine->probe) {
+    case PROBE_OPEN:
+      fprintf(stderr, " (%.1f ms)\n", machine->probe_rtt_ms);
+      fprintf(stderr, "    The host accepts TCP connections, so the FOCAS "
+                      "session failed:\n");
+      fprintf(stderr,
+              "      * Check the FOCAS port number configured on the CNC\n");
+      fprintf(stderr, "      * The CNC may have no free FOCAS sessions left\n");
+      break;
+    case PROBE_REFUSED:
+      fprintf(stderr, " (%.1f ms)\n", machine->probe_rtt_ms);
+      fprintf(stderr, "    The host is up but nothing listens on port %d:\n",
+              machine->port);
+      fprintf(stderr,
+              "      * FOCAS service may not be running on the machine\n");
+      fprintf(stderr, "      * Machine is not configured for FOCAS ethernet "
+                      "communication\n");
+      fprintf(stderr, "      * Check the port number in the machine list\n");
+      break;
+    case PROBE_TIMEOUT:
+      fprintf(stderr, " (no answer in %d ms)\n", PROBE_TIMEOUT_MS);
+      fprintf(stderr,
+              "    This indicates a basic network connectivity problem:\n");
+      fprintf(stderr, "      * Check if the IP address %s is correct\n",
+              machine->ip);
+      fprintf(stderr, "      * Check if the machine is powered on\n");
+      fprintf(stderr, "      * Port %d may be blocked by a firewall\n",
+              machine->port);
+      fprintf(stderr,
+              "      * Ensure you're on the correct network segment/VLAN\n");
+      break;
+    default:
+      fprintf(stderr, "\n");
+      fprintf(stderr, "    No route to %s:\n", machine->ip);
+      fprintf(stderr, "      * Check the address or host name\n");
+      fprintf(stderr, "      * Verify network cables and switch connections\n");
+      fprintf(stderr, "      * Check this computer's network configuration\n");
+      break;
   }
+  fprintf(stderr, "\n");
 }
 
 FocasResult connection_pool_init(ConnectionPool *pool) {
@@ -227,11 +225,72 @@ FocasResult connection_pool_init(ConnectionPool *pool) {
 
   memset(pool, 0, sizeof(ConnectionPool));
   pool->pool_created = time(NULL);
+  platform_mutex_init(&pool->lock);
+  pool->plan = ACQ_ALL;
+  pool->probe_ports = true;
   pool->initialized = true;
 
   return FOCAS_OK;
 }
 
+// FNV-1a hash of a machine name for the name index
+static unsigned int hash_machine_name(const char *name) {
+  unsigned int hash = 2166136261u;
+  while (*name) {
+    hash ^= (unsigned char) *name++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static void name_index_insert(ConnectionPool *pool, int machine_id) {
+  unsigned int mask = (unsigned int) pool->name_index_size - 1;
+  unsigned int slot =
+      hash_machine_name(pool->machines[machine_id]->friendly_name) & mask;
+  while (pool->name_index[slot] != 0) {
+    slot = (slot + 1) & mask;
+  }
+  pool->name_index[slot] = machine_id + 1;
+}
+
+// Grow the registry so it can hold at least one more machine. The name index
+// is kept at most half full so probe sequences stay short.
+static bool connection_pool_reserve(ConnectionPool *pool) {
+  if (pool->machine_count < pool->machine_capacity) {
+    return true;
+  }
+
+  int capacity = pool->machine_capacity > 0 ? pool->machine_capacity * 2
+                                            : INITIAL_MACHINE_CAPACITY;
+
+  MachineHandle **machines =
+      realloc(pool->machines, (size_t) capacity * sizeof(MachineHandle *));
+  if (!machines) {
+    return false;
+  }
+  pool->machines = machines;
+
+  int *dirty_ids = realloc(pool->dirty_ids, (size_t) capacity * sizeof(int));
+  if (!dirty_ids) {
+    return false;
+  }
+  pool->dirty_ids = dirty_ids;
+
+  int *name_index = calloc((size_t) capacity * 2, sizeof(int));
+  if (!name_index) {
+    return false;
+  }
+  free(pool->name_index);
+  pool->name_index = name_index;
+  pool->name_index_size = capacity * 2;
+  for (int i = 0; i < pool->machine_count; i++) {
+    name_index_insert(pool, i);
+  }
+
+  pool->machine_capacity = capacity;
+  return true;
+}
+
 FocasResult connection_pool_add_machine(ConnectionPool *pool, const char *name,
                                         const char *ip, int port) {
   if (!pool || !ip || !name)
@@ -241,11 +300,19 @@ FocasResult connection_pool_add_machine(ConnectionPool *pool, const char *name,
     return FOCAS_INVALID_CONFIG;
   }
 
-  if (pool->machine_count >= MAX_MACHINES) {
+  // Names identify machines in lookups and output, so they must be unique
+  if (connection_pool_find_machine(pool, name) >= 0) {
+    return FOCAS_INVALID_CONFIG;
+  }
+
+  if (!connection_pool_reserve(pool)) {
     return FOCAS_POOL_FULL;
   }
 
-  MachineHandle *machine = &pool->machines[pool->machine_count];
+  MachineHandle *machine = calloc(1, sizeof(MachineHandle));
+  if (!machine) {
+    return FOCAS_POOL_FULL;
+  }
 
   // Initialize machine handle
   strncpy(machine->ip, ip, sizeof(machine->ip) - 1);
@@ -258,77 +325,185 @@ FocasResult connection_pool_add_machine(ConnectionPool *pool, const char *name,
   machine->retry_count = 0;
   machine->info_valid = false;
   machine->enabled = true;
+  machine->last_result = FOCAS_CONNECTION_FAILED;
   strcpy(machine->last_error, "Not connected");
+  breaker_init(&machine->breaker, hash_machine_name(name));
 
+  int machine_id = pool->machine_count;
+  pool->machines[machine_id] = machine;
   pool->machine_count++;
+  name_index_insert(pool, machine_id);
+
+  // The next snapshot publishes it as not read yet; after that it is only
+  // published again when its reads change what the snapshot shows
+  platform_mutex_lock(&pool->lock);
+  connection_pool_mark_dirty(pool, machine_id);
+  platform_mutex_unlock(&pool->lock);
 
   return FOCAS_OK;
 }
 
+MachineHandle *connection_pool_get_machine(const ConnectionPool *pool,
+                                           int machine_id) {
+  if (!pool || machine_id < 0 || machine_id >= pool->machine_count) {
+    return NULL;
+  }
+
+  return pool->machines[machine_id];
+}
+
+// Look up a machine id by friendly name, returns -1 if not found
+int connection_pool_find_machine(const ConnectionPool *pool, const char *name) {
+  if (!pool || !name || pool->name_index_size == 0) {
+    return -1;
+  }
+
+  unsigned int mask = (unsigned int) pool->name_index_size - 1;
+  unsigned int slot = hash_machine_name(name) & mask;
+  while (pool->name_index[slot] != 0) {
+    int machine_id = pool->name_index[slot] - 1;
+    if (strcmp(pool->machines[machine_id]->friendly_name, name) == 0) {
+      return machine_id;
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  return -1;
+}
+
+// Queue a machine for the next snapshot update (caller holds pool->lock)
+void connection_pool_mark_dirty(ConnectionPool *pool, int machine_id) {
+  MachineHandle *machine = pool->machines[machine_id];
+  if (!machine->dirty) {
+    machine->dirty = true;
+    pool->dirty_ids[pool->dirty_count++] = machine_id;
+  }
+}
+
 FocasResult connection_pool_connect_machine(ConnectionPool *pool,
                                             int machine_id, bool diagnose) {
   if (!pool || machine_id < 0 || machine_id >= pool->machine_count) {
     return FOCAS_CONNECTION_FAILED;
   }
 
-  MachineHandle *machine = &pool->machines[machine_id];
+  MachineHandle *machine = pool->machines[machine_id];
 
   if (!machine->enabled) {
     return FOCAS_OK; // Skip disabled machines
   }
 
-  if (machine->state == CONN_CONNECTED) {
+  if (machine->state == CONN_CONNECTED || machine->state == CONN_BUSY) {
     return FOCAS_OK; // Already connected
   }
 
+  platform_mutex_lock(&pool->lock);
   machine->state = CONN_CONNECTING;
+  bool quiet = pool->quiet;
+  platform_mutex_unlock(&pool->lock);
+
+  // A host that does not answer would hold cnc_allclibhndl3 for its whole
+  // timeout, so it is only called once the port is known to be open
+  if (pool->probe_ports
+      && (machine->probe_time_ms == 0
+          || platform_monotonic_ms() - machine->probe_time_ms
+                 > PROBE_MAX_AGE_MS)) {
+    network_probe(pool, &machine_id, 1, PROBE_TIMEOUT_MS);
+  }
+  if (pool->probe_ports && machine->probe != PROBE_OPEN) {
+    platform_mutex_lock(&pool->lock);
+    double backoff =
+        breaker_fail(&machine->breaker, EW_SOCKET, platform_monotonic_ms());
+    machine->state = CONN_ERROR;
+    machine->retry_count++;
+    snprintf(machine->last_error, sizeof(machine->last_error), "Port %d %s",
+             machine->port, probe_result_to_string(machine->probe));
+    platform_mutex_unlock(&pool->lock);
+
+    pool_log(quiet,
+             "[FAIL] Connection to %s at %s:%d FAILED (port %s), next attempt "
+             "in %.1f s\n",
+             machine->friendly_name, machine->ip, machine->port,
+             probe_result_to_string(machine->probe), backoff / 1000.0);
+    if (diagnose) {
+      perform_network_diagnostics(machine, quiet);
+    }
+    return FOCAS_CONNECTION_FAILED;
+  }
 
   // Attempt connection using FOCAS
-  printf("> Connecting to %s at %s:%d (timeout: %ds)...\n",
-         machine->friendly_name, machine->ip, machine->port,
-         CONNECTION_TIMEOUT);
+  pool_log(quiet, "> Connecting to %s at %s:%d (timeout: %ds)...\n",
+           machine->friendly_name, machine->ip, machine->port,
+           CONNECTION_TIMEOUT);
+  LatencyLog log;
+  log.count = 0;
+  double started = platform_monotonic_ms();
+  unsigned short handle = 0;
   short result = cnc_allclibhndl3(machine->ip, machine->port,
-                                  CONNECTION_TIMEOUT, &machine->handle);
+                                  CONNECTION_TIMEOUT, &handle);
+  latency_log_add(&log, FOCAS_FN_ALLCLIBHNDL3, started, result);
 
   if (result == EW_OK) {
+    pool_log(quiet, "[OK] Successfully connected to %s (handle: %d)\n",
+             machine->friendly_name, handle);
+
+    // Identity cannot change while the handle is open, so read it once here
+    // instead of on every cycle
+    MachineIdentity identity;
+    if (read_machine_identity(handle, &identity, &log) == FOCAS_OK
+        && !quiet) {
+      print_machine_identity(stderr, &identity, "  ");
+    }
+
+    // The connection is published with the identity in one step
+    platform_mutex_lock(&pool->lock);
+    machine->handle = handle;
+    machine->identity = identity;
     machine->state = CONN_CONNECTED;
     machine->connect_time = time(NULL);
     machine->last_activity = time(NULL);
     machine->retry_count = 0;
     strcpy(machine->last_error, "Connected successfully");
     pool->total_connections++;
-    printf("[OK] Successfully connected to %s (handle: %d)\n",
-           machine->friendly_name, machine->handle);
+    machine->connections++;
+    latency_log_merge(&log, machine->latency);
+    platform_mutex_unlock(&pool->lock);
 
     return FOCAS_OK;
   } else {
+    platform_mutex_lock(&pool->lock);
+    latency_log_merge(&log, machine->latency);
+    double backoff =
+        breaker_fail(&machine->breaker, result, platform_monotonic_ms());
     machine->state = CONN_ERROR;
     machine->retry_count++;
+    snprintf(machine->last_error, sizeof(machine->last_error),
+             "FOCAS error %d: %s", result, focas_error_to_string(result));
+    platform_mutex_unlock(&pool->lock);
 
     // Use detailed error mapping
     const char *error_msg = get_connection_error_details(result);
-    snprintf(machine->last_error, sizeof(machine->last_error),
-             "FOCAS error %d: %s", result, focas_error_to_string(result));
 
-    printf("[FAIL] Connection to %s FAILED (FOCAS error %d: %s)\n",
-           machine->friendly_name, result, focas_error_to_string(result));
+    pool_log(quiet,
+             "[FAIL] Connection to %s FAILED (FOCAS error %d: %s), next "
+             "attempt in %.1f s\n",
+             machine->friendly_name, result, focas_error_to_string(result),
+             backoff / 1000.0);
 
     // Perform network diagnostics for socket errors
     if (result == EW_SOCKET && diagnose) {
-      perform_network_diagnostics(machine->friendly_name, machine->ip,
-                                  machine->port, true);
-    } else {
-      printf("  Troubleshooting steps:\n");
+      perform_network_diagnostics(machine, quiet);
+    } else if (!quiet) {
+      fprintf(stderr, "  Troubleshooting steps:\n");
 
       // Print the detailed error message with proper indentation
       char *msg_copy = strdup(error_msg);
       char *line = strtok(msg_copy, "\n");
       while (line != NULL) {
-        printf("  %s\n", line);
+        fprintf(stderr, "  %s\n", line);
         line = strtok(NULL, "\n");
       }
       free(msg_copy);
-      printf("\n");
+      fprintf(stderr, "\n");
     }
 
     return FOCAS_CONNECTION_FAILED;
@@ -341,54 +516,125 @@ FocasResult connection_pool_disconnect_machine(ConnectionPool *pool,
     return FOCAS_CONNECTION_FAILED;
   }
 
-  MachineHandle *machine = &pool->machines[machine_id];
-
-  if (machine->state == CONN_CONNECTED && machine->handle != 0) {
-    cnc_freelibhndl(machine->handle);
+  MachineHandle *machine = pool->machines[machine_id];
+
+  if ((machine->state == CONN_CONNECTED || machine->state == CONN_BUSY)
+      && machine->handle != 0) {
+    LatencyLog log;
+    log.count = 0;
+    double started = platform_monotonic_ms();
+    short result = cnc_freelibhndl(machine->handle);
+    latency_log_add(&log, FOCAS_FN_FREELIBHNDL, started, result);
+    platform_mutex_lock(&pool->lock);
+    latency_log_merge(&log, machine->latency);
     machine->state = CONN_DISCONNECTED;
     machine->handle = 0;
+    machine->identity.valid = false;
     strcpy(machine->last_error, "Disconnected");
+    platform_mutex_unlock(&pool->lock);
   }
 
   return FOCAS_OK;
 }
 
-FocasResult connection_pool_connect_all(ConnectionPool *pool, bool diagnose) {
+// Connect every machine, on the workers when they are running, and return once
+// all have answered or budget_ms (0 = no limit) has passed. Machines still
+// connecting then finish in the background; ones that failed are retried once
+// their circuit breaker's backoff has passed.
+FocasResult connection_pool_connect_all(ConnectionPool *pool, bool diagnose,
+                                        int budget_ms) {
   if (!pool || !pool->initialized) {
     return FOCAS_INVALID_CONFIG;
   }
 
   int successful = 0;
   int failed = 0;
+  int pending = 0;
+  double started = platform_monotonic_ms();
+
+  // Probe every port at once, so unreachable machines fail fast below instead
+  // of each waiting out the FOCAS connect timeout
+  int *machine_ids = pool->probe_ports
+                         ? malloc((size_t) pool->machine_count * sizeof(int))
+                         : NULL;
+  if (machine_ids) {
+    int count = 0;
+    for (int i = 0; i < pool->machine_count; i++) {
+      if (pool->machines[i]->enabled) {
+        machine_ids[count++] = i;
+      }
+    }
+    int open = network_probe(pool, machine_ids, count, PROBE_TIMEOUT_MS);
+    if (diagnose && open >= 0) {
+      fprintf(stderr, "Probed %d machines in %.0f ms: %d open, %d not\n",
+              count, platform_monotonic_ms() - started, open, count - open);
+      for (int i = 0; i < count; i++) {
+        const MachineHandle *machine = pool->machines[machine_ids[i]];
+        fprintf(stderr, "  %-20s %s:%d %s (%.1f ms)\n",
+                machine->friendly_name, machine->ip, machine->port,
+                probe_result_to_string(machine->probe), machine->probe_rtt_ms);
+      }
+    }
+    free(machine_ids);
+  }
+
+  if (pool->collector) {
+    // Handles belong to the thread that allocated them, so each machine is
+    // connected by its own worker, all of them at once
+    double elapsed = platform_monotonic_ms() - started;
+    int remaining = (int) (budget_ms - elapsed);
+    pool->diagnose = diagnose;
+    collector_connect_all(pool->collector,
+                          budget_ms <= 0 ? 0 : remaining > 1 ? remaining : 1);
+  } else {
+    for (int i = 0; i < pool->machine_count; i++) {
+      if (budget_ms > 0 && platform_monotonic_ms() - started >= budget_ms) {
+        break; // The rest are connected when they are first read
+      }
+      connection_pool_connect_machine(pool, i, diagnose);
+    }
+  }
 
+  platform_mutex_lock(&pool->lock);
   for (int i = 0; i < pool->machine_count; i++) {
-    FocasResult result = connection_pool_connect_machine(pool, i, diagnose);
-    if (result == FOCAS_OK) {
+    const MachineHandle *machine = pool->machines[i];
+    if (machine->in_flight) {
+      pending++;
+    } else if (!machine->enabled || machine->state == CONN_CONNECTED) {
       successful++;
     } else {
       failed++;
     }
   }
+  platform_mutex_unlock(&pool->lock);
 
   // Print connection summary
+  if (pending > 0) {
+    fprintf(stderr,
+            "%d machines did not connect within the %.1f s startup budget "
+            "and will\nkeep trying in the background\n",
+            pending, budget_ms / 1000.0);
+  }
   if (failed > 0) {
-    printf("===============================================================\n");
-    printf("CONNECTION SUMMARY: %d successful, %d failed\n", successful,
-           failed);
+    fprintf(stderr, "================================"
+                    "===============================\n");
+    fprintf(stderr, "CONNECTION SUMMARY: %d successful, %d failed\n",
+            successful, failed);
     if (failed == pool->machine_count) {
-      printf("WARNING: All machines failed to connect. Common solutions:\n");
-      printf("  * Verify machine IP addresses are correct\n");
-      printf("  * Check network connectivity (ping machines)\n");
-      printf("  * Ensure machines are powered on\n");
-      printf("  * Verify FOCAS ethernet option is enabled\n");
-      printf("  * Check firewall settings\n");
-      printf("  TIP: Use --diagnose flag for automatic network diagnostics\n");
+      fprintf(stderr,
+              "WARNING: All machines failed to connect. Common solutions:\n"
+              "  * Verify machine IP addresses are correct\n"
+              "  * Check network connectivity (ping machines)\n"
+              "  * Ensure machines are powered on\n"
+              "  * Verify FOCAS ethernet option is enabled\n"
+              "  * Check firewall settings\n"
+              "  TIP: Use --diagnose flag for automatic network diagnostics\n");
     }
-    printf(
-        "===============================================================\n\n");
+    fprintf(stderr, "================================"
+                    "===============================\n\n");
   }
 
-  return (failed == 0) ? FOCAS_OK : FOCAS_CONNECTION_FAILED;
+  return (failed == 0 && pending == 0) ? FOCAS_OK : FOCAS_CONNECTION_FAILED;
 }
 
 FocasResult connection_pool_disconnect_all(ConnectionPool *pool) {
@@ -403,224 +649,411 @@ FocasResult connection_pool_disconnect_all(ConnectionPool *pool) {
   return FOCAS_OK;
 }
 
-FocasResult read_machine_info_from_handle(unsigned short handle,
-                                          MachineInfo *info) {
-  if (handle == 0 || !info) {
-    return FOCAS_CONNECTION_FAILED;
+// FOCAS error behind a failed read: the result of the latest call that did not
+// return EW_OK
+static short read_error(const LatencyLog *log) {
+  for (int i = log->count - 1; i >= 0; i--) {
+    if (log->calls[i].result != EW_OK) {
+      return log->calls[i].result;
+    }
   }
+  return EW_SOCKET;
+}
 
-  // Initialize info structure
-  memset(info, 0, sizeof(MachineInfo));
-  info->last_updated = time(NULL);
+// Read one machine through its persistent connection, reconnecting once if
+// needed, and publish the outcome on the machine handle and its breaker. Only
+// the thread that currently owns the machine may call this.
+void connection_pool_collect_machine(ConnectionPool *pool, int machine_id) {
+  MachineHandle *machine = pool->machines[machine_id];
+  MachineInfo info;
+  FocasResult result = FOCAS_CONNECTION_FAILED;
+  short error = EW_OK; // Failure still to be given to the breaker
+  LatencyLog log;
+  log.count = 0;
+  double started = platform_monotonic_ms();
+
+  // A plan that never reaches the control still checks the handle now and then
+  AcquisitionPlan plan = pool->plan;
+  if (started - machine->identity.answered_ms >= pool->liveness_ms) {
+    plan |= ACQ_LIVENESS;
+  }
 
-  // Read machine ID
-  unsigned long cncid[4];
-  if (cnc_rdcncid(handle, cncid) == EW_OK) {
-    snprintf(info->machine_id, sizeof(info->machine_id),
-             "%08lx-%08lx-%08lx-%08lx", cncid[0], cncid[1], cncid[2], cncid[3]);
+  // Try to use persistent connection first
+  if ((machine->state == CONN_CONNECTED || machine->state == CONN_BUSY)
+      && machine->handle != 0) {
+    result = read_machine_info_from_handle(machine->handle, &machine->identity,
+                                           plan, &info, &log);
+    error = result == FOCAS_OK ? EW_OK : read_error(&log);
+    if (result != FOCAS_OK && error != EW_BUSY) {
+      // Connection might be stale, try to reconnect. EW_HANDLE means only the
+      // library lost the handle while the control answers, so a new one is
+      // allocated without probing the port first.
+      platform_mutex_lock(&pool->lock);
+      bool quiet = pool->quiet;
+      platform_mutex_unlock(&pool->lock);
+      pool_log(quiet,
+               "WARNING: Persistent connection to %s failed (FOCAS error %d), "
+               "attempting automatic reconnection...\n",
+               machine->friendly_name, error);
+      connection_pool_disconnect_machine(pool, machine_id);
+      if (error == EW_HANDLE) {
+        machine->probe = PROBE_OPEN;
+        machine->probe_time_ms = platform_monotonic_ms();
+      }
+      error = EW_OK; // A failed connect has opened the breaker already
+      connection_pool_connect_machine(pool, machine_id, false);
+
+      // Retry with new connection
+      if (machine->state == CONN_CONNECTED && machine->handle != 0) {
+        result = read_machine_info_from_handle(
+            machine->handle, &machine->identity, plan, &info, &log);
+        error = result == FOCAS_OK ? EW_OK : read_error(&log);
+      }
+    }
   } else {
-    strcpy(info->machine_id, "UNKNOWN");
+    // Not connected, try to connect and read
+    if (connection_pool_connect_machine(pool, machine_id, false) == FOCAS_OK) {
+      if (machine->handle != 0) {
+        result = read_machine_info_from_handle(
+            machine->handle, &machine->identity, plan, &info, &log);
+        error = result == FOCAS_OK ? EW_OK : read_error(&log);
+      }
+    }
   }
 
-  // Read current program
-  ODBPRO prgnum;
-  if (cnc_rdprgnum(handle, &prgnum) == EW_OK) {
-    snprintf(info->program_name, sizeof(info->program_name), "O%04d",
-             prgnum.data);
-    info->program_number = (int) prgnum.data;
+  // Every new sample is published; a failure only when it changes the read
+  // status, or when the snapshot shows the machine as late
+  platform_mutex_lock(&pool->lock);
+  bool publish = result == FOCAS_OK || result != machine->last_result
+                 || machine->late;
+  if (result == FOCAS_OK) {
+    machine->state = CONN_CONNECTED;
+    machine->last_activity = time(NULL);
+    machine->last_info = info;
+    machine->info_valid = true;
+    pool->successful_operations++;
+    breaker_succeed(&machine->breaker);
   } else {
-    strcpy(info->program_name, "UNKNOWN");
-    info->program_number = 0;
-  }
-
-  // Read machine status
-  ODBST status;
-  if (cnc_statinfo(handle, &status) == EW_OK) {
-    switch (status.run) {
-      case 0:
-        strcpy(info->status, "STOPPED");
-        break;
-      case 1:
-        strcpy(info->status, "RUNNING");
-        break;
-      case 2:
-        strcpy(info->status, "PAUSED");
-        break;
-      case 3:
-        strcpy(info->status, "ALARM");
-        break;
-      default:
-        snprintf(info->status, sizeof(info->status), "UNKNOWN(%d)", status.run);
-        break;
+    pool->failed_operations++;
+    if (error == EW_BUSY) {
+      // The control is serving other requests; the handle is fine and is
+      // asked again after a short backoff
+      machine->state = CONN_BUSY;
+      snprintf(machine->last_error, sizeof(machine->last_error),
+               "FOCAS error %d: %s", error, focas_error_to_string(error));
     }
-
-    // Add motion status if available
-    if (status.motion == 1) {
-      strcat(info->status, " (MOVING)");
+    if (error != EW_OK) {
+      breaker_fail(&machine->breaker, error, platform_monotonic_ms());
     }
-  } else {
-    strcpy(info->status, "UNKNOWN");
   }
+  machine->last_result = result;
+  latency_log_merge(&log, machine->latency);
+  latency_histogram_add(&machine->read_latency,
+                        platform_monotonic_ms() - started, result != FOCAS_OK);
+  machine->in_flight = false;
+  machine->late = false;
+  if (publish) {
+    connection_pool_mark_dirty(pool, machine_id);
+  }
+  platform_mutex_unlock(&pool->lock);
+}
 
-  // Read sequence number
-  ODBSEQ seq_info;
-  if (cnc_rdseqnum(handle, &seq_info) == EW_OK) {
-    info->sequence_number = seq_info.data;
-    info->program_line = (int) seq_info.data;
-  } else {
-    info->sequence_number = 0;
-    info->program_line = 0;
-  }
-
-  // Read position information (simplified - first axis only for now)
-  ODBPOS pos_data;
-  short num_axes = 3;
-  if (cnc_rdposition(handle, 0, &num_axes, &pos_data) == EW_OK) {
-    // Position data is in the 'data' field, scaled by decimal places
-    double scale = 1.0;
-    if (pos_data.abs.dec > 0) {
-      for (int i = 0; i < pos_data.abs.dec; i++) {
-        scale /= 10.0;
-      }
-    }
+// Connect one machine for the startup connect or a circuit breaker trial, from
+// the worker that owns it
+void connection_pool_open_machine(ConnectionPool *pool, int machine_id) {
+  connection_pool_connect_machine(pool, machine_id, pool->diagnose);
 
-    info->position.x_abs = pos_data.abs.data * scale;
-    info->position.x_rel = pos_data.rel.data * scale;
+  platform_mutex_lock(&pool->lock);
+  pool->machines[machine_id]->in_flight = false;
+  platform_mutex_unlock(&pool->lock);
+}
 
-    // Y and Z would require additional calls with different axis numbers
-    info->position.y_abs = 0.0;
-    info->position.z_abs = 0.0;
-    info->position.y_rel = 0.0;
-    info->position.z_rel = 0.0;
-  } else {
-    memset(&info->position, 0, sizeof(PositionInfo));
+void multi_machine_info_init(MultiMachineInfo *multi_info) {
+  memset(multi_info, 0, sizeof(MultiMachineInfo));
+}
+
+void multi_machine_info_free(MultiMachineInfo *multi_info) {
+  if (!multi_info) {
+    return;
   }
 
-  // Read speed information
-  ODBSPEED speed_data;
-  if (cnc_rdspeed(handle, 0, &speed_data) == EW_OK) {
-    info->speed.feed_rate = speed_data.actf.data;
-    info->speed.spindle_speed = speed_data.acts.data;
-  } else {
-    memset(&info->speed, 0, sizeof(SpeedInfo));
+  free(multi_info->machines);
+  free(multi_info->machine_ids);
+  free(multi_info->entry_index);
+  free(multi_info->read_status);
+  memset(multi_info, 0, sizeof(MultiMachineInfo));
+}
+
+// Make room for every machine in the pool, returns false on allocation failure
+static bool multi_machine_info_reserve(MultiMachineInfo *multi_info,
+                                       int machine_count) {
+  if (machine_count <= multi_info->capacity) {
+    return true;
   }
 
-  // Read alarm information
-  ODBALM alarm_data;
-  if (cnc_alarm(handle, &alarm_data) == EW_OK) {
-    info->alarm.alarm_status = alarm_data.data;
-    info->alarm.has_alarm = (alarm_data.data != 0) ? 1 : 0;
-  } else {
-    memset(&info->alarm, 0, sizeof(AlarmInfo));
+  int capacity = multi_info->capacity > 0 ? multi_info->capacity
+                                          : INITIAL_MACHINE_CAPACITY;
+  while (capacity < machine_count) {
+    capacity *= 2;
   }
 
-  return FOCAS_OK;
+  MachineInfo *machines =
+      realloc(multi_info->machines, (size_t) capacity * sizeof(MachineInfo));
+  if (!machines) {
+    return false;
+  }
+  multi_info->machines = machines;
+
+  int *machine_ids =
+      realloc(multi_info->machine_ids, (size_t) capacity * sizeof(int));
+  if (!machine_ids) {
+    return false;
+  }
+  multi_info->machine_ids = machine_ids;
+
+  int *entry_index =
+      realloc(multi_info->entry_index, (size_t) capacity * sizeof(int));
+  if (!entry_index) {
+    return false;
+  }
+  multi_info->entry_index = entry_index;
+
+  unsigned char *read_status = realloc(multi_info->read_status,
+                                       (size_t) capacity * sizeof(char));
+  if (!read_status) {
+    return false;
+  }
+  multi_info->read_status = read_status;
+
+  multi_info->capacity = capacity;
+  return true;
+}
+
+static MachineReadStatus machine_read_status(const MachineHandle *machine) {
+  if (!machine->enabled) {
+    return READ_NONE;
+  }
+  if (machine->in_flight) {
+    return machine->info_valid ? READ_LATE : READ_LATE_EMPTY;
+  }
+  if (machine->last_result == FOCAS_OK) {
+    return READ_OK;
+  }
+  return machine->info_valid ? READ_CACHED : READ_FAILED;
 }
 
-FocasResult read_machine_info(const char *ip, int port, MachineInfo *info) {
-  unsigned short libh;
-  FocasResult result = FOCAS_OK;
+static bool read_status_published(MachineReadStatus status) {
+  return status == READ_OK || status == READ_CACHED || status == READ_LATE;
+}
 
-  // Initialize info structure
-  memset(info, 0, sizeof(MachineInfo));
-  info->last_updated = time(NULL);
+// Add (sign = 1) or remove (sign = -1) a machine's contribution to the counts
+static void multi_machine_info_count(MultiMachineInfo *multi_info,
+                                     MachineReadStatus status, int sign) {
+  if (read_status_published(status)) {
+    multi_info->successful_reads += sign;
+  }
+  if (status == READ_LATE || status == READ_LATE_EMPTY) {
+    multi_info->late_reads += sign;
+  }
+  if (status == READ_FAILED) {
+    multi_info->failed_reads += sign;
+  }
+}
 
-  // Connect to machine
-  short connect_result = cnc_allclibhndl3(ip, port, CONNECTION_TIMEOUT, &libh);
-  if (connect_result != EW_OK) {
-    printf("Connection to %s:%d failed: %s (FOCAS error %d)\n", ip, port,
-           get_connection_error_details(connect_result), connect_result);
-    return FOCAS_CONNECTION_FAILED;
+static void multi_machine_info_copy_entry(MultiMachineInfo *multi_info,
+                                          int entry,
+                                          const MachineHandle *machine,
+                                          MachineReadStatus status) {
+  MachineInfo *info = &multi_info->machines[entry];
+  *info = machine->last_info;
+  info->late = (status == READ_LATE);
+}
+
+// Apply the machines that changed since the last snapshot (caller holds
+// pool->lock). Entries are updated in place; the published list is only
+// rebuilt when a machine appears in or drops out of it.
+static void multi_machine_info_update(MultiMachineInfo *multi_info,
+                                      ConnectionPool *pool) {
+  bool membership_changed = false;
+
+  for (int i = multi_info->tracked_count; i < pool->machine_count; i++) {
+    multi_info->entry_index[i] = -1;
+    multi_info->read_status[i] = READ_NONE;
   }
+  multi_info->tracked_count = pool->machine_count;
+
+  for (int d = 0; d < pool->dirty_count; d++) {
+    int machine_id = pool->dirty_ids[d];
+    MachineHandle *machine = pool->machines[machine_id];
+    machine->dirty = false;
 
-  // Use the optimized function with the temporary handle
-  result = read_machine_info_from_handle(libh, info);
+    MachineReadStatus old_status = multi_info->read_status[machine_id];
+    MachineReadStatus status = machine_read_status(machine);
+    multi_machine_info_count(multi_info, old_status, -1);
+    multi_machine_info_count(multi_info, status, 1);
+    multi_info->read_status[machine_id] = (unsigned char) status;
 
-  // Cleanup
-  cnc_freelibhndl(libh);
+    if (status == READ_CACHED) {
+      pool_log(pool->quiet, "Using cached data for %s\n",
+               machine->friendly_name);
+    } else if (status == READ_LATE_EMPTY) {
+      pool_log(pool->quiet,
+               "WARNING: %s missed the cycle deadline and has no cached "
+               "data\n",
+               machine->friendly_name);
+    } else if (status == READ_FAILED) {
+      pool_log(pool->quiet,
+               "WARNING: Failed to read from %s: %s\n"
+               "  No cached data available - machine data will be missing "
+               "from this cycle\n",
+               machine->friendly_name, machine->last_error);
+    }
 
-  return result;
+    if (read_status_published(old_status) != read_status_published(status)) {
+      membership_changed = true;
+    } else if (read_status_published(status)) {
+      multi_machine_info_copy_entry(
+          multi_info, multi_info->entry_index[machine_id], machine, status);
+    }
+  }
+  pool->dirty_count = 0;
+
+  if (membership_changed) {
+    multi_info->machine_count = 0;
+    for (int i = 0; i < pool->machine_count; i++) {
+      MachineReadStatus status = multi_info->read_status[i];
+      if (!read_status_published(status)) {
+        multi_info->entry_index[i] = -1;
+        continue;
+      }
+      int entry = multi_info->machine_count++;
+      multi_info->entry_index[i] = entry;
+      multi_info->machine_ids[entry] = i;
+      multi_machine_info_copy_entry(multi_info, entry, pool->machines[i],
+                                    status);
+    }
+  }
 }
 
 FocasResult connection_pool_read_all_info(ConnectionPool *pool,
                                           MultiMachineInfo *multi_info) {
+  return connection_pool_read_machines(pool, NULL, 0, multi_info);
+}
+
+// Read the given machines (every machine when machine_ids is NULL) and update
+// the snapshot; machines not read keep their previous entries
+FocasResult connection_pool_read_machines(ConnectionPool *pool,
+                                          const int *machine_ids, int count,
+                                          MultiMachineInfo *multi_info) {
   if (!pool || !multi_info || !pool->initialized) {
     return FOCAS_INVALID_CONFIG;
   }
 
-  memset(multi_info, 0, sizeof(MultiMachineInfo));
-  multi_info->collection_time = time(NULL);
+  if (!multi_machine_info_reserve(multi_info, pool->machine_count)) {
+    return FOCAS_POOL_FULL;
+  }
 
-  for (int i = 0; i < pool->machine_count; i++) {
-    MachineHandle *machine = &pool->machines[i];
+  multi_info->collection_time = time(NULL);
+  double started = platform_monotonic_ms();
 
-    if (!machine->enabled) {
-      continue;
+  if (pool->collector) {
+    // Machines are read concurrently by the worker pool; with a deadline
+    // whatever has answered by then is published and the rest marked late
+    collector_run_cycle(pool->collector, machine_ids, count,
+                        pool->cycle_deadline_ms);
+  } else {
+    if (!machine_ids) {
+      count = pool->machine_count;
     }
-
-    // Copy machine info
-    MachineInfo *info = &multi_info->machines[multi_info->machine_count];
-    FocasResult result = FOCAS_CONNECTION_FAILED;
-
-    // Try to use persistent connection first
-    if (machine->state == CONN_CONNECTED && machine->handle != 0) {
-      result = read_machine_info_from_handle(machine->handle, info);
-      if (result == FOCAS_OK) {
-        machine->last_activity = time(NULL);
-      } else {
-        // Connection might be stale, try to reconnect
-        printf("WARNING: Persistent connection to %s failed, attempting "
-               "automatic reconnection...\n",
-               machine->friendly_name);
-        connection_pool_disconnect_machine(pool, i);
-        connection_pool_connect_machine(pool, i, false);
-
-        // Retry with new connection
-        if (machine->state == CONN_CONNECTED && machine->handle != 0) {
-          result = read_machine_info_from_handle(machine->handle, info);
-          if (result == FOCAS_OK) {
-            machine->last_activity = time(NULL);
-          }
-        }
+    for (int k = 0; k < count; k++) {
+      int i = machine_ids ? machine_ids[k] : k;
+      if (i < 0 || i >= pool->machine_count || !pool->machines[i]->enabled) {
+        continue;
       }
-    } else {
-      // Not connected, try to connect and read
-      if (connection_pool_connect_machine(pool, i, false) == FOCAS_OK) {
-        if (machine->handle != 0) {
-          result = read_machine_info_from_handle(machine->handle, info);
-          if (result == FOCAS_OK) {
-            machine->last_activity = time(NULL);
-          }
-        }
+      platform_mutex_lock(&pool->lock);
+      bool admitted = breaker_admit(&pool->machines[i]->breaker,
+                                    platform_monotonic_ms());
+      platform_mutex_unlock(&pool->lock);
+      if (admitted) {
+        connection_pool_collect_machine(pool, i);
       }
     }
+  }
 
-    if (result == FOCAS_OK) {
-      machine->last_info = *info;
-      machine->info_valid = true;
-      multi_info->successful_reads++;
-      pool->successful_operations++;
-    } else {
-      // Use cached info if available
-      if (machine->info_valid) {
-        *info = machine->last_info;
-        multi_info->successful_reads++;
-        printf("Using cached data for %s\n", machine->friendly_name);
-      } else {
-        multi_info->failed_reads++;
-        pool->failed_operations++;
-        printf("WARNING: Failed to read from %s: %s\n", machine->friendly_name,
-               machine->last_error);
-        printf("  No cached data available - machine data will be missing from "
-               "this cycle\n");
-        continue; // Skip this machine
-      }
+  // Late workers may still publish results while the snapshot is updated
+  platform_mutex_lock(&pool->lock);
+  multi_machine_info_update(multi_info, pool);
+  pool->cycles++;
+  pool->last_cycle_ms = platform_monotonic_ms() - started;
+  pool->cycle_ms_total += pool->last_cycle_ms;
+  platform_mutex_unlock(&pool->lock);
+
+  return (multi_info->failed_reads == 0) ? FOCAS_OK : FOCAS_CONNECTION_FAILED;
+}
+
+// Fill in the latency summaries of the published machines. Summarizing walks
+// every histogram, so it is left to the outputs that show percentiles.
+void connection_pool_summarize_latency(ConnectionPool *pool,
+                                       MultiMachineInfo *multi_info) {
+  platform_mutex_lock(&pool->lock);
+  for (int i = 0; i < multi_info->machine_count; i++) {
+    const MachineHandle *machine = pool->machines[multi_info->machine_ids[i]];
+    MachineInfo *info = &multi_info->machines[i];
+    for (int f = 0; f < FOCAS_FN_COUNT; f++) {
+      latency_histogram_summarize(&machine->latency[f], &info->latency[f]);
     }
+    latency_histogram_summarize(&machine->read_latency, &info->read_latency);
+  }
+  platform_mutex_unlock(&pool->lock);
+}
+
+FocasResult connection_pool_start_workers(ConnectionPool *pool,
+                                          int thread_count) {
+  if (!pool || !pool->initialized) {
+    return FOCAS_INVALID_CONFIG;
+  }
 
-    multi_info->machine_count++;
+  if (pool->collector) {
+    return FOCAS_OK; // Already running
   }
 
-  return (multi_info->failed_reads == 0) ? FOCAS_OK : FOCAS_CONNECTION_FAILED;
+  if (thread_count <= 0) {
+    thread_count = pool->machine_count;
+  }
+  if (thread_count > MAX_WORKER_THREADS) {
+    thread_count = MAX_WORKER_THREADS;
+  }
+  if (thread_count > pool->machine_count) {
+    thread_count = pool->machine_count;
+  }
+
+  // A single worker gains nothing over reading in the calling thread, unless
+  // it is needed to abandon a slow read at the cycle deadline
+  if (thread_count < 1
+      || (thread_count == 1 && pool->cycle_deadline_ms <= 0)) {
+    return FOCAS_OK;
+  }
+
+  pool->collector = collector_create(pool, thread_count);
+  if (!pool->collector) {
+    fprintf(stderr, "Warning: Failed to start worker threads, falling back "
+                    "to sequential collection\n");
+    return FOCAS_CONNECTION_FAILED;
+  }
+  pool->worker_threads = collector_thread_count(pool->collector);
+
+  // Handles are only valid on the thread that allocated them. Release the ones
+  // opened here so each machine's worker connects it on its first read.
+  connection_pool_disconnect_all(pool);
+
+  return FOCAS_OK;
+}
+
+void connection_pool_stop_workers(ConnectionPool *pool) {
+  if (pool && pool->collector) {
+    collector_destroy(pool->collector);
+    pool->collector = NULL;
+  }
 }
 
 void connection_pool_print_status(const ConnectionPool *pool) {
@@ -630,28 +1063,55 @@ void connection_pool_print_status(const ConnectionPool *pool) {
   }
 
   printf("=== Connection Pool Status ===\n");
-  printf("Machines configured: %d / %d\n", pool->machine_count, MAX_MACHINES);
+  printf("Machines configured: %d\n", pool->machine_count);
   printf("Total connections: %d\n", pool->total_connections);
   printf("Successful operations: %d\n", pool->successful_operations);
   printf("Failed operations: %d\n", pool->failed_operations);
+  if (pool->cycles > 0) {
+    printf("Read cycles: %d (last %.1f ms, average %.1f ms)\n", pool->cycles,
+           pool->last_cycle_ms, pool->cycle_ms_total / pool->cycles);
+  }
+  if (pool->worker_threads > 0) {
+    printf("Worker threads: %d\n", pool->worker_threads);
+  } else {
+    printf("Worker threads: none (sequential collection)\n");
+  }
+  if (pool->cycle_deadline_ms > 0) {
+    printf("Cycle deadline: %d ms\n", pool->cycle_deadline_ms);
+  }
 
   time_t now = time(NULL);
   printf("Pool created: %ld seconds ago\n", now - pool->pool_created);
 
   printf("\n--- Machine Details ---\n");
   for (int i = 0; i < pool->machine_count; i++) {
-    const MachineHandle *machine = &pool->machines[i];
+    const MachineHandle *machine = pool->machines[i];
     printf("[%d] %s (%s:%d)\n", i, machine->friendly_name, machine->ip,
            machine->port);
     printf("    State: %s\n", connection_state_to_string(machine->state));
     printf("    Enabled: %s\n", machine->enabled ? "Yes" : "No");
+    printf("    Connections: %d\n", machine->connections);
     printf("    Retry count: %d\n", machine->retry_count);
+    if (machine->breaker.state != BREAKER_CLOSED) {
+      printf("    Breaker: %s (failures: %d, last FOCAS error %d)",
+             breaker_state_to_string(machine->breaker.state),
+             machine->breaker.failures, machine->breaker.last_error);
+      if (machine->breaker.state == BREAKER_OPEN) {
+        double wait = machine->breaker.retry_at_ms - platform_monotonic_ms();
+        printf(", next attempt in %.1f s", wait > 0 ? wait / 1000.0 : 0.0);
+      }
+      printf("\n");
+    }
     printf("    Last error: %s\n", machine->last_error);
     if (machine->state == CONN_CONNECTED) {
       printf("    Connected for: %ld seconds\n", now - machine->connect_time);
       printf("    Last activity: %ld seconds ago\n",
              now - machine->last_activity);
     }
+    if (machine->identity.valid) {
+      print_machine_identity(stdout, &machine->identity, "    ");
+    }
+    print_machine_latency(machine->latency, "    ");
     printf("    Cached info valid: %s\n", machine->info_valid ? "Yes" : "No");
     printf("\n");
   }
@@ -659,7 +1119,15 @@ void connection_pool_print_status(const ConnectionPool *pool) {
 
 void connection_pool_cleanup(ConnectionPool *pool) {
   if (pool && pool->initialized) {
+    connection_pool_stop_workers(pool);
     connection_pool_disconnect_all(pool);
+    platform_mutex_destroy(&pool->lock);
+    for (int i = 0; i < pool->machine_count; i++) {
+      free(pool->machines[i]);
+    }
+    free(pool->machines);
+    free(pool->name_index);
+    free(pool->dirty_ids);
     memset(pool, 0, sizeof(ConnectionPool));
   }
 }
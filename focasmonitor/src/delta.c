@@ -0,0 +1,287 @@
+#include "focasmonitor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Change-only output for monitor mode. The tracker keeps a copy of what was
+// last emitted for every machine; each cycle only the machines whose data
+// differs are written, and of those only the groups that changed. Every
+// keyframe_interval cycles the whole snapshot is written again so a consumer
+// that joins late, or missed a line, can resynchronise.
+
+// Change bit for the late flag, outside the AcquisitionField groups
+#define DELTA_LATE (1u << 30)
+
+void delta_tracker_init(DeltaTracker *tracker, int keyframe_interval) {
+  memset(tracker, 0, sizeof(DeltaTracker));
+  tracker->keyframe_interval = keyframe_interval;
+}
+
+void delta_tracker_free(DeltaTracker *tracker) {
+  if (!tracker) {
+    return;
+  }
+
+  free(tracker->emitted);
+  free(tracker->valid);
+  free(tracker->changes);
+  output_buffer_free(&tracker->output);
+  memset(tracker, 0, sizeof(DeltaTracker));
+}
+
+// Make room for pool machine ids below machine_count, returns false on
+// allocation failure. A snapshot has at most one entry per id, so changes[]
+// sized the same covers it.
+static bool delta_tracker_reserve(DeltaTracker *tracker, int machine_count) {
+  if (machine_count <= tracker->capacity) {
+    return true;
+  }
+
+  int capacity = tracker->capacity > 0 ? tracker->capacity
+                                       : INITIAL_MACHINE_CAPACITY;
+  while (capacity < machine_count) {
+    capacity *= 2;
+  }
+
+  MachineInfo *emitted =
+      realloc(tracker->emitted, (size_t) capacity * sizeof(MachineInfo));
+  if (!emitted) {
+    return false;
+  }
+  tracker->emitted = emitted;
+
+  bool *valid = realloc(tracker->valid, (size_t) capacity * sizeof(bool));
+  if (!valid) {
+    return false;
+  }
+  memset(valid + tracker->capacity, 0,
+         (size_t) (capacity - tracker->capacity) * sizeof(bool));
+  tracker->valid = valid;
+
+  AcquisitionPlan *changes =
+      realloc(tracker->changes, (size_t) capacity * sizeof(AcquisitionPlan));
+  if (!changes) {
+    return false;
+  }
+  tracker->changes = changes;
+
+  tracker->capacity = capacity;
+  return true;
+}
+
+static bool position_equal(const PositionInfo *a, const PositionInfo *b) {
+  if (a->axis_count != b->axis_count) {
+    return false;
+  }
+  for (int i = 0; i < a->axis_count; i++) {
+    const AxisPosition *x = &a->axes[i];
+    const AxisPosition *y = &b->axes[i];
+    if (strcmp(x->name, y->name) != 0 || x->absolute != y->absolute
+        || x->relative != y->relative || x->machine != y->machine
+        || x->distance != y->distance) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Groups of current that differ from previous. Groups previous did not carry
+// count as changed; last_updated and the latency summaries are ignored.
+AcquisitionPlan machine_info_changes(const MachineInfo *previous,
+                                     const MachineInfo *current) {
+  AcquisitionPlan fields = current->fields & ACQ_ALL;
+  AcquisitionPlan changed = fields & ~previous->fields;
+
+  if ((fields & ACQ_ID)
+      && strcmp(previous->machine_id, current->machine_id) != 0) {
+    changed |= ACQ_ID;
+  }
+  if ((fields & ACQ_PROGRAM)
+      && (strcmp(previous->program_name, current->program_name) != 0
+          || previous->program_number != current->program_number)) {
+    changed |= ACQ_PROGRAM;
+  }
+  if ((fields & ACQ_STATUS) && strcmp(previous->status, current->status) != 0) {
+    changed |= ACQ_STATUS;
+  }
+  if ((fields & ACQ_SEQUENCE)
+      && previous->sequence_number != current->sequence_number) {
+    changed |= ACQ_SEQUENCE;
+  }
+  if ((fields & ACQ_POSITION)
+      && !position_equal(&previous->position, &current->position)) {
+    changed |= ACQ_POSITION;
+  }
+  if ((fields & ACQ_SPEED)
+      && (previous->speed.feed_rate != current->speed.feed_rate
+          || previous->speed.spindle_speed != current->speed.spindle_speed)) {
+    changed |= ACQ_SPEED;
+  }
+  if ((fields & ACQ_ALARM)
+      && (previous->alarm.has_alarm != current->alarm.has_alarm
+          || previous->alarm.alarm_status != current->alarm.alarm_status)) {
+    changed |= ACQ_ALARM;
+  }
+
+  return changed;
+}
+
+static void serialize_delta_header(OutputBuffer *buffer,
+                                   const MultiMachineInfo *multi_info,
+                                   bool keyframe, int changed_count) {
+  output_buffer_puts(buffer, "{\n  \"collection_time\": ");
+  output_buffer_long(buffer, (long) multi_info->collection_time);
+  output_buffer_puts(buffer, keyframe ? ",\n  \"keyframe\": true"
+                                      : ",\n  \"keyframe\": false");
+  output_buffer_puts(buffer, ",\n  \"machine_count\": ");
+  output_buffer_long(buffer, multi_info->machine_count);
+  output_buffer_puts(buffer, ",\n  \"changed_count\": ");
+  output_buffer_long(buffer, changed_count);
+  output_buffer_puts(buffer, ",\n  \"successful_reads\": ");
+  output_buffer_long(buffer, multi_info->successful_reads);
+  output_buffer_puts(buffer, ",\n  \"failed_reads\": ");
+  output_buffer_long(buffer, multi_info->failed_reads);
+  output_buffer_puts(buffer, ",\n  \"late_reads\": ");
+  output_buffer_long(buffer, multi_info->late_reads);
+  output_buffer_puts(buffer, ",\n  \"machines\": [\n");
+}
+
+// Write one machine of a delta. Names follow the pool machine id, as in
+// keyframes, so a machine keeps its name when others drop out.
+static void delta_write_machine(OutputBuffer *buffer, const MachineInfo *info,
+                                int machine_id, const char *info_type,
+                                OutputFormat format, bool last) {
+  if (format == OUTPUT_JSON) {
+    serialize_machine_info_json(buffer, info, NULL, machine_id);
+    output_buffer_puts(buffer, last ? "\n" : ",\n");
+  } else if (format == OUTPUT_CSV) {
+    serialize_machine_info_csv(buffer, info, NULL, machine_id);
+  } else {
+    char machine_name[64];
+    snprintf(machine_name, sizeof(machine_name), "Machine_%d", machine_id + 1);
+    print_selective_machine_info(info, machine_name, info_type);
+  }
+}
+
+// Whether a machine written before has dropped out of the snapshot, because
+// its read failed with no earlier data or it was disabled
+static bool delta_dropped(const DeltaTracker *tracker,
+                          const MultiMachineInfo *multi_info, int id) {
+  return tracker->valid[id]
+         && (id >= multi_info->tracked_count
+             || multi_info->entry_index[id] < 0);
+}
+
+// Write one cycle of monitor output. Keyframes hold every machine in full, as
+// print_multi_machine_info writes them; deltas hold the changed machines only,
+// each with just its changed groups. CSV deltas reuse the keyframe's header,
+// an empty column meaning unchanged. A machine that drops out of the snapshot
+// is written once with status OFFLINE. Returns the number of machines
+// written, or -1 on allocation failure.
+int print_multi_machine_delta(DeltaTracker *tracker,
+                              const MultiMachineInfo *multi_info,
+                              const char *info_type, OutputFormat format) {
+  int tracked = 0;
+  for (int i = 0; i < multi_info->machine_count; i++) {
+    if (multi_info->machine_ids[i] >= tracked) {
+      tracked = multi_info->machine_ids[i] + 1;
+    }
+  }
+  if (!delta_tracker_reserve(tracker, tracked)) {
+    return -1;
+  }
+  AcquisitionPlan *changes = tracker->changes;
+
+  bool keyframe = tracker->cycles == 0
+                  || (tracker->keyframe_interval > 0
+                      && tracker->cycles % tracker->keyframe_interval == 0);
+  tracker->cycles++;
+
+  int changed_count = 0;
+  for (int i = 0; i < multi_info->machine_count; i++) {
+    int id = multi_info->machine_ids[i];
+    const MachineInfo *info = &multi_info->machines[i];
+    if (keyframe || !tracker->valid[id]) {
+      changes[i] = (info->fields & ACQ_ALL) | DELTA_LATE;
+    } else {
+      changes[i] = machine_info_changes(&tracker->emitted[id], info);
+      if (info->late != tracker->emitted[id].late) {
+        changes[i] |= DELTA_LATE;
+      }
+    }
+    if (changes[i] != 0) {
+      changed_count++;
+    }
+  }
+  int offline_count = 0;
+  for (int id = 0; id < tracker->capacity; id++) {
+    if (delta_dropped(tracker, multi_info, id)) {
+      offline_count++;
+    }
+  }
+  int record_count = keyframe ? changed_count : changed_count + offline_count;
+
+  // Keyframes keep the regular layout, with the keyframe flag added to JSON.
+  // JSON and CSV are collected in the tracker's buffer and written at once.
+  OutputBuffer *buffer = &tracker->output;
+  output_buffer_reset(buffer);
+  if (keyframe && format != OUTPUT_JSON) {
+    print_multi_machine_info(multi_info, info_type, format);
+  } else if (format == OUTPUT_JSON) {
+    serialize_delta_header(buffer, multi_info, keyframe, record_count);
+  } else if (format == OUTPUT_CONSOLE) {
+    printf("FOCAS Monitor - %d of %d machines changed - %s", record_count,
+           multi_info->machine_count, ctime(&multi_info->collection_time));
+  }
+
+  int written = 0;
+  for (int i = 0; i < multi_info->machine_count; i++) {
+    if (changes[i] == 0) {
+      continue;
+    }
+
+    const MachineInfo *info = &multi_info->machines[i];
+    int id = multi_info->machine_ids[i];
+    if (!keyframe || format == OUTPUT_JSON) {
+      MachineInfo delta = *info;
+      if (!keyframe) {
+        delta.fields = changes[i] & ACQ_ALL;
+        memset(delta.latency, 0, sizeof(delta.latency));
+      }
+      delta_write_machine(buffer, &delta, id, info_type, format,
+                          written == record_count - 1);
+    }
+
+    tracker->emitted[id] = *info;
+    tracker->valid[id] = true;
+    written++;
+  }
+
+  // A keyframe is complete, so dropped machines are only forgotten there
+  MachineInfo offline;
+  memset(&offline, 0, sizeof(offline));
+  offline.fields = ACQ_STATUS;
+  strcpy(offline.status, "OFFLINE");
+  offline.last_updated = multi_info->collection_time;
+  for (int id = 0; offline_count > 0 && id < tracker->capacity; id++) {
+    if (!delta_dropped(tracker, multi_info, id)) {
+      continue;
+    }
+    if (!keyframe) {
+      delta_write_machine(buffer, &offline, id, info_type, format,
+                          written == record_count - 1);
+      written++;
+    }
+    tracker->valid[id] = false;
+  }
+
+  if (format == OUTPUT_JSON) {
+    output_buffer_puts(buffer, "  ]\n}\n");
+  }
+  if (buffer->length > 0 && !output_buffer_write(buffer, 1)) {
+    fprintf(stderr, "Error: Failed to write delta output\n");
+  }
+
+  return written;
+}
@@ -2,41 +2,227 @@
 #define FOCAS_MONITOR_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <time.h>
 
-// Maximum number of machines per connection pool (lowered for better
-// performance)
-#define MAX_MACHINES 25
+#include "platform.h"
+
+// Initial capacity of the machine registry, grown on demand
+#define INITIAL_MACHINE_CAPACITY 16
 
 // Connection timeout in seconds
 #define CONNECTION_TIMEOUT 10
 
+// Seconds to wait for the startup connect before monitoring starts; machines
+// still connecting then finish in the background
+#define DEFAULT_STARTUP_BUDGET 15
+
+// TCP probe of a machine's port before a connect: how long to wait for an
+// answer (long enough for one lost SYN) and how long its result is trusted
+#define PROBE_TIMEOUT_MS 3000
+#define PROBE_MAX_AGE_MS 5000
+
+// Circuit breaker backoff after a failed attempt, doubling with each further
+// failure up to the maximum; a busy control is asked again sooner
+#define BREAKER_BACKOFF_MS 1000
+#define BREAKER_BUSY_BACKOFF_MS 100
+#define BREAKER_MAX_BACKOFF_MS 60000
+
+// Axis and spindle slots kept per machine (MAX_AXIS/MAX_SPINDLE in fwlib32.h)
+#define MACHINE_MAX_AXES 32
+#define MACHINE_MAX_SPINDLES 8
+
 // Default monitoring interval
 #define DEFAULT_MONITOR_INTERVAL 30
 
+// Monitor polling intervals for cutting and unreachable machines (0 = use the
+// monitor interval)
+#define DEFAULT_ACTIVE_INTERVAL_MS 0
+#define MIN_ACTIVE_INTERVAL_MS 100
+#define DEFAULT_OFFLINE_INTERVAL 0
+
+// Default per-cycle collection deadline in milliseconds (0 = no deadline)
+#define DEFAULT_CYCLE_DEADLINE_MS 0
+
+// Monitor cycles between full keyframes in --delta mode (0 = only the first)
+#define DEFAULT_KEYFRAME_INTERVAL 10
+
+// Least milliseconds between fsync calls on the --ndjson-file (0 = every write)
+#define DEFAULT_FSYNC_INTERVAL_MS 1000
+
+// Axes kept per history record; further axes are not stored
+#define HISTORY_MAX_AXES 8
+
+// Records per block of a history file's time index
+#define HISTORY_BLOCK_RECORDS 256
+
+// MQTT broker port and topic prefix unless --mqtt and --mqtt-prefix say
+// otherwise
+#define DEFAULT_MQTT_PORT 1883
+#define DEFAULT_MQTT_PREFIX "focas"
+
+// Worker threads used for parallel collection (0 = one per machine, capped at
+// MAX_WORKER_THREADS). With more machines than workers, machines share a
+// worker and a stalled read delays the others pinned to it.
+#define DEFAULT_WORKER_THREADS 0
+#define MAX_WORKER_THREADS 64
+
+// FOCAS reads an acquisition plan can request. Each one is a network round
+// trip to the CNC, so a plan only carries the reads its output uses.
+typedef enum {
+  ACQ_ID = 1 << 0,       // cnc_rdcncid, served from the connect-time identity
+  ACQ_PROGRAM = 1 << 1,  // cnc_rdprgnum
+  ACQ_STATUS = 1 << 2,   // cnc_statinfo
+  ACQ_SEQUENCE = 1 << 3, // cnc_rdseqnum
+  ACQ_POSITION = 1 << 4, // cnc_rdposition
+  ACQ_SPEED = 1 << 5,    // cnc_rdspeed
+  ACQ_ALARM = 1 << 6     // cnc_alarm
+} AcquisitionField;
+
+#define ACQ_ALL                                                                \
+  (ACQ_ID | ACQ_PROGRAM | ACQ_STATUS | ACQ_SEQUENCE | ACQ_POSITION | ACQ_SPEED \
+   | ACQ_ALARM)
+
+// Groups a single cnc_rddynamic2 call returns
+#define ACQ_DYNAMIC_GROUPS                                                     \
+  (ACQ_PROGRAM | ACQ_SEQUENCE | ACQ_POSITION | ACQ_SPEED | ACQ_ALARM)
+
+// Plan flag: fetch the dynamic groups with cnc_rddynamic2 instead of one call
+// per group
+#define ACQ_USE_DYNAMIC2 (1u << 16)
+
+// Plan flag: when no planned call reaches the control (e.g. --fields=id),
+// check the handle with one cnc_statinfo whose result is not kept
+#define ACQ_LIVENESS (1u << 17)
+
+// Set of AcquisitionField bits plus the plan flags above
+typedef unsigned int AcquisitionPlan;
+
+// How the dynamic groups of a plan are fetched
+typedef enum {
+  ACQ_MODE_AUTO = 0,      // cnc_rddynamic2 when it replaces two or more calls
+  ACQ_MODE_DYNAMIC = 1,   // cnc_rddynamic2 whenever the plan has dynamic data
+  ACQ_MODE_INDIVIDUAL = 2 // One call per group
+} AcquisitionMode;
+
+// FOCAS functions whose latency is recorded
+typedef enum {
+  FOCAS_FN_ALLCLIBHNDL3 = 0,
+  FOCAS_FN_FREELIBHNDL,
+  FOCAS_FN_RDCNCID,
+  FOCAS_FN_SYSINFO,
+  FOCAS_FN_RDAXISNAME,
+  FOCAS_FN_GETFIGURE,
+  FOCAS_FN_RDSPDLNAME,
+  FOCAS_FN_RDDYNAMIC2,
+  FOCAS_FN_RDPRGNUM,
+  FOCAS_FN_STATINFO,
+  FOCAS_FN_RDSEQNUM,
+  FOCAS_FN_RDPOSITION,
+  FOCAS_FN_RDSPEED,
+  FOCAS_FN_ALARM,
+  FOCAS_FN_COUNT
+} FocasFunction;
+
+// Latency histograms have LATENCY_SUB_BUCKETS linear buckets per power of two
+// microseconds, so a bucket is at most 25% wide, up to 2^26 us (~67 s)
+#define LATENCY_SUB_BUCKETS 4
+#define LATENCY_OCTAVES 24
+#define LATENCY_BUCKETS ((LATENCY_OCTAVES + 1) * LATENCY_SUB_BUCKETS)
+
+// Latency distribution of one FOCAS function on one machine
+typedef struct {
+  unsigned int buckets[LATENCY_BUCKETS];
+  unsigned int count;
+  unsigned int errors; // Calls that returned anything but EW_OK
+  double max_ms;
+  double total_ms; // Sum of all calls
+} LatencyHistogram;
+
+// Percentiles of a LatencyHistogram, in milliseconds
+typedef struct {
+  unsigned int count;
+  unsigned int errors;
+  double p50_ms;
+  double p90_ms;
+  double p99_ms;
+  double max_ms;
+  double total_ms;
+} LatencySummary;
+
+// One timed FOCAS call
+typedef struct {
+  FocasFunction function;
+  short result;
+  double ms;
+} LatencySample;
+
+// FOCAS calls timed by one thread, merged into the machine's histograms when
+// its result is published so calls are timed without taking the pool lock
+#define LATENCY_LOG_SIZE 16
+
+typedef struct {
+  int count;
+  LatencySample calls[LATENCY_LOG_SIZE];
+} LatencyLog;
+
 // Configuration and machine data structures
 typedef struct {
   char ip[100];
   int port;
   char config_file[256];
   char info_type[16];
+  char fields[128]; // Explicit acquisition fields, overrides info_type
+  char acquisition[16];
   char output_format[16];
   bool verbose;
   bool diagnose;
+  bool probe;             // Check each machine's port before connecting
   bool monitor_mode;
   bool show_status;
   int monitor_interval;
+  int active_interval_ms;
+  int offline_interval;
   int timeout;
+  int startup_budget;     // Seconds for the startup connect (0 = no limit)
+  int worker_threads;
+  int cycle_deadline_ms;
+  bool delta;             // Monitor output holds changes only
+  int keyframe_interval;  // Cycles between full snapshots in delta mode
+  char ndjson_file[256];  // NDJSON destination, stdout when empty
+  int rotate_size_mb;     // Rotate the NDJSON file at this size (0 = never)
+  int rotate_interval;    // Rotate the NDJSON file this often, seconds
+  int fsync_interval_ms;
+  char history_dir[256];  // Record every sample here (see history.c)
+  char history_query[50]; // Print this machine's history and exit
+  char history_from[32];  // Query range, see history_parse_time
+  char history_to[32];
+  char http_address[64];  // Serve snapshots over HTTP here (see http.c)
+  int http_port;          // 0 = no HTTP server
+  char mqtt_host[128];    // Publish samples to this broker (see mqtt.c)
+  int mqtt_port;
+  char mqtt_prefix[64];   // Topics are <prefix>/<machine>/state
+  char mqtt_client_id[64];
+  char sort[16];          // Console view order (see terminal.c)
+  char filter[64];        // Console view status classes, all when empty
 } Config;
 
-// Position information
+// Position of one axis, scaled by its decimal places
+typedef struct {
+  char name[3];    // Axis name plus optional suffix
+  double absolute; // Absolute (workpiece) coordinate
+  double relative; // Relative coordinate
+  double machine;  // Machine coordinate
+  double distance; // Distance to go
+} AxisPosition;
+
+// Tool position data for every axis the control reports. The array is inline
+// so MachineInfo can be copied by value; only axis_count entries are used.
 typedef struct {
-  double x_abs;
-  double y_abs;
-  double z_abs;
-  double x_rel;
-  double y_rel;
-  double z_rel;
+  int axis_count;
+  AxisPosition axes[MACHINE_MAX_AXES];
 } PositionInfo;
 
 // Speed information
@@ -53,18 +239,48 @@ typedef struct {
 
 // Complete machine information
 typedef struct {
-  char machine_id[36];   // Machine identifier
-  char program_name[16]; // O-number format
-  char status[16];       // RUNNING/STOPPED/PAUSED/ALARM
-  int program_number;    // Numeric program ID
-  long sequence_number;  // Current N-line
-  int program_line;      // Compatibility field
-  PositionInfo position; // Tool position data
-  SpeedInfo speed;       // Speed information
-  AlarmInfo alarm;       // Alarm status
-  time_t last_updated;   // When this info was collected
+  char machine_id[36];    // Machine identifier
+  char program_name[16];  // O-number format
+  char status[32];        // RUNNING/STOPPED/PAUSED/ALARM (MOVING)
+  short run_status;       // ODBST run behind status, -1 if the read failed
+  short motion_status;    // ODBST motion
+  int program_number;     // Numeric program ID
+  long sequence_number;   // Current N-line
+  int program_line;       // Compatibility field
+  PositionInfo position;  // Tool position data
+  SpeedInfo speed;        // Speed information
+  AlarmInfo alarm;        // Alarm status
+  time_t last_updated;    // When this info was collected
+  double sampled_ms;      // platform_monotonic_ms() when the read started
+  AcquisitionPlan fields; // Which groups this read requested
+  bool late;              // Missed the cycle deadline, data is from earlier
+  // Set by connection_pool_summarize_latency() for outputs that show them
+  LatencySummary latency[FOCAS_FN_COUNT]; // Call latency
+  LatencySummary read_latency;            // Whole reads
 } MachineInfo;
 
+// Static machine identity, read once after each successful connect. None of
+// it can change while a handle is open, so the per-cycle reads never ask for
+// it again; a reconnect refreshes it. Whether the control supports
+// cnc_rddynamic2 is learned on first use and kept alongside.
+typedef struct {
+  bool valid;                                  // Read since the last connect
+  char cnc_id[36];                             // cnc_rdcncid
+  char cnc_type[3];                            // cnc_sysinfo: "30", "0i", ...
+  char mt_type[3];                             // M, T, TT, ...
+  char series[5];                              // Software series
+  char version[5];                             // Software version
+  int max_axes;                                // Axes the control supports
+  int axis_count;                              // cnc_rdaxisname
+  char axis_names[MACHINE_MAX_AXES][3];        // Name plus optional suffix
+  bool axis_decimals_valid;                    // cnc_getfigure succeeded
+  short axis_decimals[MACHINE_MAX_AXES];       // Decimal places per axis
+  int spindle_count;                           // cnc_rdspdlname
+  char spindle_names[MACHINE_MAX_SPINDLES][5]; // Name plus up to 3 suffixes
+  bool no_dynamic2;                            // cnc_rddynamic2 unusable
+  double answered_ms;                          // Monotonic ms of last answer
+} MachineIdentity;
+
 // Connection states
 typedef enum {
   CONN_DISCONNECTED = 0,
@@ -74,6 +290,31 @@ typedef enum {
   CONN_BUSY = 4
 } ConnectionState;
 
+// Outcome of a TCP connect to a machine's FOCAS port (see probe.c)
+typedef enum {
+  PROBE_UNKNOWN = 0,    // Not probed yet
+  PROBE_OPEN = 1,       // The port accepted the connection
+  PROBE_REFUSED = 2,    // The host answered but nothing listens on the port
+  PROBE_TIMEOUT = 3,    // No answer: host down, wrong address or filtered
+  PROBE_UNREACHABLE = 4 // No route, unresolvable name or no socket
+} ProbeResult;
+
+// Circuit breaker states (see breaker.c)
+typedef enum {
+  BREAKER_CLOSED = 0,   // Attempts go ahead
+  BREAKER_OPEN = 1,     // Attempts are skipped until the backoff has passed
+  BREAKER_HALF_OPEN = 2 // One trial attempt after the backoff is under way
+} BreakerState;
+
+// Per-machine circuit breaker, written by the owning worker under the pool lock
+typedef struct {
+  BreakerState state;
+  int failures;        // Consecutive failed attempts
+  short last_error;    // FOCAS error of the latest failure
+  double retry_at_ms;  // Monotonic time an open breaker admits a trial
+  uint32_t jitter;     // xorshift32 state randomising the backoff
+} CircuitBreaker;
+
 // Individual machine connection handle
 typedef struct {
   char ip[100];
@@ -84,32 +325,259 @@ typedef struct {
   time_t connect_time;
   time_t last_activity;
   int retry_count;
+  int connections; // Successful connects, reconnects included
   char last_error[100];
-  MachineInfo last_info; // Cache last successful read
-  bool info_valid;       // Whether cached info is valid
-  bool enabled;          // Whether this machine is enabled
+  MachineIdentity identity; // Static data read at connect
+  MachineInfo last_info;    // Cache last successful read
+  bool info_valid;          // Whether cached info is valid
+  bool enabled;             // Whether this machine is enabled
+  int last_result;          // FocasResult of the most recent read attempt
+  bool in_flight;           // Claimed by a worker whose read has not finished
+  bool late;                // Still being read when its cycle was published
+  bool dirty;               // Published state changed since the last snapshot
+  LatencyHistogram latency[FOCAS_FN_COUNT]; // Guarded by the pool lock
+  LatencyHistogram read_latency; // Whole reads with any reconnect, pool lock
+  ProbeResult probe;             // Latest reachability probe
+  double probe_rtt_ms;           // Time the probe took to get its answer
+  double probe_time_ms;          // Monotonic time of the probe, 0 = never
+  CircuitBreaker breaker;        // Gates connects and reads after failures
 } MachineHandle;
 
-// Connection pool for multiple machines
+// Parallel collection engine (defined in collector.c)
+typedef struct Collector Collector;
+
+// Connection pool for multiple machines. Machines are heap allocated so their
+// addresses stay stable while the registry grows; the machine id is the index
+// into machines[] and names are resolved through an open-addressed hash index.
 typedef struct {
-  MachineHandle machines[MAX_MACHINES];
+  MachineHandle **machines;
   int machine_count;
+  int machine_capacity;
+  int *name_index;        // Hash slots holding machine id + 1 (0 = empty)
+  int name_index_size;    // Number of hash slots (power of two)
+  int *dirty_ids;         // Machines whose published state changed
+  int dirty_count;
   time_t pool_created;
   int total_connections;
   int successful_operations;
   int failed_operations;
+  int cycles;             // Completed connection_pool_read_machines calls
+  double last_cycle_ms;   // Duration of the latest one
+  double cycle_ms_total;  // Duration of all of them
   bool initialized;
+  PlatformMutex lock;     // Guards counters and results shared with workers
+  Collector *collector;   // Worker pool, NULL for sequential collection
+  int worker_threads;     // Threads the worker pool ran with, kept after stop
+  int cycle_deadline_ms;  // Publish after this long (0 = wait for all)
+  bool diagnose;          // Explain failures of the startup connect
+  AcquisitionPlan plan;   // FOCAS reads issued for every machine
+  int liveness_ms;        // Check a silent handle this often (0 = each read)
+  bool probe_ports;       // Gate connects on a port probe (see probe.c)
+  bool quiet;             // Drop per-machine diagnostics (pool lock)
 } ConnectionPool;
 
-// Multi-machine information structure
+// How a machine appears in the latest snapshot
+typedef enum {
+  READ_NONE = 0,       // Not published (disabled or never read)
+  READ_OK = 1,         // Fresh data from this cycle
+  READ_CACHED = 2,     // Read failed, previous data published
+  READ_LATE = 3,       // Missed the deadline, previous data published
+  READ_LATE_EMPTY = 4, // Missed the deadline, nothing to publish
+  READ_FAILED = 5      // Read failed and no previous data exists
+} MachineReadStatus;
+
+// Multi-machine information structure. The snapshot persists across cycles and
+// is updated incrementally from the machines that changed since the last call
+// to connection_pool_read_all_info(); release it with multi_machine_info_free.
 typedef struct {
-  int machine_count;
-  MachineInfo machines[MAX_MACHINES];
+  int machine_count;     // Published entries in machines[]
+  MachineInfo *machines; // Published entries, in pool order
+  int *machine_ids;      // Pool machine id of each published entry
   time_t collection_time;
   int successful_reads;
   int failed_reads;
+  int late_reads; // Machines still being read when the deadline passed
+
+  // Incremental bookkeeping, indexed by pool machine id
+  int tracked_count;          // Pool machines known to this snapshot
+  int capacity;               // Allocated slots in every array
+  int *entry_index;           // Published entry of each machine or -1
+  unsigned char *read_status; // MachineReadStatus of each machine
 } MultiMachineInfo;
 
+// Polling classes of the monitor scheduler
+typedef enum {
+  POLL_ACTIVE = 0, // RUNNING or in alarm
+  POLL_IDLE = 1,   // Connected and answering but not cutting
+  POLL_OFFLINE = 2 // Unreachable or the last read failed
+} PollClass;
+
+// Next read of one machine
+typedef struct {
+  double due_ms; // platform_monotonic_ms() time the read is due
+  int machine_id;
+} ScheduleEntry;
+
+// Per-machine deadline scheduler for monitor mode (see scheduler.c)
+typedef struct {
+  ScheduleEntry *heap; // Min-heap on due_ms, one entry per scheduled machine
+  int heap_count;
+  int capacity; // Allocated slots in heap and due_ids
+  int *due_ids; // Machines taken by the last scheduler_take_due
+  int due_count;
+  int tracked_count;  // Pool machines added so far
+  int interval_ms[3]; // Polling interval of each PollClass
+} Scheduler;
+
+// Growable byte buffer JSON and CSV documents are formatted into (see
+// serialize.c)
+typedef struct {
+  char *data;
+  size_t length;
+  size_t capacity;
+  bool failed; // An allocation failed, contents are incomplete
+} OutputBuffer;
+
+// What --delta output last wrote for each machine (see delta.c)
+typedef struct {
+  MachineInfo *emitted;     // Indexed by pool machine id
+  bool *valid;              // emitted[] holds data
+  AcquisitionPlan *changes; // Per snapshot entry, scratch for one cycle
+  int capacity;             // Slots in emitted, valid and changes
+  int keyframe_interval;
+  unsigned long cycles;     // Cycles written so far
+  OutputBuffer output;      // Reused for each JSON or CSV delta
+} DeltaTracker;
+
+// One machine sample in a history file (see history.c). Every field has an
+// explicit size and the layout has no padding, so files move between the
+// 32-bit Windows build and 64-bit Linux unchanged.
+typedef struct {
+  int64_t time_ms; // Wall clock, milliseconds since the Unix epoch
+  int32_t sequence_number;
+  int32_t program_number;
+  int32_t feed_rate;
+  int32_t spindle_speed;
+  int32_t alarm_status;
+  int16_t run_status; // ODBST run, -1 if the read failed
+  int16_t motion_status;
+  uint16_t fields;    // AcquisitionField groups the sample holds
+  uint8_t has_alarm;
+  uint8_t axis_count; // At most HISTORY_MAX_AXES
+  uint32_t reserved;
+  double absolute[HISTORY_MAX_AXES];
+  double machine[HISTORY_MAX_AXES];
+} HistoryRecord;
+
+// First bytes of a history file, followed by the records
+typedef struct {
+  char magic[8];         // HISTORY_MAGIC
+  uint32_t version;
+  uint32_t record_size;  // sizeof(HistoryRecord)
+  uint64_t record_count; // Raised after each record is in place
+  uint32_t axis_count;
+  char axis_names[HISTORY_MAX_AXES][4];
+  char machine[64];
+  char reserved[132];
+} HistoryHeader;
+
+// A mapped history file and the time index of its blocks
+typedef struct {
+  PlatformMap map;
+  HistoryHeader *header;   // Start of the mapping
+  HistoryRecord *records;  // Right after the header
+  size_t capacity;         // Records the mapping has room for
+  int64_t *block_start;    // time_ms of the first record of every block
+  size_t block_capacity;   // Allocated slots in block_start
+} HistoryFile;
+
+// History files of the pool's machines, opened on their first sample
+typedef struct {
+  char directory[256];
+  HistoryFile **files; // By pool machine id
+  double *written_ms;  // sampled_ms last appended, by pool machine id
+  int capacity;        // Allocated slots in files and written_ms
+} HistoryStore;
+
+// Streams NDJSON lines to stdout or a rotated file (see ndjson.c)
+typedef struct {
+  char path[256];        // Active file, stdout when empty
+  long long rotate_bytes; // 0 = no size limit
+  double rotate_ms;       // 0 = no age limit
+  double rotate_retry_ms; // No rotation before this after a failed rename
+  int fsync_interval_ms;  // Least time between syncs, 0 = every write
+  int fd;                 // -1 while no file is open
+  long long file_bytes;   // Length of the active file
+  double opened_ms;       // When the active file was opened
+  double synced_ms;       // Last fsync
+  bool unsynced;          // Written since the last fsync
+  time_t opened_stamp;    // Wall time the active file was opened
+  double *written_ms;     // sampled_ms last written, by pool machine id
+  int capacity;           // Allocated slots in written_ms
+  OutputBuffer output;
+} NdjsonWriter;
+
+// One machine line of the console view
+typedef struct {
+  int machine_id;
+  int entry;        // Published entry, -1 while there is no data
+  int status;       // TerminalStatus class
+  const char *name;
+} TerminalRow;
+
+// Redraws the console view in place, rewriting only the cells that changed
+// since the previous frame (see terminal.c)
+typedef struct {
+  bool ansi;          // stdout takes escape sequences
+  int sort;           // TerminalSort
+  unsigned filter;    // Bit per TerminalStatus shown, 0 = all
+  int rows;           // Size of the frame on screen
+  int columns;
+  char *screen;       // Cells on screen, rows * columns
+  char *frame;        // Cells of the frame being built
+  bool drawn;         // screen matches the terminal
+  int frames;         // Frames since the last full repaint
+  TerminalRow *lines; // Machines in display order
+  int capacity;       // Allocated slots in lines
+  OutputBuffer output;
+} TerminalRenderer;
+
+// Connection to the MQTT broker
+typedef enum {
+  MQTT_DISCONNECTED = 0, // Waiting to retry
+  MQTT_CONNECTING = 1,   // TCP connect in progress
+  MQTT_HANDSHAKE = 2,    // CONNECT sent, waiting for CONNACK
+  MQTT_CONNECTED = 3
+} MqttState;
+
+// Publishes machine samples to an MQTT broker (see mqtt.c)
+typedef struct {
+  char host[128];
+  int port;
+  char prefix[64];
+  char client_id[64];
+  int timeout_ms;               // Connect and acknowledgement timeout
+  PlatformSocket socket;
+  MqttState state;
+  double state_ms;              // When the state was entered
+  double sent_ms;               // Last packet queued, for keep-alive
+  double received_ms;           // Last packet from the broker
+  bool warned;                  // Outage already reported
+  int inflight;                 // QoS 1 publishes not acknowledged yet
+  unsigned short next_id;       // Packet identifier of the next publish
+  OutputBuffer outgoing;        // Packets the socket has not taken yet
+  size_t outgoing_sent;         // Leading bytes of outgoing already sent
+  OutputBuffer payload;         // One message while it is formatted
+  unsigned char incoming[64];   // Start of the next packet from the broker
+  size_t incoming_length;
+  double *published_ms;         // sampled_ms last published, by machine id
+  int capacity;                 // Allocated slots in published_ms
+  int cursor;                   // Entry to resume from under backpressure
+} MqttSink;
+
+// Embedded HTTP server for daemon mode (defined in http.c)
+typedef struct HttpServer HttpServer;
+
 // FOCAS result codes
 typedef enum {
   FOCAS_OK = 0,
@@ -130,7 +598,8 @@ typedef enum {
 typedef enum {
   OUTPUT_CONSOLE = 0,
   OUTPUT_JSON = 1,
-  OUTPUT_CSV = 2
+  OUTPUT_CSV = 2,
+  OUTPUT_NDJSON = 3 // One JSON line per machine sample
 } OutputFormat;
 
 // Function declarations
@@ -144,25 +613,105 @@ int parse_machine_spec(const char *spec, char *name, char *ip, int *port);
 FocasResult connection_pool_init(ConnectionPool *pool);
 FocasResult connection_pool_add_machine(ConnectionPool *pool, const char *name,
                                         const char *ip, int port);
-FocasResult connection_pool_connect_all(ConnectionPool *pool, bool diagnose);
+MachineHandle *connection_pool_get_machine(const ConnectionPool *pool,
+                                           int machine_id);
+int connection_pool_find_machine(const ConnectionPool *pool, const char *name);
+FocasResult connection_pool_connect_all(ConnectionPool *pool, bool diagnose,
+                                        int budget_ms);
 FocasResult connection_pool_disconnect_all(ConnectionPool *pool);
+FocasResult connection_pool_disconnect_machine(ConnectionPool *pool,
+                                               int machine_id);
 FocasResult connection_pool_read_all_info(ConnectionPool *pool,
                                           MultiMachineInfo *multi_info);
+FocasResult connection_pool_read_machines(ConnectionPool *pool,
+                                          const int *machine_ids, int count,
+                                          MultiMachineInfo *multi_info);
+void connection_pool_collect_machine(ConnectionPool *pool, int machine_id);
+void connection_pool_open_machine(ConnectionPool *pool, int machine_id);
+void connection_pool_mark_dirty(ConnectionPool *pool, int machine_id);
+void connection_pool_summarize_latency(ConnectionPool *pool,
+                                       MultiMachineInfo *multi_info);
+void multi_machine_info_init(MultiMachineInfo *multi_info);
+void multi_machine_info_free(MultiMachineInfo *multi_info);
 void connection_pool_print_status(const ConnectionPool *pool);
 void connection_pool_cleanup(ConnectionPool *pool);
 
+// Parallel collection
+FocasResult connection_pool_start_workers(ConnectionPool *pool,
+                                          int thread_count);
+void connection_pool_stop_workers(ConnectionPool *pool);
+Collector *collector_create(ConnectionPool *pool, int thread_count);
+int collector_run_cycle(Collector *collector, const int *machine_ids,
+                        int count, int deadline_ms);
+int collector_connect_all(Collector *collector, int deadline_ms);
+int collector_thread_count(const Collector *collector);
+void collector_destroy(Collector *collector);
+
+// Acquisition plans
+AcquisitionPlan acquisition_plan_for_info(const char *info_type);
+bool acquisition_plan_parse(const char *fields, AcquisitionPlan *plan);
+bool acquisition_mode_parse(const char *mode_str, AcquisitionMode *mode);
+AcquisitionPlan acquisition_plan_apply_mode(AcquisitionPlan plan,
+                                            AcquisitionMode mode);
+int acquisition_plan_call_count(AcquisitionPlan plan);
+void acquisition_plan_describe(AcquisitionPlan plan, char *buffer, size_t size);
+
+// FOCAS call latency
+const char *focas_function_name(FocasFunction function);
+void latency_log_add(LatencyLog *log, FocasFunction function, double started_ms,
+                     short result);
+void latency_log_merge(LatencyLog *log, LatencyHistogram *histograms);
+void latency_histogram_add(LatencyHistogram *histogram, double ms,
+                           bool failed);
+void latency_histogram_merge(LatencyHistogram *into,
+                             const LatencyHistogram *from);
+void latency_histogram_summarize(const LatencyHistogram *histogram,
+                                 LatencySummary *summary);
+
+// Monitor scheduling
+void scheduler_init(Scheduler *scheduler, int active_ms, int idle_ms,
+                    int offline_ms);
+void scheduler_free(Scheduler *scheduler);
+bool scheduler_sync(Scheduler *scheduler, const ConnectionPool *pool,
+                    double now_ms);
+int scheduler_take_due(Scheduler *scheduler, double now_ms,
+                       const int **machine_ids);
+void scheduler_complete(Scheduler *scheduler, ConnectionPool *pool,
+                        double now_ms);
+double scheduler_next_due(const Scheduler *scheduler, double now_ms);
+
 // Machine information reading
 FocasResult read_machine_info(const char *ip, int port, MachineInfo *info);
+FocasResult read_machine_identity(unsigned short handle,
+                                  MachineIdentity *identity, LatencyLog *log);
 FocasResult read_machine_info_from_handle(unsigned short handle,
-                                          MachineInfo *info);
+                                          MachineIdentity *identity,
+                                          AcquisitionPlan plan,
+                                          MachineInfo *info, LatencyLog *log);
 FocasResult read_complete_machine_info(Config *conf, MachineInfo *info);
 
+// Reachability probing
+int network_probe(ConnectionPool *pool, const int *machine_ids, int count,
+                  int timeout_ms);
+const char *probe_result_to_string(ProbeResult result);
+
+// Circuit breaker
+void breaker_init(CircuitBreaker *breaker, unsigned int seed);
+bool breaker_admit(CircuitBreaker *breaker, double now_ms);
+void breaker_succeed(CircuitBreaker *breaker);
+double breaker_fail(CircuitBreaker *breaker, short error, double now_ms);
+const char *breaker_state_to_string(BreakerState state);
+
 // Error handling and diagnostics
 const char *focas_error_to_string(short error_code);
 const char *get_connection_error_details(short error_code);
 
 // Output formatting
 void print_machine_info(const MachineInfo *info, const char *machine_name);
+void print_machine_identity(FILE *stream, const MachineIdentity *identity,
+                            const char *indent);
+void print_machine_latency(const LatencyHistogram *latency,
+                           const char *indent);
 void print_selective_machine_info(const MachineInfo *info,
                                   const char *machine_name,
                                   const char *info_type);
@@ -172,6 +721,92 @@ void print_machine_info_json(const MachineInfo *info, const char *machine_name);
 void print_machine_info_csv(const MachineInfo *info, const char *machine_name,
                             bool header);
 
+// Serialization
+void output_buffer_init(OutputBuffer *buffer);
+void output_buffer_free(OutputBuffer *buffer);
+void output_buffer_reset(OutputBuffer *buffer);
+void output_buffer_append(OutputBuffer *buffer, const char *data,
+                          size_t length);
+void output_buffer_puts(OutputBuffer *buffer, const char *text);
+void output_buffer_char(OutputBuffer *buffer, char c);
+void output_buffer_long(OutputBuffer *buffer, long value);
+void output_buffer_llong(OutputBuffer *buffer, long long value);
+void output_buffer_fixed(OutputBuffer *buffer, double value, int decimals);
+void output_buffer_json_string(OutputBuffer *buffer, const char *text);
+bool output_buffer_write(const OutputBuffer *buffer, int fd);
+void serialize_machine_name(OutputBuffer *buffer, int machine_id);
+void serialize_machine_info_json(OutputBuffer *buffer, const MachineInfo *info,
+                                 const char *machine_name, int machine_id);
+void serialize_csv_header(OutputBuffer *buffer);
+void serialize_machine_info_csv(OutputBuffer *buffer, const MachineInfo *info,
+                                const char *machine_name, int machine_id);
+void serialize_json_header(OutputBuffer *buffer,
+                           const MultiMachineInfo *multi_info);
+void serialize_multi_machine_info(OutputBuffer *buffer,
+                                  const MultiMachineInfo *multi_info,
+                                  OutputFormat format);
+
+// Prometheus metrics
+void serialize_metrics(OutputBuffer *buffer, ConnectionPool *pool,
+                       const MultiMachineInfo *multi_info);
+
+// Change-only monitor output
+void delta_tracker_init(DeltaTracker *tracker, int keyframe_interval);
+void delta_tracker_free(DeltaTracker *tracker);
+AcquisitionPlan machine_info_changes(const MachineInfo *previous,
+                                     const MachineInfo *current);
+int print_multi_machine_delta(DeltaTracker *tracker,
+                              const MultiMachineInfo *multi_info,
+                              const char *info_type, OutputFormat format);
+
+// NDJSON streaming output
+bool ndjson_writer_open(NdjsonWriter *writer, const Config *conf);
+void ndjson_writer_close(NdjsonWriter *writer);
+int ndjson_writer_write(NdjsonWriter *writer, const ConnectionPool *pool,
+                        const MultiMachineInfo *multi_info);
+void serialize_machine_info_ndjson(OutputBuffer *buffer,
+                                   const MachineInfo *info,
+                                   const MachineHandle *machine,
+                                   double wall_offset_ms);
+
+// Console view
+bool terminal_sort_parse(const char *sort, int *order);
+bool terminal_filter_parse(const char *filter, unsigned *statuses);
+void terminal_renderer_init(TerminalRenderer *renderer, const char *sort,
+                            const char *filter);
+void terminal_renderer_free(TerminalRenderer *renderer);
+int terminal_renderer_draw(TerminalRenderer *renderer, ConnectionPool *pool,
+                           const MultiMachineInfo *multi_info);
+
+// MQTT publishing
+bool mqtt_sink_open(MqttSink *sink, const Config *conf);
+void mqtt_sink_close(MqttSink *sink);
+void mqtt_sink_poll(MqttSink *sink);
+int mqtt_sink_publish(MqttSink *sink, const ConnectionPool *pool,
+                      const MultiMachineInfo *multi_info);
+
+// Machine history
+void history_store_init(HistoryStore *store, const char *directory);
+void history_store_free(HistoryStore *store);
+int history_store_append(HistoryStore *store, const ConnectionPool *pool,
+                         const MultiMachineInfo *multi_info);
+void history_file_path(const char *directory, const char *machine, char *path,
+                       size_t size);
+bool history_file_open(HistoryFile *file, const char *path, bool writable);
+void history_file_close(HistoryFile *file);
+size_t history_file_count(const HistoryFile *file);
+bool history_file_append(HistoryFile *file, const HistoryRecord *record);
+size_t history_file_seek(const HistoryFile *file, int64_t time_ms);
+bool history_parse_time(const char *text, int64_t *time_ms);
+int history_query(const char *directory, const char *machine, int64_t from_ms,
+                  int64_t to_ms, OutputFormat format);
+
+// HTTP snapshot server
+HttpServer *http_server_start(const char *address, int port);
+bool http_server_publish(HttpServer *server, ConnectionPool *pool,
+                         const MultiMachineInfo *multi_info);
+void http_server_stop(HttpServer *server);
+
 // Monitoring
 int monitor_machines(ConnectionPool *pool, Config *conf);
 
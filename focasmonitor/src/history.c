@@ -0,0 +1,573 @@
+#include "focasmonitor.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Append-only machine history. Each machine has one file in the history
+// directory: a HistoryHeader followed by fixed-width HistoryRecords in time
+// order, mapped into memory so appending is a copy and reading is a pointer
+// walk. Records are grouped in blocks of HISTORY_BLOCK_RECORDS and the time of
+// every block's first record is kept in memory, so finding a time is a binary
+// search over blocks plus a scan of one block.
+//
+// header->record_count is only raised once a record is fully written, so a
+// crash leaves at most an ignored partial record. The file is mapped whole,
+// which bounds it by the address space of the 32-bit build.
+
+#define HISTORY_MAGIC "FOCHIST"
+#define HISTORY_VERSION 1
+
+// Records a new file has room for, and the most a file grows by at once
+#define HISTORY_INITIAL_RECORDS 4096
+#define HISTORY_GROWTH_RECORDS 65536
+
+typedef char history_record_is_fixed_width[sizeof(HistoryRecord) == 168 ? 1
+                                                                         : -1];
+typedef char history_header_is_fixed_width[sizeof(HistoryHeader) == 256 ? 1
+                                                                         : -1];
+
+static size_t history_file_size(size_t records) {
+  return sizeof(HistoryHeader) + records * sizeof(HistoryRecord);
+}
+
+// Point header and records at the mapping after it was created or moved
+static void history_file_attach(HistoryFile *file) {
+  file->header = file->map.data;
+  file->records = file->header ? (HistoryRecord *) (file->header + 1) : NULL;
+  file->capacity = file->header ? (file->map.size - sizeof(HistoryHeader))
+                                      / sizeof(HistoryRecord)
+                                : 0;
+}
+
+static bool history_file_index(HistoryFile *file, size_t block) {
+  if (block >= file->block_capacity) {
+    size_t capacity = file->block_capacity > 0 ? file->block_capacity * 2
+                                               : 64;
+    while (capacity <= block) {
+      capacity *= 2;
+    }
+    int64_t *block_start =
+        realloc(file->block_start, capacity * sizeof(int64_t));
+    if (!block_start) {
+      return false;
+    }
+    file->block_start = block_start;
+    file->block_capacity = capacity;
+  }
+  file->block_start[block] =
+      file->records[block * HISTORY_BLOCK_RECORDS].time_ms;
+  return true;
+}
+
+bool history_file_open(HistoryFile *file, const char *path, bool writable) {
+  memset(file, 0, sizeof(HistoryFile));
+  if (!platform_map_open(&file->map, path, writable)) {
+    return false;
+  }
+
+  if (file->map.size == 0 && writable) {
+    if (!platform_map_resize(&file->map,
+                             history_file_size(HISTORY_INITIAL_RECORDS))) {
+      platform_map_close(&file->map);
+      return false;
+    }
+    history_file_attach(file);
+    memset(file->header, 0, sizeof(HistoryHeader));
+    memcpy(file->header->magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC));
+    file->header->version = HISTORY_VERSION;
+    file->header->record_size = sizeof(HistoryRecord);
+    return true;
+  }
+
+  if (file->map.size < sizeof(HistoryHeader)) {
+    platform_map_close(&file->map);
+    return false;
+  }
+  history_file_attach(file);
+  if (memcmp(file->header->magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC)) != 0
+      || file->header->version != HISTORY_VERSION
+      || file->header->record_size != sizeof(HistoryRecord)
+      || file->header->record_count > file->capacity) {
+    platform_map_close(&file->map);
+    return false;
+  }
+
+  size_t count = history_file_count(file);
+  for (size_t block = 0; block * HISTORY_BLOCK_RECORDS < count; block++) {
+    if (!history_file_index(file, block)) {
+      history_file_close(file);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Writable files are trimmed to their records so the growth slack does not
+// stay on disk
+void history_file_close(HistoryFile *file) {
+  if (!file) {
+    return;
+  }
+
+  if (file->header && file->map.writable) {
+    size_t size = history_file_size(history_file_count(file));
+    platform_map_resize(&file->map, size);
+    platform_map_sync(&file->map);
+  }
+  platform_map_close(&file->map);
+  free(file->block_start);
+  memset(file, 0, sizeof(HistoryFile));
+}
+
+size_t history_file_count(const HistoryFile *file) {
+  return (size_t) file->header->record_count;
+}
+
+// Append one record. Times never go backwards within a file, so a record
+// older than the last one is stored with the last one's time.
+bool history_file_append(HistoryFile *file, const HistoryRecord *record) {
+  size_t count = history_file_count(file);
+  if (count == file->capacity) {
+    size_t growth = count < HISTORY_GROWTH_RECORDS ? count
+                                                   : HISTORY_GROWTH_RECORDS;
+    if (growth == 0) {
+      growth = HISTORY_INITIAL_RECORDS;
+    }
+    bool grown =
+        platform_map_resize(&file->map, history_file_size(count + growth));
+    if (!grown) {
+      // Map the records already written again at their old size
+      platform_map_resize(&file->map, history_file_size(count));
+    }
+    history_file_attach(file);
+    if (!grown) {
+      return false;
+    }
+  }
+
+  HistoryRecord *slot = &file->records[count];
+  *slot = *record;
+  if (count > 0 && slot->time_ms < file->records[count - 1].time_ms) {
+    slot->time_ms = file->records[count - 1].time_ms;
+  }
+  if (count % HISTORY_BLOCK_RECORDS == 0
+      && !history_file_index(file, count / HISTORY_BLOCK_RECORDS)) {
+    return false;
+  }
+  file->header->record_count = count + 1;
+  return true;
+}
+
+// Index of the first record at or after time_ms, history_file_count() if
+// there is none
+size_t history_file_seek(const HistoryFile *file, int64_t time_ms) {
+  size_t count = history_file_count(file);
+  size_t blocks = (count + HISTORY_BLOCK_RECORDS - 1) / HISTORY_BLOCK_RECORDS;
+
+  // Last block starting before time_ms; the match is in it or starts the next
+  size_t low = 0;
+  size_t high = blocks;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (file->block_start[middle] < time_ms) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  size_t index = low > 0 ? (low - 1) * HISTORY_BLOCK_RECORDS : 0;
+  while (index < count && file->records[index].time_ms < time_ms) {
+    index++;
+  }
+  return index;
+}
+
+// FNV-1a hash of a machine name for its file name
+static unsigned int history_name_hash(const char *name) {
+  unsigned int hash = 2166136261u;
+  while (*name) {
+    hash ^= (unsigned char) *name++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// File name for a machine; characters that are not safe in file names on
+// Windows or Linux are replaced. A name that had to be changed or shortened
+// gets the hash of the full name appended, so e.g. "Mill 1" and "Mill/1" do
+// not share a file.
+void history_file_path(const char *directory, const char *machine, char *path,
+                       size_t size) {
+  char name[64];
+  size_t length = 0;
+  bool altered = strlen(machine) > sizeof(name) - 1;
+  size_t limit = altered ? sizeof(name) - 10 : sizeof(name) - 1;
+  for (const char *c = machine; *c && length < limit; c++) {
+    bool safe = (*c >= 'A' && *c <= 'Z') || (*c >= 'a' && *c <= 'z')
+                || (*c >= '0' && *c <= '9') || *c == '-' || *c == '_'
+                || *c == '.';
+    name[length++] = safe ? *c : '_';
+    altered = altered || !safe;
+  }
+  name[length] = '\0';
+
+  if (altered) {
+    snprintf(path, size, "%s/%s-%08x.hist", directory, name,
+             history_name_hash(machine));
+  } else {
+    snprintf(path, size, "%s/%s.hist", directory, name);
+  }
+}
+
+void history_store_init(HistoryStore *store, const char *directory) {
+  memset(store, 0, sizeof(HistoryStore));
+  strncpy(store->directory, directory, sizeof(store->directory) - 1);
+}
+
+void history_store_free(HistoryStore *store) {
+  if (!store) {
+    return;
+  }
+
+  for (int i = 0; i < store->capacity; i++) {
+    if (store->files[i]) {
+      history_file_close(store->files[i]);
+      free(store->files[i]);
+    }
+  }
+  free(store->files);
+  free(store->written_ms);
+  memset(store, 0, sizeof(HistoryStore));
+}
+
+// Make room for pool machine ids below machine_count, returns false on
+// allocation failure
+static bool history_store_reserve(HistoryStore *store, int machine_count) {
+  if (machine_count <= store->capacity) {
+    return true;
+  }
+
+  int capacity = store->capacity > 0 ? store->capacity
+                                     : INITIAL_MACHINE_CAPACITY;
+  while (capacity < machine_count) {
+    capacity *= 2;
+  }
+
+  HistoryFile **files =
+      realloc(store->files, (size_t) capacity * sizeof(HistoryFile *));
+  if (!files) {
+    return false;
+  }
+  memset(files + store->capacity, 0,
+         (size_t) (capacity - store->capacity) * sizeof(HistoryFile *));
+  store->files = files;
+
+  double *written_ms =
+      realloc(store->written_ms, (size_t) capacity * sizeof(double));
+  if (!written_ms) {
+    return false;
+  }
+  memset(written_ms + store->capacity, 0,
+         (size_t) (capacity - store->capacity) * sizeof(double));
+  store->written_ms = written_ms;
+
+  store->capacity = capacity;
+  return true;
+}
+
+static HistoryFile *history_store_file(HistoryStore *store,
+                                       const MachineHandle *machine) {
+  char path[sizeof(store->directory) + 72];
+  history_file_path(store->directory, machine->friendly_name, path,
+                    sizeof(path));
+
+  HistoryFile *file = malloc(sizeof(HistoryFile));
+  if (!file || !history_file_open(file, path, true)) {
+    fprintf(stderr, "Error: Cannot open history file '%s'\n", path);
+    free(file);
+    return NULL;
+  }
+  if (file->header->machine[0] == '\0') {
+    strncpy(file->header->machine, machine->friendly_name,
+            sizeof(file->header->machine) - 1);
+  } else if (strncmp(file->header->machine, machine->friendly_name,
+                     sizeof(file->header->machine) - 1)
+             != 0) {
+    // Never mix two machines' samples in one file
+    fprintf(stderr, "Error: History file '%s' belongs to machine '%s'\n",
+            path, file->header->machine);
+    history_file_close(file);
+    free(file);
+    return NULL;
+  }
+  return file;
+}
+
+static void history_record_from_info(HistoryRecord *record,
+                                     const MachineInfo *info,
+                                     double wall_offset_ms) {
+  memset(record, 0, sizeof(HistoryRecord));
+  record->time_ms = llround(info->sampled_ms + wall_offset_ms);
+  record->fields = (uint16_t) (info->fields & ACQ_ALL);
+  record->sequence_number = (int32_t) info->sequence_number;
+  record->program_number = info->program_number;
+  record->run_status = (int16_t) info->run_status;
+  record->motion_status = (int16_t) info->motion_status;
+  record->feed_rate = info->speed.feed_rate;
+  record->spindle_speed = info->speed.spindle_speed;
+  record->has_alarm = info->alarm.has_alarm ? 1 : 0;
+  record->alarm_status = info->alarm.alarm_status;
+  int axes = info->position.axis_count < HISTORY_MAX_AXES
+                 ? info->position.axis_count
+                 : HISTORY_MAX_AXES;
+  record->axis_count = (uint8_t) axes;
+  for (int i = 0; i < axes; i++) {
+    record->absolute[i] = info->position.axes[i].absolute;
+    record->machine[i] = info->position.axes[i].machine;
+  }
+}
+
+// Append every machine with a sample newer than the last one stored. Returns
+// the number of records appended, or -1 on failure.
+int history_store_append(HistoryStore *store, const ConnectionPool *pool,
+                         const MultiMachineInfo *multi_info) {
+  if (!history_store_reserve(store, pool->machine_count)) {
+    fprintf(stderr, "Error: Out of memory recording history\n");
+    return -1;
+  }
+
+  double wall_offset_ms = platform_wall_ms() - platform_monotonic_ms();
+  int appended = 0;
+  for (int i = 0; i < multi_info->machine_count; i++) {
+    const MachineInfo *info = &multi_info->machines[i];
+    int id = multi_info->machine_ids[i];
+    const MachineHandle *machine = connection_pool_get_machine(pool, id);
+    if (!machine || info->sampled_ms == store->written_ms[id]) {
+      continue;
+    }
+
+    if (!store->files[id]) {
+      store->files[id] = history_store_file(store, machine);
+      if (!store->files[id]) {
+        return -1;
+      }
+    }
+    HistoryFile *file = store->files[id];
+
+    // Axis names are taken from the first sample that has positions
+    if (file->header->axis_count == 0 && info->position.axis_count > 0) {
+      int axes = info->position.axis_count < HISTORY_MAX_AXES
+                     ? info->position.axis_count
+                     : HISTORY_MAX_AXES;
+      for (int a = 0; a < axes; a++) {
+        memcpy(file->header->axis_names[a], info->position.axes[a].name,
+               sizeof(info->position.axes[a].name));
+      }
+      file->header->axis_count = (uint32_t) axes;
+    }
+
+    HistoryRecord record;
+    history_record_from_info(&record, info, wall_offset_ms);
+    if (!history_file_append(file, &record)) {
+      // Reopened with the next sample
+      fprintf(stderr, "Error: Cannot grow history file of %s\n",
+              machine->friendly_name);
+      history_file_close(file);
+      free(file);
+      store->files[id] = NULL;
+      return -1;
+    }
+    store->written_ms[id] = info->sampled_ms;
+    appended++;
+  }
+  return appended;
+}
+
+// Milliseconds since the epoch from "<seconds>[.fraction]" or a local
+// "YYYY-MM-DD[ HH:MM[:SS]]" (a T may separate date and time)
+bool history_parse_time(const char *text, int64_t *time_ms) {
+  struct tm local;
+  memset(&local, 0, sizeof(local));
+  char separator = ' ';
+  int fields = sscanf(text, "%d-%d-%d%c%d:%d:%d", &local.tm_year,
+                      &local.tm_mon, &local.tm_mday, &separator,
+                      &local.tm_hour, &local.tm_min, &local.tm_sec);
+  if (fields == 3 || (fields >= 6 && (separator == ' ' || separator == 'T'))) {
+    local.tm_year -= 1900;
+    local.tm_mon -= 1;
+    local.tm_isdst = -1;
+    time_t seconds = mktime(&local);
+    if (seconds == (time_t) -1) {
+      return false;
+    }
+    *time_ms = (int64_t) seconds * 1000;
+    return true;
+  }
+
+  char *end;
+  double seconds = strtod(text, &end);
+  if (end == text || *end != '\0') {
+    return false;
+  }
+  *time_ms = llround(seconds * 1000.0);
+  return true;
+}
+
+static void history_serialize_csv(OutputBuffer *buffer,
+                                  const HistoryHeader *header,
+                                  const HistoryRecord *record) {
+  output_buffer_llong(buffer, record->time_ms);
+  output_buffer_char(buffer, ',');
+  if (record->fields & ACQ_STATUS) {
+    output_buffer_long(buffer, record->run_status);
+    output_buffer_char(buffer, ',');
+    output_buffer_long(buffer, record->motion_status);
+  } else {
+    output_buffer_char(buffer, ',');
+  }
+  output_buffer_char(buffer, ',');
+  if (record->fields & ACQ_PROGRAM) {
+    output_buffer_long(buffer, record->program_number);
+  }
+  output_buffer_char(buffer, ',');
+  if (record->fields & ACQ_SEQUENCE) {
+    output_buffer_long(buffer, record->sequence_number);
+  }
+  output_buffer_char(buffer, ',');
+  if (record->fields & ACQ_SPEED) {
+    output_buffer_long(buffer, record->feed_rate);
+    output_buffer_char(buffer, ',');
+    output_buffer_long(buffer, record->spindle_speed);
+  } else {
+    output_buffer_char(buffer, ',');
+  }
+  output_buffer_char(buffer, ',');
+  if (record->fields & ACQ_ALARM) {
+    output_buffer_puts(buffer, record->has_alarm ? "true" : "false");
+    output_buffer_char(buffer, ',');
+    output_buffer_long(buffer, record->alarm_status);
+  } else {
+    output_buffer_char(buffer, ',');
+  }
+  // One column pair per axis in the header; missing axes stay empty
+  for (uint32_t a = 0; a < header->axis_count; a++) {
+    output_buffer_char(buffer, ',');
+    if ((record->fields & ACQ_POSITION) && a < record->axis_count) {
+      output_buffer_fixed(buffer, record->absolute[a], 3);
+      output_buffer_char(buffer, ',');
+      output_buffer_fixed(buffer, record->machine[a], 3);
+    } else {
+      output_buffer_char(buffer, ',');
+    }
+  }
+  output_buffer_char(buffer, '\n');
+}
+
+static void history_serialize_json(OutputBuffer *buffer,
+                                   const HistoryHeader *header,
+                                   const HistoryRecord *record) {
+  output_buffer_puts(buffer, "{\"time_ms\":");
+  output_buffer_llong(buffer, record->time_ms);
+  output_buffer_puts(buffer, ",\"machine\":");
+  output_buffer_json_string(buffer, header->machine);
+  if (record->fields & ACQ_STATUS) {
+    output_buffer_puts(buffer, ",\"run_status\":");
+    output_buffer_long(buffer, record->run_status);
+    output_buffer_puts(buffer, ",\"motion_status\":");
+    output_buffer_long(buffer, record->motion_status);
+  }
+  if (record->fields & ACQ_PROGRAM) {
+    output_buffer_puts(buffer, ",\"program_number\":");
+    output_buffer_long(buffer, record->program_number);
+  }
+  if (record->fields & ACQ_SEQUENCE) {
+    output_buffer_puts(buffer, ",\"sequence_number\":");
+    output_buffer_long(buffer, record->sequence_number);
+  }
+  if (record->fields & ACQ_POSITION) {
+    output_buffer_puts(buffer, ",\"position\":[");
+    for (int a = 0; a < record->axis_count; a++) {
+      output_buffer_puts(buffer, a > 0 ? ",{\"axis\":" : "{\"axis\":");
+      output_buffer_json_string(buffer, (uint32_t) a < header->axis_count
+                                            ? header->axis_names[a]
+                                            : "");
+      output_buffer_puts(buffer, ",\"absolute\":");
+      output_buffer_fixed(buffer, record->absolute[a], 3);
+      output_buffer_puts(buffer, ",\"machine\":");
+      output_buffer_fixed(buffer, record->machine[a], 3);
+      output_buffer_char(buffer, '}');
+    }
+    output_buffer_char(buffer, ']');
+  }
+  if (record->fields & ACQ_SPEED) {
+    output_buffer_puts(buffer, ",\"feed_rate\":");
+    output_buffer_long(buffer, record->feed_rate);
+    output_buffer_puts(buffer, ",\"spindle_speed\":");
+    output_buffer_long(buffer, record->spindle_speed);
+  }
+  if (record->fields & ACQ_ALARM) {
+    output_buffer_puts(buffer, ",\"has_alarm\":");
+    output_buffer_puts(buffer, record->has_alarm ? "true" : "false");
+    output_buffer_puts(buffer, ",\"alarm_status\":");
+    output_buffer_long(buffer, record->alarm_status);
+  }
+  output_buffer_puts(buffer, "}\n");
+}
+
+// Print a machine's records from from_ms to to_ms inclusive, as one JSON line
+// each for json and ndjson and as CSV otherwise. Output is written in chunks
+// so a long range does not build up in memory. Returns the number of records
+// printed, or -1 if the file cannot be read.
+int history_query(const char *directory, const char *machine, int64_t from_ms,
+                  int64_t to_ms, OutputFormat format) {
+  char path[512];
+  history_file_path(directory, machine, path, sizeof(path));
+  HistoryFile file;
+  if (!history_file_open(&file, path, false)) {
+    fprintf(stderr, "Error: Cannot read history file '%s'\n", path);
+    return -1;
+  }
+
+  bool json = format == OUTPUT_JSON || format == OUTPUT_NDJSON;
+  OutputBuffer buffer;
+  output_buffer_init(&buffer);
+  if (!json) {
+    output_buffer_puts(&buffer, "time_ms,run_status,motion_status,"
+                                "program_number,sequence_number,feed_rate,"
+                                "spindle_speed,has_alarm,alarm_status");
+    for (uint32_t a = 0; a < file.header->axis_count; a++) {
+      const char *axis = file.header->axis_names[a];
+      output_buffer_char(&buffer, ',');
+      output_buffer_puts(&buffer, axis);
+      output_buffer_puts(&buffer, "_absolute,");
+      output_buffer_puts(&buffer, axis);
+      output_buffer_puts(&buffer, "_machine");
+    }
+    output_buffer_char(&buffer, '\n');
+  }
+
+  int printed = 0;
+  size_t count = history_file_count(&file);
+  for (size_t i = history_file_seek(&file, from_ms);
+       i < count && file.records[i].time_ms <= to_ms; i++) {
+    if (json) {
+      history_serialize_json(&buffer, file.header, &file.records[i]);
+    } else {
+      history_serialize_csv(&buffer, file.header, &file.records[i]);
+    }
+    printed++;
+    if (buffer.length >= 65536) {
+      output_buffer_write(&buffer, 1);
+      output_buffer_reset(&buffer);
+    }
+  }
+  output_buffer_write(&buffer, 1);
+
+  output_buffer_free(&buffer);
+  history_file_close(&file);
+  return printed;
+}
@@ -0,0 +1,665 @@
+#include "focasmonitor.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+// Embedded HTTP server for daemon mode. The monitor loop renders every
+// published cycle once into an immutable HttpSnapshot: the whole snapshot as
+// one JSON document followed by a JSON document per machine, each with an
+// ETag. Requests are answered straight from that memory by one thread polling
+// non-blocking sockets, so a dashboard refresh costs a memcpy into the socket
+// and never a FOCAS call.
+//
+//   GET /machines         Every machine, as --output=json with real names
+//   GET /machines/<name>  One machine
+//   GET /metrics          Prometheus exposition (see metrics.c)
+//
+// A request whose If-None-Match carries the current ETag gets 304 Not
+// Modified. Machine documents have weak ETags hashed from the machine state
+// only, leaving out the timestamps and latency figures that change with every
+// read, so a poller gets 304 for as long as nothing it shows has changed. The
+// snapshot's ETag covers every machine's state and the read counts; metrics
+// are hashed from their bytes. Snapshots are reference counted so a slow
+// client keeps the one it is being sent while newer ones are published.
+//
+// A connection that neither sends nor takes data for HTTP_IDLE_MS is closed,
+// so idle keep-alive clients do not hold the HTTP_MAX_CLIENTS slots.
+
+#define HTTP_MAX_CLIENTS 64
+#define HTTP_REQUEST_MAX 8192
+#define HTTP_POLL_MS 200
+#define HTTP_IDLE_MS 5000
+
+#define HTTP_FNV_OFFSET 14695981039346656037ull
+
+#define HTTP_JSON "application/json"
+#define HTTP_TEXT "text/plain"
+#define HTTP_PROMETHEUS "text/plain; version=0.0.4; charset=utf-8"
+
+// One document inside a snapshot body
+typedef struct {
+  char name[50]; // Machine name, empty for metrics
+  size_t offset;
+  size_t length;
+  char etag[24]; // Quoted, as sent
+} HttpEntry;
+
+typedef struct {
+  int refs; // Guarded by the server lock
+  OutputBuffer body;
+  size_t snapshot_length; // The snapshot document starts the body
+  char etag[24];
+  HttpEntry *entries;
+  int entry_count;
+  HttpEntry metrics; // After the machine documents
+} HttpSnapshot;
+
+typedef struct {
+  PlatformSocket socket;
+  char request[HTTP_REQUEST_MAX];
+  size_t request_length;
+  char header[512];
+  size_t header_length;
+  HttpSnapshot *snapshot; // Held until its body is sent
+  const char *body;
+  size_t body_length;
+  size_t sent; // Bytes of header and then body sent
+  bool sending;
+  bool close_after;
+  double active_ms; // Last time data was received or sent
+} HttpClient;
+
+struct HttpServer {
+  PlatformSocket listener;
+  PlatformThread thread;
+  PlatformMutex lock;
+  bool stopping;           // Guarded by lock
+  HttpSnapshot *current;   // Guarded by lock, NULL before the first publish
+  HttpClient *clients;     // Server thread only
+  int client_count;
+  PlatformPollFd *poll_fds;
+};
+
+// FNV-1a over data, continuing from hash
+static unsigned long long http_hash(unsigned long long hash, const void *data,
+                                    size_t length) {
+  const unsigned char *bytes = data;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// A hash as a quoted ETag, weak when it stands for state rather than bytes
+static void http_etag(unsigned long long hash, bool weak, char *etag) {
+  static const char hex[] = "0123456789abcdef";
+  if (weak) {
+    *etag++ = 'W';
+    *etag++ = '/';
+  }
+  etag[0] = '"';
+  for (int i = 0; i < 16; i++) {
+    etag[16 - i] = hex[hash & 0xf];
+    hash >>= 4;
+  }
+  etag[17] = '"';
+  etag[18] = '\0';
+}
+
+// Hash of a machine document without its sample time and latency figures.
+// The document is rendered into scratch; returns false if that failed.
+static bool http_state_hash(OutputBuffer *scratch, const MachineInfo *info,
+                            const char *name, unsigned long long *hash) {
+  MachineInfo state = *info;
+  state.last_updated = 0;
+  memset(state.latency, 0, sizeof(state.latency));
+  output_buffer_reset(scratch);
+  serialize_machine_info_json(scratch, &state, name, -1);
+  *hash = http_hash(HTTP_FNV_OFFSET, scratch->data, scratch->length);
+  return !scratch->failed;
+}
+
+static void http_snapshot_free(HttpSnapshot *snapshot) {
+  output_buffer_free(&snapshot->body);
+  free(snapshot->entries);
+  free(snapshot);
+}
+
+static void http_snapshot_release(HttpServer *server, HttpSnapshot *snapshot) {
+  if (!snapshot) {
+    return;
+  }
+
+  platform_mutex_lock(&server->lock);
+  bool last = --snapshot->refs == 0;
+  platform_mutex_unlock(&server->lock);
+  if (last) {
+    http_snapshot_free(snapshot);
+  }
+}
+
+// Render the published state into a new snapshot and make it current.
+// Returns false if it could not be allocated; the previous one stays current.
+bool http_server_publish(HttpServer *server, ConnectionPool *pool,
+                         const MultiMachineInfo *multi_info) {
+  HttpSnapshot *snapshot = calloc(1, sizeof(HttpSnapshot));
+  if (!snapshot) {
+    return false;
+  }
+  output_buffer_init(&snapshot->body);
+  snapshot->entries =
+      malloc((size_t) (multi_info->machine_count + 1) * sizeof(HttpEntry));
+  if (!snapshot->entries) {
+    http_snapshot_free(snapshot);
+    return false;
+  }
+
+  OutputBuffer *body = &snapshot->body;
+  serialize_json_header(body, multi_info);
+  for (int i = 0; i < multi_info->machine_count; i++) {
+    const MachineHandle *machine =
+        connection_pool_get_machine(pool, multi_info->machine_ids[i]);
+    serialize_machine_info_json(body, &multi_info->machines[i],
+                                machine ? machine->friendly_name : "", -1);
+    output_buffer_puts(body, i < multi_info->machine_count - 1 ? ",\n" : "\n");
+  }
+  output_buffer_puts(body, "  ]\n}\n");
+  snapshot->snapshot_length = body->length;
+
+  // The snapshot's ETag covers the read counts and every machine's state
+  int counts[4] = {multi_info->machine_count, multi_info->successful_reads,
+                   multi_info->failed_reads, multi_info->late_reads};
+  unsigned long long snapshot_hash =
+      http_hash(HTTP_FNV_OFFSET, counts, sizeof(counts));
+  OutputBuffer scratch;
+  output_buffer_init(&scratch);
+  bool hashed = true;
+  for (int i = 0; i < multi_info->machine_count; i++) {
+    const MachineHandle *machine =
+        connection_pool_get_machine(pool, multi_info->machine_ids[i]);
+    const char *name = machine ? machine->friendly_name : "";
+    unsigned long long hash;
+    hashed = http_state_hash(&scratch, &multi_info->machines[i], name, &hash)
+             && hashed;
+    snapshot_hash = http_hash(snapshot_hash, &hash, sizeof(hash));
+    if (!machine) {
+      continue;
+    }
+
+    HttpEntry *entry = &snapshot->entries[snapshot->entry_count++];
+    strncpy(entry->name, machine->friendly_name, sizeof(entry->name) - 1);
+    entry->name[sizeof(entry->name) - 1] = '\0';
+    entry->offset = body->length;
+    serialize_machine_info_json(body, &multi_info->machines[i],
+                                machine->friendly_name, -1);
+    output_buffer_char(body, '\n');
+    entry->length = body->length - entry->offset;
+    http_etag(hash, true, entry->etag);
+  }
+  output_buffer_free(&scratch);
+  http_etag(snapshot_hash, true, snapshot->etag);
+
+  snapshot->metrics.offset = body->length;
+  serialize_metrics(body, pool, multi_info);
+  snapshot->metrics.length = body->length - snapshot->metrics.offset;
+  if (body->failed || !hashed) {
+    http_snapshot_free(snapshot);
+    return false;
+  }
+
+  // Hash once the body can no longer move
+  http_etag(http_hash(HTTP_FNV_OFFSET, body->data + snapshot->metrics.offset,
+                      snapshot->metrics.length),
+            false, snapshot->metrics.etag);
+
+  snapshot->refs = 1;
+  platform_mutex_lock(&server->lock);
+  HttpSnapshot *previous = server->current;
+  server->current = snapshot;
+  platform_mutex_unlock(&server->lock);
+  http_snapshot_release(server, previous);
+  return true;
+}
+
+static HttpSnapshot *http_snapshot_acquire(HttpServer *server) {
+  platform_mutex_lock(&server->lock);
+  HttpSnapshot *snapshot = server->current;
+  if (snapshot) {
+    snapshot->refs++;
+  }
+  platform_mutex_unlock(&server->lock);
+  return snapshot;
+}
+
+// Decode %XX escapes of a path segment in place
+static void http_url_decode(char *text) {
+  char *out = text;
+  for (const char *in = text; *in; in++) {
+    unsigned int value;
+    if (*in == '%' && isxdigit((unsigned char) in[1])
+        && isxdigit((unsigned char) in[2]) && sscanf(in + 1, "%2x", &value)) {
+      *out++ = (char) value;
+      in += 2;
+    } else {
+      *out++ = *in;
+    }
+  }
+  *out = '\0';
+}
+
+// Value of a request header, or NULL. Names compare case-insensitively; the
+// value runs to the end of its line.
+static const char *http_header(const char *headers, const char *name,
+                               size_t *length) {
+  size_t name_length = strlen(name);
+  for (const char *line = strstr(headers, "\r\n"); line;
+       line = strstr(line, "\r\n")) {
+    line += 2;
+    bool match = true;
+    for (size_t i = 0; i < name_length && match; i++) {
+      char c = line[i];
+      match = (c >= 'A' && c <= 'Z' ? c + 32 : c) == name[i];
+    }
+    if (!match || line[name_length] != ':') {
+      continue;
+    }
+    const char *value = line + name_length + 1;
+    while (*value == ' ' || *value == '\t') {
+      value++;
+    }
+    const char *end = strstr(value, "\r\n");
+    *length = end ? (size_t) (end - value) : strlen(value);
+    return value;
+  }
+  return NULL;
+}
+
+// Whether an If-None-Match list names etag
+static bool http_etag_matches(const char *list, size_t length,
+                              const char *etag) {
+  size_t etag_length = strlen(etag);
+  for (size_t i = 0; i < length; i++) {
+    if (list[i] == '*') {
+      return true;
+    }
+    if (i + etag_length <= length
+        && memcmp(list + i, etag, etag_length) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Queue a response. Documents carry their ETag, errors may carry one extra
+// header line in extra.
+static void http_client_respond(HttpClient *client, const char *status,
+                                const char *type, const char *etag,
+                                const char *extra, const char *body,
+                                size_t body_length, bool head) {
+  char etag_line[32] = "";
+  if (etag) {
+    snprintf(etag_line, sizeof(etag_line), "ETag: %s\r\n", etag);
+  }
+  int length = snprintf(
+      client->header, sizeof(client->header),
+      "HTTP/1.1 %s\r\n"
+      "Content-Type: %s\r\n"
+      "Content-Length: %lu\r\n"
+      "%s%s"
+      "Cache-Control: no-cache\r\n"
+      "Connection: %s\r\n\r\n",
+      status, type, (unsigned long) body_length, etag_line, extra ? extra : "",
+      client->close_after ? "close" : "keep-alive");
+  client->header_length = (size_t) length;
+  client->body = body;
+  client->body_length = head ? 0 : body_length;
+  client->sent = 0;
+  client->sending = true;
+}
+
+static void http_client_error(HttpClient *client, const char *status,
+                              const char *extra, bool head) {
+  http_client_respond(client, status, HTTP_TEXT, NULL, extra, status,
+                      strlen(status), head);
+}
+
+// Answer one complete request at the start of client->request
+static void http_client_handle(HttpServer *server, HttpClient *client,
+                               size_t request_end) {
+  char method[8];
+  char target[256];
+  int major = 0;
+  int minor = 0;
+  client->request[request_end - 2] = '\0'; // Cut at the blank line
+  if (sscanf(client->request, "%7s %255s HTTP/%d.%d", method, target, &major,
+             &minor)
+      != 4) {
+    client->close_after = true;
+    http_client_error(client, "400 Bad Request", NULL, false);
+    return;
+  }
+
+  size_t length;
+  const char *connection = http_header(client->request, "connection", &length);
+  if (major == 1 && minor == 0) {
+    client->close_after =
+        !connection || length != 10 || strncmp(connection, "keep-alive", 10);
+  } else {
+    client->close_after =
+        connection && length == 5 && strncmp(connection, "close", 5) == 0;
+  }
+
+  bool head = strcmp(method, "HEAD") == 0;
+  if (!head && strcmp(method, "GET") != 0) {
+    http_client_error(client, "405 Method Not Allowed",
+                      "Allow: GET, HEAD\r\n", false);
+    return;
+  }
+
+  HttpSnapshot *snapshot = http_snapshot_acquire(server);
+  if (!snapshot) {
+    // Nothing has been read yet
+    http_client_error(client, "503 Service Unavailable",
+                      "Retry-After: 1\r\n", head);
+    return;
+  }
+
+  const char *type = HTTP_JSON;
+  const char *etag = NULL;
+  const char *body = NULL;
+  size_t body_length = 0;
+  if (strcmp(target, "/metrics") == 0) {
+    type = HTTP_PROMETHEUS;
+    etag = snapshot->metrics.etag;
+    body = snapshot->body.data + snapshot->metrics.offset;
+    body_length = snapshot->metrics.length;
+  } else if (strcmp(target, "/machines") == 0 || strcmp(target, "/") == 0) {
+    etag = snapshot->etag;
+    body = snapshot->body.data;
+    body_length = snapshot->snapshot_length;
+  } else if (strncmp(target, "/machines/", 10) == 0) {
+    char *name = target + 10;
+    http_url_decode(name);
+    for (int i = 0; i < snapshot->entry_count; i++) {
+      const HttpEntry *entry = &snapshot->entries[i];
+      if (strcmp(entry->name, name) == 0) {
+        etag = entry->etag;
+        body = snapshot->body.data + entry->offset;
+        body_length = entry->length;
+        break;
+      }
+    }
+  }
+  if (!etag) {
+    http_snapshot_release(server, snapshot);
+    http_client_error(client, "404 Not Found", NULL, head);
+    return;
+  }
+
+  const char *match = http_header(client->request, "if-none-match", &length);
+  if (match && http_etag_matches(match, length, etag)) {
+    http_client_respond(client, "304 Not Modified", type, etag, NULL, NULL, 0,
+                        true);
+  } else {
+    http_client_respond(client, "200 OK", type, etag, NULL, body, body_length,
+                        head);
+  }
+  client->snapshot = snapshot;
+}
+
+// Send what the socket takes. Returns false once the client should be
+// dropped, after an error or a response that closes the connection.
+static bool http_client_send(HttpServer *server, HttpClient *client) {
+  while (client->sent < client->header_length + client->body_length) {
+    const char *data;
+    size_t remaining;
+    if (client->sent < client->header_length) {
+      data = client->header + client->sent;
+      remaining = client->header_length - client->sent;
+    } else {
+      size_t offset = client->sent - client->header_length;
+      data = client->body + offset;
+      remaining = client->body_length - offset;
+    }
+    long sent = platform_send(client->socket, data, remaining);
+    if (sent < 0 && platform_socket_would_block()) {
+      return true;
+    }
+    if (sent <= 0) {
+      client->sending = false;
+      return false;
+    }
+    client->sent += (size_t) sent;
+  }
+
+  client->sending = false;
+  http_snapshot_release(server, client->snapshot);
+  client->snapshot = NULL;
+  return !client->close_after;
+}
+
+// Consume complete requests, one response at a time. Returns false once the
+// client should be dropped.
+static bool http_client_process(HttpServer *server, HttpClient *client) {
+  while (!client->sending) {
+    client->request[client->request_length] = '\0';
+    char *end = strstr(client->request, "\r\n\r\n");
+    if (!end) {
+      if (client->request_length == HTTP_REQUEST_MAX - 1) {
+        client->close_after = true;
+        http_client_error(client, "431 Request Header Fields Too Large", NULL,
+                          false);
+        client->request_length = 0;
+        return http_client_send(server, client);
+      }
+      return true;
+    }
+
+    // Requests carry no body, so the next one starts after the blank line
+    size_t request_end = (size_t) (end - client->request) + 4;
+    http_client_handle(server, client, request_end);
+    memmove(client->request, client->request + request_end,
+            client->request_length - request_end);
+    client->request_length -= request_end;
+
+    if (!http_client_send(server, client)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Read what arrived. Returns false once the client should be dropped.
+static bool http_client_receive(HttpServer *server, HttpClient *client) {
+  size_t room = HTTP_REQUEST_MAX - 1 - client->request_length;
+  if (room == 0) {
+    return http_client_process(server, client);
+  }
+  long received = platform_recv(
+      client->socket, client->request + client->request_length, room);
+  if (received < 0 && platform_socket_would_block()) {
+    return true;
+  }
+  if (received <= 0) {
+    return false;
+  }
+  client->request_length += (size_t) received;
+  return http_client_process(server, client);
+}
+
+static void http_client_drop(HttpServer *server, int index) {
+  HttpClient *client = &server->clients[index];
+  platform_socket_close(client->socket);
+  http_snapshot_release(server, client->snapshot);
+  server->clients[index] = server->clients[--server->client_count];
+}
+
+static void http_server_accept(HttpServer *server) {
+  while (server->client_count < HTTP_MAX_CLIENTS) {
+    PlatformSocket accepted = accept(server->listener, NULL, NULL);
+    if (accepted == PLATFORM_INVALID_SOCKET) {
+      return;
+    }
+    int enabled = 1;
+    setsockopt(accepted, IPPROTO_TCP, TCP_NODELAY, (const char *) &enabled,
+               sizeof(enabled));
+    if (!platform_socket_set_nonblocking(accepted)) {
+      platform_socket_close(accepted);
+      continue;
+    }
+    HttpClient *client = &server->clients[server->client_count++];
+    memset(client, 0, sizeof(HttpClient));
+    client->socket = accepted;
+    client->active_ms = platform_monotonic_ms();
+  }
+}
+
+static void http_server_thread(void *arg) {
+  HttpServer *server = arg;
+
+  for (;;) {
+    platform_mutex_lock(&server->lock);
+    bool stopping = server->stopping;
+    platform_mutex_unlock(&server->lock);
+    if (stopping) {
+      break;
+    }
+
+    // The listener is only polled while there is room for another client
+    int count = 0;
+    bool listening = server->client_count < HTTP_MAX_CLIENTS;
+    if (listening) {
+      server->poll_fds[count].fd = server->listener;
+      server->poll_fds[count].events = POLLIN;
+      server->poll_fds[count].revents = 0;
+      count++;
+    }
+    for (int i = 0; i < server->client_count; i++) {
+      server->poll_fds[count].fd = server->clients[i].socket;
+      server->poll_fds[count].events =
+          server->clients[i].sending ? POLLOUT : POLLIN;
+      server->poll_fds[count].revents = 0;
+      count++;
+    }
+    // revents stay 0 when the poll times out or fails, which leaves only
+    // the idle check below
+    platform_poll(server->poll_fds, count, HTTP_POLL_MS);
+    double now = platform_monotonic_ms();
+
+    int first = listening ? 1 : 0;
+    // Backwards, since a dropped client is replaced by the last one
+    for (int i = server->client_count - 1; i >= 0; i--) {
+      short revents = server->poll_fds[first + i].revents;
+      HttpClient *client = &server->clients[i];
+      if (revents == 0) {
+        if (now - client->active_ms > HTTP_IDLE_MS) {
+          http_client_drop(server, i);
+        }
+        continue;
+      }
+      client->active_ms = now;
+      bool keep = client->sending ? http_client_send(server, client)
+                                        && http_client_process(server, client)
+                                  : http_client_receive(server, client);
+      if (!keep || (revents & (POLLERR | POLLNVAL))) {
+        http_client_drop(server, i);
+      }
+    }
+    if (listening && server->poll_fds[0].revents != 0) {
+      http_server_accept(server);
+    }
+  }
+
+  while (server->client_count > 0) {
+    http_client_drop(server, server->client_count - 1);
+  }
+}
+
+// Listen on address:port and serve from a thread. Returns NULL if the socket
+// cannot be set up.
+HttpServer *http_server_start(const char *address, int port) {
+  if (!platform_socket_startup()) {
+    fprintf(stderr, "Error: Cannot initialize sockets\n");
+    return NULL;
+  }
+
+  struct sockaddr_in bind_address;
+  memset(&bind_address, 0, sizeof(bind_address));
+  bind_address.sin_family = AF_INET;
+  bind_address.sin_port = htons((unsigned short) port);
+  if (inet_pton(AF_INET, address, &bind_address.sin_addr) != 1) {
+    fprintf(stderr, "Error: Invalid HTTP address '%s'\n", address);
+    return NULL;
+  }
+
+  HttpServer *server = calloc(1, sizeof(HttpServer));
+  if (!server) {
+    return NULL;
+  }
+  server->clients = malloc(HTTP_MAX_CLIENTS * sizeof(HttpClient));
+  server->poll_fds = malloc((HTTP_MAX_CLIENTS + 1) * sizeof(PlatformPollFd));
+  server->listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (!server->clients || !server->poll_fds
+      || server->listener == PLATFORM_INVALID_SOCKET) {
+    fprintf(stderr, "Error: Cannot create HTTP socket\n");
+    goto fail;
+  }
+
+  int enabled = 1;
+  setsockopt(server->listener, SOL_SOCKET, SO_REUSEADDR,
+             (const char *) &enabled, sizeof(enabled));
+  if (bind(server->listener, (struct sockaddr *) &bind_address,
+           sizeof(bind_address))
+          != 0
+      || listen(server->listener, 64) != 0
+      || !platform_socket_set_nonblocking(server->listener)) {
+    fprintf(stderr, "Error: Cannot listen for HTTP on %s:%d\n", address, port);
+    goto fail;
+  }
+
+  platform_mutex_init(&server->lock);
+  if (!platform_thread_create(&server->thread, http_server_thread, server)) {
+    fprintf(stderr, "Error: Cannot start the HTTP server thread\n");
+    platform_mutex_destroy(&server->lock);
+    goto fail;
+  }
+  return server;
+
+fail:
+  if (server->listener != PLATFORM_INVALID_SOCKET) {
+    platform_socket_close(server->listener);
+  }
+  free(server->clients);
+  free(server->poll_fds);
+  free(server);
+  return NULL;
+}
+
+void http_server_stop(HttpServer *server) {
+  if (!server) {
+    return;
+  }
+
+  platform_mutex_lock(&server->lock);
+  server->stopping = true;
+  platform_mutex_unlock(&server->lock);
+  platform_thread_join(server->thread);
+
+  platform_socket_close(server->listener);
+  http_snapshot_release(server, server->current);
+  platform_mutex_destroy(&server->lock);
+  free(server->clients);
+  free(server->poll_fds);
+  free(server);
+}
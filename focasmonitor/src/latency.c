@@ -0,0 +1,148 @@
+#include "focasmonitor.h"
+
+#include <string.h>
+
+#include "fwlib32.h"
+
+// Latency instrumentation for FOCAS calls. Every machine keeps one histogram
+// per function with log-linear buckets, so memory is fixed no matter how long
+// the monitor runs and percentiles stay within a bucket width (25%) of the
+// true value. Calls are timed into a LatencyLog owned by the reading thread
+// and merged into the histograms under the pool lock when the read publishes.
+
+static const char *function_names[FOCAS_FN_COUNT] = {
+    "cnc_allclibhndl3", "cnc_freelibhndl", "cnc_rdcncid",    "cnc_sysinfo",
+    "cnc_rdaxisname",   "cnc_getfigure",   "cnc_rdspdlname", "cnc_rddynamic2",
+    "cnc_rdprgnum",     "cnc_statinfo",    "cnc_rdseqnum",   "cnc_rdposition",
+    "cnc_rdspeed",      "cnc_alarm"};
+
+// Upper bound of the last bucket in microseconds
+#define LATENCY_MAX_US                                                         \
+  ((double) (2 * LATENCY_SUB_BUCKETS) * (double) (1ul << (LATENCY_OCTAVES - 1)))
+
+const char *focas_function_name(FocasFunction function) {
+  if (function < 0 || function >= FOCAS_FN_COUNT) {
+    return "unknown";
+  }
+  return function_names[function];
+}
+
+// Values below LATENCY_SUB_BUCKETS microseconds get a bucket each; above that
+// every power of two is split into LATENCY_SUB_BUCKETS equal buckets
+static int latency_bucket(double ms) {
+  double us = ms * 1000.0;
+  if (us < LATENCY_SUB_BUCKETS) {
+    return us > 0 ? (int) us : 0;
+  }
+  if (us >= LATENCY_MAX_US) {
+    return LATENCY_BUCKETS - 1;
+  }
+
+  unsigned long value = (unsigned long) us;
+  int octave = 0;
+  while ((value >> octave) >= 2 * LATENCY_SUB_BUCKETS) {
+    octave++;
+  }
+  return (octave + 1) * LATENCY_SUB_BUCKETS
+         + (int) ((value >> octave) - LATENCY_SUB_BUCKETS);
+}
+
+// Exclusive upper bound of a bucket in milliseconds
+static double latency_bucket_limit(int bucket) {
+  if (bucket < LATENCY_SUB_BUCKETS) {
+    return (bucket + 1) / 1000.0;
+  }
+  int octave = bucket / LATENCY_SUB_BUCKETS - 1;
+  int step = LATENCY_SUB_BUCKETS + bucket % LATENCY_SUB_BUCKETS + 1;
+  return (double) step * (double) (1ul << octave) / 1000.0;
+}
+
+// Record a FOCAS call that started at started_ms (platform_monotonic_ms).
+// A NULL log records nothing; a full log drops the call.
+void latency_log_add(LatencyLog *log, FocasFunction function, double started_ms,
+                     short result) {
+  if (!log || log->count >= LATENCY_LOG_SIZE) {
+    return;
+  }
+
+  LatencySample *sample = &log->calls[log->count++];
+  sample->function = function;
+  sample->result = result;
+  sample->ms = platform_monotonic_ms() - started_ms;
+}
+
+// Record one call that took ms milliseconds
+void latency_histogram_add(LatencyHistogram *histogram, double ms,
+                           bool failed) {
+  histogram->buckets[latency_bucket(ms)]++;
+  histogram->count++;
+  histogram->total_ms += ms;
+  if (failed) {
+    histogram->errors++;
+  }
+  if (ms > histogram->max_ms) {
+    histogram->max_ms = ms;
+  }
+}
+
+// Add every call recorded in from to into
+void latency_histogram_merge(LatencyHistogram *into,
+                             const LatencyHistogram *from) {
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    into->buckets[i] += from->buckets[i];
+  }
+  into->count += from->count;
+  into->errors += from->errors;
+  into->total_ms += from->total_ms;
+  if (from->max_ms > into->max_ms) {
+    into->max_ms = from->max_ms;
+  }
+}
+
+// Move the logged calls into a machine's histograms (caller holds the pool
+// lock) and empty the log
+void latency_log_merge(LatencyLog *log, LatencyHistogram *histograms) {
+  for (int i = 0; i < log->count; i++) {
+    const LatencySample *sample = &log->calls[i];
+    latency_histogram_add(&histograms[sample->function], sample->ms,
+                          sample->result != EW_OK);
+  }
+  log->count = 0;
+}
+
+// Smallest bucket limit at or below which the given share of calls finished,
+// clamped to the slowest call seen
+static double latency_percentile(const LatencyHistogram *histogram,
+                                 double share) {
+  // Nearest rank: the smallest count covering the share
+  unsigned int rank = (unsigned int) (share * histogram->count);
+  if (rank < share * histogram->count || rank < 1) {
+    rank++;
+  }
+
+  unsigned int seen = 0;
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    seen += histogram->buckets[i];
+    if (seen >= rank) {
+      double limit = latency_bucket_limit(i);
+      return limit < histogram->max_ms ? limit : histogram->max_ms;
+    }
+  }
+  return histogram->max_ms;
+}
+
+void latency_histogram_summarize(const LatencyHistogram *histogram,
+                                 LatencySummary *summary) {
+  memset(summary, 0, sizeof(LatencySummary));
+  summary->count = histogram->count;
+  summary->errors = histogram->errors;
+  summary->total_ms = histogram->total_ms;
+  if (histogram->count == 0) {
+    return;
+  }
+
+  summary->p50_ms = latency_percentile(histogram, 0.50);
+  summary->p90_ms = latency_percentile(histogram, 0.90);
+  summary->p99_ms = latency_percentile(histogram, 0.99);
+  summary->max_ms = histogram->max_ms;
+}
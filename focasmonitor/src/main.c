@@ -3,12 +3,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#ifdef _WIN32
-#include <windows.h>
-#define sleep(x) Sleep((x) * 1000)
-#else
-#include <unistd.h>
-#endif
 
 #include "focasmonitor.h"
 #include "fwlib32.h"
@@ -40,16 +34,110 @@ void show_usage(const char *program_name) {
   printf("                              position - Tool position data\n");
   printf("                              speed    - Speed and feed rate data\n");
   printf("                              alarm    - Alarm status\n");
+  printf("  --fields=<list>             FOCAS reads to perform, overriding "
+         "those implied\n");
+  printf("                              by --info: id, program, status, "
+         "sequence,\n");
+  printf("                              position, speed, alarm, all\n");
+  printf("  --acquisition=<mode>        How dynamic data is read: auto "
+         "(default),\n");
+  printf("                              dynamic (one cnc_rddynamic2 call), "
+         "individual\n");
   printf("  --monitor                   Continuous monitoring mode\n");
   printf("  --interval=<seconds>        Monitoring interval (default: 30 "
          "seconds)\n");
-  printf("  --output=<format>           Output format: console, json, csv\n");
+  printf("  --active-interval=<ms>      Poll RUNNING or alarmed machines this "
+         "often\n");
+  printf("                              (default: --interval, at least %d)\n",
+         MIN_ACTIVE_INTERVAL_MS);
+  printf("  --offline-interval=<seconds> Poll unreachable machines this often "
+         "(default:\n");
+  printf("                              --interval)\n");
+  printf("  --output=<format>           Output format: console, json, csv, "
+         "ndjson\n");
+  printf("  --sort=<order>              Order of the --monitor console view: "
+         "pool\n");
+  printf("                              (default), name, status (alarms "
+         "first)\n");
+  printf("  --filter=<statuses>         Show only machines in these states in "
+         "the console\n");
+  printf("                              view: alarm, offline, paused, "
+         "running, stopped,\n");
+  printf("                              unknown (comma-separated)\n");
+  printf("  --delta                     With --monitor, write only the "
+         "machines and\n");
+  printf("                              fields that changed since they were "
+         "last written\n");
+  printf("  --keyframe=<cycles>         Write every machine in full this often "
+         "with\n");
+  printf("                              --delta (default: %d, 0 = first cycle "
+         "only)\n",
+         DEFAULT_KEYFRAME_INTERVAL);
+  printf("  --ndjson-file=<path>        Append --output=ndjson lines to this "
+         "file instead\n");
+  printf("                              of stdout\n");
+  printf("  --rotate-size=<MB>          Rotate the NDJSON file at this size "
+         "(default: never)\n");
+  printf("  --rotate-interval=<seconds> Rotate the NDJSON file this often "
+         "(default: never)\n");
+  printf("  --fsync-interval=<ms>       Flush the NDJSON file to disk at most "
+         "this often\n");
+  printf("                              (default: %d, 0 = every write)\n",
+         DEFAULT_FSYNC_INTERVAL_MS);
+  printf("  --history=<dir>             Record every sample in a per-machine "
+         "history file\n");
+  printf("                              in this directory\n");
+  printf("  --history-query=<machine>   Print a machine's recorded history "
+         "from --history\n");
+  printf("                              as CSV (JSON lines with "
+         "--output=json) and exit\n");
+  printf("  --from=<time> --to=<time>   Range for --history-query: Unix "
+         "seconds or local\n");
+  printf("                              YYYY-MM-DD[THH:MM[:SS]] (default: "
+         "everything)\n");
+  printf("  --http=[<address>:]<port>   With --monitor, serve the latest "
+         "snapshot as JSON\n");
+  printf("                              over HTTP, with Prometheus metrics at "
+         "/metrics\n");
+  printf("                              (address default: 127.0.0.1)\n");
+  printf("  --mqtt=<host>[:<port>]      With --monitor, publish every sample "
+         "retained to\n");
+  printf("                              <prefix>/<machine>/state on this "
+         "broker\n");
+  printf("  --mqtt-prefix=<prefix>      MQTT topic prefix (default: %s)\n",
+         DEFAULT_MQTT_PREFIX);
+  printf("  --mqtt-client-id=<id>       MQTT client identifier (default: "
+         "focasmonitor)\n");
   printf("  --verbose                   Enable verbose logging\n");
   printf("  --diagnose                  Run network diagnostics on connection "
          "failures\n");
-  printf("  --status                    Show connection pool status\n");
+  printf("  --no-probe                  Connect without checking each "
+         "machine's port\n");
+  printf("                              first\n");
+  printf("  --status                    Show connection pool status and FOCAS "
+         "call latency\n");
+  printf("                              after reading\n");
   printf("  --timeout=<seconds>         Connection timeout (default: 10 "
          "seconds)\n");
+  printf("  --startup-budget=<seconds>  Start monitoring after this long even "
+         "if some\n");
+  printf("                              machines are still connecting "
+         "(default: %d,\n",
+         DEFAULT_STARTUP_BUDGET);
+  printf("                              0 = wait for every machine)\n");
+  printf("  --deadline=<ms>             Publish each cycle after this long, "
+         "marking\n");
+  printf("                              machines that have not answered as "
+         "late\n");
+  printf("  --threads=<count>           Worker threads for parallel reads "
+         "(default: one\n");
+  printf("                              per machine, max %d; 1 = "
+         "sequential)\n",
+         MAX_WORKER_THREADS);
+  printf("                              Machines beyond that share workers "
+         "and wait\n");
+  printf("                              on a stalled read pinned to the same "
+         "worker\n");
   printf("  --help                      Show this help message\n");
   printf("  --version                   Show version information\n\n");
   printf("Examples:\n");
@@ -61,6 +149,8 @@ void show_usage(const char *program_name) {
          program_name);
   printf("  %s --machines=machines.txt --info=alarm --output=json\n",
          program_name);
+  printf("  %s --machines=machines.txt --fields=status,alarm --output=csv\n",
+         program_name);
 }
 
 void show_version(void) {
@@ -82,10 +172,22 @@ int read_config(int argc, char *argv[], Config *conf) {
   memset(conf, 0, sizeof(Config));
   strcpy(conf->info_type, "all");
   strcpy(conf->output_format, "console");
+  strcpy(conf->acquisition, "auto");
   conf->monitor_interval = DEFAULT_MONITOR_INTERVAL;
+  conf->active_interval_ms = DEFAULT_ACTIVE_INTERVAL_MS;
+  conf->offline_interval = DEFAULT_OFFLINE_INTERVAL;
   conf->timeout = CONNECTION_TIMEOUT;
+  conf->startup_budget = DEFAULT_STARTUP_BUDGET;
+  conf->worker_threads = DEFAULT_WORKER_THREADS;
+  conf->cycle_deadline_ms = DEFAULT_CYCLE_DEADLINE_MS;
+  conf->keyframe_interval = DEFAULT_KEYFRAME_INTERVAL;
+  conf->fsync_interval_ms = DEFAULT_FSYNC_INTERVAL_MS;
+  conf->mqtt_port = DEFAULT_MQTT_PORT;
+  strcpy(conf->mqtt_prefix, DEFAULT_MQTT_PREFIX);
+  strcpy(conf->mqtt_client_id, "focasmonitor");
   conf->verbose = false;
   conf->diagnose = false;
+  conf->probe = true;
   conf->monitor_mode = false;
   conf->show_status = false;
 
@@ -95,6 +197,10 @@ int read_config(int argc, char *argv[], Config *conf) {
       strncpy(conf->config_file, argv[i] + 11, sizeof(conf->config_file) - 1);
     } else if (strncmp(argv[i], "--info=", 7) == 0) {
       strncpy(conf->info_type, argv[i] + 7, sizeof(conf->info_type) - 1);
+    } else if (strncmp(argv[i], "--fields=", 9) == 0) {
+      strncpy(conf->fields, argv[i] + 9, sizeof(conf->fields) - 1);
+    } else if (strncmp(argv[i], "--acquisition=", 14) == 0) {
+      strncpy(conf->acquisition, argv[i] + 14, sizeof(conf->acquisition) - 1);
     } else if (strncmp(argv[i], "--output=", 9) == 0) {
       strncpy(conf->output_format, argv[i] + 9,
               sizeof(conf->output_format) - 1);
@@ -102,16 +208,108 @@ int read_config(int argc, char *argv[], Config *conf) {
       conf->monitor_interval = atoi(argv[i] + 11);
       if (conf->monitor_interval < 1)
         conf->monitor_interval = DEFAULT_MONITOR_INTERVAL;
+    } else if (strncmp(argv[i], "--active-interval=", 18) == 0) {
+      conf->active_interval_ms = atoi(argv[i] + 18);
+      if (conf->active_interval_ms < 0)
+        conf->active_interval_ms = DEFAULT_ACTIVE_INTERVAL_MS;
+    } else if (strncmp(argv[i], "--offline-interval=", 19) == 0) {
+      conf->offline_interval = atoi(argv[i] + 19);
+      if (conf->offline_interval < 0)
+        conf->offline_interval = DEFAULT_OFFLINE_INTERVAL;
+    } else if (strncmp(argv[i], "--startup-budget=", 17) == 0) {
+      conf->startup_budget = atoi(argv[i] + 17);
+      if (conf->startup_budget < 0)
+        conf->startup_budget = DEFAULT_STARTUP_BUDGET;
     } else if (strncmp(argv[i], "--timeout=", 10) == 0) {
       conf->timeout = atoi(argv[i] + 10);
       if (conf->timeout < 1)
         conf->timeout = CONNECTION_TIMEOUT;
+    } else if (strncmp(argv[i], "--deadline=", 11) == 0) {
+      conf->cycle_deadline_ms = atoi(argv[i] + 11);
+      if (conf->cycle_deadline_ms < 0)
+        conf->cycle_deadline_ms = DEFAULT_CYCLE_DEADLINE_MS;
+    } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+      conf->worker_threads = atoi(argv[i] + 10);
+      if (conf->worker_threads < 0)
+        conf->worker_threads = DEFAULT_WORKER_THREADS;
+    } else if (strncmp(argv[i], "--keyframe=", 11) == 0) {
+      conf->keyframe_interval = atoi(argv[i] + 11);
+      if (conf->keyframe_interval < 0)
+        conf->keyframe_interval = DEFAULT_KEYFRAME_INTERVAL;
+    } else if (strncmp(argv[i], "--ndjson-file=", 14) == 0) {
+      strncpy(conf->ndjson_file, argv[i] + 14, sizeof(conf->ndjson_file) - 1);
+    } else if (strncmp(argv[i], "--rotate-size=", 14) == 0) {
+      conf->rotate_size_mb = atoi(argv[i] + 14);
+      if (conf->rotate_size_mb < 0)
+        conf->rotate_size_mb = 0;
+    } else if (strncmp(argv[i], "--rotate-interval=", 18) == 0) {
+      conf->rotate_interval = atoi(argv[i] + 18);
+      if (conf->rotate_interval < 0)
+        conf->rotate_interval = 0;
+    } else if (strncmp(argv[i], "--fsync-interval=", 17) == 0) {
+      conf->fsync_interval_ms = atoi(argv[i] + 17);
+      if (conf->fsync_interval_ms < 0)
+        conf->fsync_interval_ms = DEFAULT_FSYNC_INTERVAL_MS;
+    } else if (strncmp(argv[i], "--history=", 10) == 0) {
+      strncpy(conf->history_dir, argv[i] + 10, sizeof(conf->history_dir) - 1);
+    } else if (strncmp(argv[i], "--history-query=", 16) == 0) {
+      strncpy(conf->history_query, argv[i] + 16,
+              sizeof(conf->history_query) - 1);
+    } else if (strncmp(argv[i], "--from=", 7) == 0) {
+      strncpy(conf->history_from, argv[i] + 7,
+              sizeof(conf->history_from) - 1);
+    } else if (strncmp(argv[i], "--to=", 5) == 0) {
+      strncpy(conf->history_to, argv[i] + 5, sizeof(conf->history_to) - 1);
+    } else if (strncmp(argv[i], "--http=", 7) == 0) {
+      // [address:]port, local only unless an address is given
+      const char *value = argv[i] + 7;
+      const char *colon = strrchr(value, ':');
+      size_t length = colon ? (size_t) (colon - value) : 0;
+      if (length >= sizeof(conf->http_address)) {
+        length = sizeof(conf->http_address) - 1;
+      }
+      memcpy(conf->http_address, value, length);
+      conf->http_address[length] = '\0';
+      if (length == 0) {
+        strcpy(conf->http_address, "127.0.0.1");
+      }
+      conf->http_port = atoi(colon ? colon + 1 : value);
+      if (conf->http_port < 0 || conf->http_port > 65535)
+        conf->http_port = 0;
+      // Serving only makes sense while the snapshot keeps updating
+      if (conf->http_port > 0)
+        conf->monitor_mode = true;
+    } else if (strncmp(argv[i], "--mqtt=", 7) == 0) {
+      // host[:port]
+      strncpy(conf->mqtt_host, argv[i] + 7, sizeof(conf->mqtt_host) - 1);
+      char *colon = strrchr(conf->mqtt_host, ':');
+      if (colon) {
+        *colon = '\0';
+        conf->mqtt_port = atoi(colon + 1);
+        if (conf->mqtt_port < 1 || conf->mqtt_port > 65535)
+          conf->mqtt_port = DEFAULT_MQTT_PORT;
+      }
+      if (strlen(conf->mqtt_host) > 0)
+        conf->monitor_mode = true;
+    } else if (strncmp(argv[i], "--sort=", 7) == 0) {
+      strncpy(conf->sort, argv[i] + 7, sizeof(conf->sort) - 1);
+    } else if (strncmp(argv[i], "--filter=", 9) == 0) {
+      strncpy(conf->filter, argv[i] + 9, sizeof(conf->filter) - 1);
+    } else if (strncmp(argv[i], "--mqtt-prefix=", 14) == 0) {
+      strncpy(conf->mqtt_prefix, argv[i] + 14, sizeof(conf->mqtt_prefix) - 1);
+    } else if (strncmp(argv[i], "--mqtt-client-id=", 17) == 0) {
+      strncpy(conf->mqtt_client_id, argv[i] + 17,
+              sizeof(conf->mqtt_client_id) - 1);
+    } else if (strcmp(argv[i], "--delta") == 0) {
+      conf->delta = true;
     } else if (strcmp(argv[i], "--monitor") == 0) {
       conf->monitor_mode = true;
     } else if (strcmp(argv[i], "--verbose") == 0) {
       conf->verbose = true;
     } else if (strcmp(argv[i], "--diagnose") == 0) {
       conf->diagnose = true;
+    } else if (strcmp(argv[i], "--no-probe") == 0) {
+      conf->probe = false;
     } else if (strcmp(argv[i], "--status") == 0) {
       conf->show_status = true;
     } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
@@ -219,35 +417,150 @@ int process_add_arguments(int argc, char *argv[], ConnectionPool *pool) {
 
 int monitor_machines(ConnectionPool *pool, Config *conf) {
   MultiMachineInfo multi_info;
+  Scheduler scheduler;
+  DeltaTracker delta;
+  NdjsonWriter ndjson;
+  HistoryStore history;
+  HttpServer *http = NULL;
+  MqttSink mqtt;
+  bool mqtt_enabled = strlen(conf->mqtt_host) > 0;
+  TerminalRenderer terminal;
   OutputFormat format = parse_output_format(conf->output_format);
 
+  // The console view is redrawn in place on a terminal
+  terminal_renderer_init(&terminal, conf->sort, conf->filter);
+  bool redraw = format == OUTPUT_CONSOLE && !conf->delta && terminal.ansi;
+
+  // Connect and read diagnostics would scroll the view that is redrawn in
+  // place, which shows each machine's state itself
+  platform_mutex_lock(&pool->lock);
+  pool->quiet = redraw;
+  platform_mutex_unlock(&pool->lock);
+
+  if (conf->http_port > 0) {
+    http = http_server_start(conf->http_address, conf->http_port);
+    if (!http) {
+      return FOCAS_INVALID_CONFIG;
+    }
+  }
+  if (format == OUTPUT_NDJSON && !ndjson_writer_open(&ndjson, conf)) {
+    http_server_stop(http);
+    return FOCAS_INVALID_CONFIG;
+  }
+  if (mqtt_enabled && !mqtt_sink_open(&mqtt, conf)) {
+    if (format == OUTPUT_NDJSON) {
+      ndjson_writer_close(&ndjson);
+    }
+    http_server_stop(http);
+    return FOCAS_INVALID_CONFIG;
+  }
+
+  // The snapshot is kept across cycles and only updated for machines whose
+  // state changed
+  multi_machine_info_init(&multi_info);
+
+  // Each machine is polled on its own schedule, fast while it is cutting or in
+  // alarm and slower while idle or unreachable
+  int idle_ms = conf->monitor_interval * 1000;
+  int active_ms = conf->active_interval_ms > 0 ? conf->active_interval_ms
+                                               : idle_ms;
+  int offline_ms = conf->offline_interval > 0 ? conf->offline_interval * 1000
+                                              : idle_ms;
+  scheduler_init(&scheduler, active_ms, idle_ms, offline_ms);
+  delta_tracker_init(&delta, conf->keyframe_interval);
+  history_store_init(&history, conf->history_dir);
+
   while (g_running) {
-    // Read all machine information
-    FocasResult result = connection_pool_read_all_info(pool, &multi_info);
-
-    if (result == FOCAS_OK || multi_info.successful_reads > 0) {
-      // Clear screen for console output (Windows)
-      if (format == OUTPUT_CONSOLE) {
-        system("cls");
-        printf("FOCAS Monitor - %s\n", ctime(&multi_info.collection_time));
-        printf("Machines: %d successful, %d failed\n\n",
-               multi_info.successful_reads, multi_info.failed_reads);
+    double now = platform_monotonic_ms();
+    if (!scheduler_sync(&scheduler, pool, now)) {
+      fprintf(stderr, "Error: Out of memory scheduling machines\n");
+      break;
+    }
+
+    // Read the machines that are due
+    const int *due_ids;
+    int due_count = scheduler_take_due(&scheduler, now, &due_ids);
+    if (due_count > 0) {
+      FocasResult result =
+          connection_pool_read_machines(pool, due_ids, due_count, &multi_info);
+      scheduler_complete(&scheduler, pool, platform_monotonic_ms());
+      // Percentiles are only worked out for the outputs that carry them
+      if (http || (format == OUTPUT_JSON && !conf->delta)) {
+        connection_pool_summarize_latency(pool, &multi_info);
+      }
+      if (strlen(conf->history_dir) > 0) {
+        history_store_append(&history, pool, &multi_info);
+      }
+      if (http && !http_server_publish(http, pool, &multi_info)) {
+        fprintf(stderr, "Warning: Out of memory publishing the HTTP "
+                        "snapshot\n");
       }
 
-      print_multi_machine_info(&multi_info, conf->info_type, format);
-    } else {
-      if (conf->verbose) {
-        printf("Failed to read machine information: %s\n",
-               focas_result_to_string(result));
+      if (format == OUTPUT_NDJSON) {
+        // One line per new sample; failed reads have no sample to write
+        ndjson_writer_write(&ndjson, pool, &multi_info);
+      } else if (conf->delta
+                 && (result == FOCAS_OK || multi_info.successful_reads > 0)) {
+        // Changes are appended rather than redrawn
+        if (print_multi_machine_delta(&delta, &multi_info, conf->info_type,
+                                      format)
+            < 0) {
+          fprintf(stderr, "Error: Out of memory tracking changes\n");
+          break;
+        }
+        fflush(stdout);
+      } else if (redraw) {
+        // Unreachable machines are shown too, so draw even if all failed
+        if (terminal_renderer_draw(&terminal, pool, &multi_info) < 0) {
+          fprintf(stderr, "Error: Out of memory drawing the console view\n");
+          break;
+        }
+      } else if (result == FOCAS_OK || multi_info.successful_reads > 0) {
+        // JSON, CSV, or the console table when stdout is not a terminal
+        if (format == OUTPUT_CONSOLE) {
+          printf("FOCAS Monitor - %s\n", ctime(&multi_info.collection_time));
+          printf("Machines: %d successful, %d failed, %d late\n\n",
+                 multi_info.successful_reads, multi_info.failed_reads,
+                 multi_info.late_reads);
+        }
+
+        print_multi_machine_info(&multi_info, conf->info_type, format);
+        fflush(stdout);
+      } else {
+        if (conf->verbose) {
+          printf("Failed to read machine information: %s\n",
+                 focas_result_to_string(result));
+        }
       }
     }
 
-    // Wait for next cycle
-    for (int i = 0; i < conf->monitor_interval && g_running; i++) {
-      sleep(1);
+    // Samples the broker could not take yet go out as soon as it can
+    if (mqtt_enabled) {
+      mqtt_sink_poll(&mqtt);
+      mqtt_sink_publish(&mqtt, pool, &multi_info);
+    }
+
+    // Wait for the next machine to fall due, in short steps so a shutdown
+    // request is noticed promptly
+    double wait = scheduler_next_due(&scheduler, now)
+                  - platform_monotonic_ms();
+    if (wait > 0 && g_running) {
+      platform_sleep_ms(wait < 200 ? (long) wait + 1 : 200);
     }
   }
 
+  if (format == OUTPUT_NDJSON) {
+    ndjson_writer_close(&ndjson);
+  }
+  if (mqtt_enabled) {
+    mqtt_sink_close(&mqtt);
+  }
+  http_server_stop(http);
+  terminal_renderer_free(&terminal);
+  history_store_free(&history);
+  delta_tracker_free(&delta);
+  scheduler_free(&scheduler);
+  multi_machine_info_free(&multi_info);
   return 0;
 }
 
@@ -270,19 +583,126 @@ int main(int argc, char *argv[]) {
     return EXIT_SUCCESS;
   }
 
+  // Compile the acquisition plan so each cycle only issues the FOCAS reads the
+  // selected view needs
+  AcquisitionPlan plan = acquisition_plan_for_info(conf.info_type);
+  if (strlen(conf.fields) > 0 && !acquisition_plan_parse(conf.fields, &plan)) {
+    fprintf(stderr, "Error: Invalid field list '%s'\n\n", conf.fields);
+    show_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  AcquisitionMode mode;
+  if (!acquisition_mode_parse(conf.acquisition, &mode)) {
+    fprintf(stderr, "Error: Invalid acquisition mode '%s'\n\n",
+            conf.acquisition);
+    show_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  // Machines are only told apart as active by their status, so without it
+  // every one would be polled at the idle interval
+  if (conf.monitor_mode && conf.active_interval_ms > 0) {
+    if (conf.active_interval_ms < MIN_ACTIVE_INTERVAL_MS) {
+      fprintf(stderr, "Error: --active-interval must be at least %d ms\n\n",
+              MIN_ACTIVE_INTERVAL_MS);
+      show_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    if (!(plan & ACQ_STATUS)) {
+      fprintf(stderr, "Warning: --active-interval needs the machine status, "
+                      "adding it to the reads\n");
+      plan |= ACQ_STATUS;
+    }
+  }
+  plan = acquisition_plan_apply_mode(plan, mode);
+
+  // Checked here so a typo is reported before any machine is connected
+  int sort;
+  unsigned filter;
+  if (!terminal_sort_parse(conf.sort, &sort)) {
+    fprintf(stderr, "Error: Invalid sort order '%s'\n\n", conf.sort);
+    show_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (!terminal_filter_parse(conf.filter, &filter)) {
+    fprintf(stderr, "Error: Invalid status filter '%s'\n\n", conf.filter);
+    show_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // Reading recorded history needs no connection to the machines
+  if (strlen(conf.history_query) > 0) {
+    int64_t from_ms = INT64_MIN;
+    int64_t to_ms = INT64_MAX;
+    if (strlen(conf.history_dir) == 0) {
+      fprintf(stderr, "Error: --history-query needs --history=<dir>\n");
+      return EXIT_FAILURE;
+    }
+    if ((strlen(conf.history_from) > 0
+         && !history_parse_time(conf.history_from, &from_ms))
+        || (strlen(conf.history_to) > 0
+            && !history_parse_time(conf.history_to, &to_ms))) {
+      fprintf(stderr, "Error: Invalid --from or --to time\n");
+      return EXIT_FAILURE;
+    }
+    return history_query(conf.history_dir, conf.history_query, from_ms, to_ms,
+                         parse_output_format(conf.output_format))
+                   >= 0
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+  }
+
   if (conf.verbose) {
+    char plan_fields[128];
+    acquisition_plan_describe(plan, plan_fields, sizeof(plan_fields));
     printf("FOCAS Monitor starting...\n");
     printf("Configuration:\n");
     printf("  Info Type: %s\n", conf.info_type);
+    printf("  Acquisition Plan: %s (%d FOCAS calls per machine%s)\n",
+           plan_fields, acquisition_plan_call_count(plan),
+           (plan & ACQ_USE_DYNAMIC2) ? ", using cnc_rddynamic2" : "");
     printf("  Output Format: %s\n", conf.output_format);
     printf("  Monitor Mode: %s\n", conf.monitor_mode ? "enabled" : "disabled");
     if (conf.monitor_mode) {
       printf("  Monitor Interval: %d seconds\n", conf.monitor_interval);
     }
     printf("  Connection Timeout: %d seconds\n", conf.timeout);
+    printf("  Startup Budget: %d seconds\n", conf.startup_budget);
+    if (conf.worker_threads > 0) {
+      printf("  Worker Threads: %d\n", conf.worker_threads);
+    } else {
+      printf("  Worker Threads: auto\n");
+    }
+    if (conf.cycle_deadline_ms > 0) {
+      printf("  Cycle Deadline: %d ms\n", conf.cycle_deadline_ms);
+    }
+    if (conf.monitor_mode && conf.delta) {
+      printf("  Delta Output: keyframe every %d cycles\n",
+             conf.keyframe_interval);
+    }
+    if (strlen(conf.ndjson_file) > 0) {
+      printf("  NDJSON File: %s\n", conf.ndjson_file);
+    }
+    if (strlen(conf.history_dir) > 0) {
+      printf("  History Directory: %s\n", conf.history_dir);
+    }
+    if (conf.http_port > 0) {
+      printf("  HTTP Server: %s:%d\n", conf.http_address, conf.http_port);
+    }
+    if (strlen(conf.mqtt_host) > 0) {
+      printf("  MQTT Broker: %s:%d (topics %s/<machine>/state)\n",
+             conf.mqtt_host, conf.mqtt_port, conf.mqtt_prefix);
+    }
     printf("\n");
   }
 
+#ifndef _WIN32
+  // The Linux library aborts on the first connect without its log file
+  if (cnc_startupprocess(0, "focas.log") != EW_OK) {
+    fprintf(stderr, "Error: Failed to create the FOCAS log file\n");
+    return EXIT_FAILURE;
+  }
+#endif
+
   // Initialize connection pool
   result = connection_pool_init(&g_pool);
   if (result != FOCAS_OK) {
@@ -290,6 +710,9 @@ int main(int argc, char *argv[]) {
             focas_result_to_string(result));
     return EXIT_FAILURE;
   }
+  g_pool.plan = plan;
+  g_pool.liveness_ms = conf.monitor_interval * 1000; // The idle interval
+  g_pool.probe_ports = conf.probe;
 
   // Load machines from file if specified
   if (strlen(conf.config_file) > 0) {
@@ -316,25 +739,29 @@ int main(int argc, char *argv[]) {
     printf("Total machines configured: %d\n\n", g_pool.machine_count);
   }
 
-  // Show connection pool status if requested
-  if (conf.show_status) {
-    connection_pool_print_status(&g_pool);
-    printf("\n");
-  }
+  // Start the worker pool first, so each machine is connected by the worker
+  // that reads it and machines are connected and read concurrently
+  g_pool.cycle_deadline_ms = conf.cycle_deadline_ms;
+  connection_pool_start_workers(&g_pool, conf.worker_threads);
 
   // Connect to all machines
   printf("Connecting to %d machines...\n", g_pool.machine_count);
-  result = connection_pool_connect_all(&g_pool, conf.diagnose || conf.verbose);
+  result = connection_pool_connect_all(&g_pool, conf.diagnose || conf.verbose,
+                                       conf.startup_budget * 1000);
 
-  // Count successful and failed connections
+  // Count successful and failed connections; machines past the startup budget
+  // are still being connected by their workers
   int connected = 0, failed = 0;
+  platform_mutex_lock(&g_pool.lock);
   for (int i = 0; i < g_pool.machine_count; i++) {
-    if (g_pool.machines[i].state == CONN_CONNECTED) {
+    const MachineHandle *machine = g_pool.machines[i];
+    if (!machine->in_flight && machine->state == CONN_CONNECTED) {
       connected++;
     } else {
       failed++;
     }
   }
+  platform_mutex_unlock(&g_pool.lock);
 
   if (connected > 0 && failed == 0) {
     printf("[OK] All %d machines connected successfully\n", connected);
@@ -361,19 +788,47 @@ int main(int argc, char *argv[]) {
     // Single read
     printf("Reading machine information...\n\n");
 
+    multi_machine_info_init(&multi_info);
     result = connection_pool_read_all_info(&g_pool, &multi_info);
-    if (result == FOCAS_OK) {
-      OutputFormat format = parse_output_format(conf.output_format);
+    if (strlen(conf.history_dir) > 0) {
+      HistoryStore history;
+      history_store_init(&history, conf.history_dir);
+      history_store_append(&history, &g_pool, &multi_info);
+      history_store_free(&history);
+    }
+    OutputFormat format = parse_output_format(conf.output_format);
+    if (result == FOCAS_OK && format == OUTPUT_NDJSON) {
+      NdjsonWriter ndjson;
+      if (ndjson_writer_open(&ndjson, &conf)) {
+        ndjson_writer_write(&ndjson, &g_pool, &multi_info);
+      }
+      ndjson_writer_close(&ndjson);
+    } else if (result == FOCAS_OK) {
+      if (format == OUTPUT_JSON) {
+        connection_pool_summarize_latency(&g_pool, &multi_info);
+      }
       print_multi_machine_info(&multi_info, conf.info_type, format);
     } else {
       fprintf(stderr, "Error reading machine information: %s\n",
               focas_result_to_string(result));
     }
+    multi_machine_info_free(&multi_info);
+  }
+
+  // Show connection pool status if requested, once the workers are stopped so
+  // the counters and latency histograms are final
+  if (conf.show_status) {
+    connection_pool_stop_workers(&g_pool);
+    printf("\n");
+    connection_pool_print_status(&g_pool);
   }
 
   // Cleanup
   connection_pool_disconnect_all(&g_pool);
   connection_pool_cleanup(&g_pool);
+#ifndef _WIN32
+  cnc_exitprocess();
+#endif
 
   if (conf.verbose) {
     printf("\nFOCAS Monitor finished.\n");
@@ -0,0 +1,299 @@
+#include "focasmonitor.h"
+
+#include <stdio.h>
+
+// Prometheus text exposition of the published snapshot and the collector
+// itself. The document is rendered once per cycle into the HTTP snapshot
+// (see http.c), so a scrape only copies bytes no matter how often it comes.
+//
+// Machine gauges come from the published entries and only appear for the
+// groups the acquisition plan reads. Connection state, connect counts and
+// pool counters are read under the pool lock; latencies are the summaries
+// already copied into the entries when they were published.
+
+// Published machine values, each exported while its group is read
+typedef enum {
+  GAUGE_RUN_STATUS,
+  GAUGE_MOTION_STATUS,
+  GAUGE_PROGRAM_NUMBER,
+  GAUGE_FEED_RATE,
+  GAUGE_SPINDLE_SPEED,
+  GAUGE_ALARM,
+  GAUGE_LATE,
+  GAUGE_COUNT
+} MachineGauge;
+
+static const struct {
+  const char *name;
+  const char *help;
+  AcquisitionPlan group; // 0 = always exported
+} machine_gauges[GAUGE_COUNT] = {
+    {"focas_machine_run_status",
+     "cnc_statinfo run status (0 stopped, 1 running, 2 paused, 3 alarm), "
+     "-1 if unknown",
+     ACQ_STATUS},
+    {"focas_machine_motion_status",
+     "cnc_statinfo motion status (1 moving), -1 if unknown", ACQ_STATUS},
+    {"focas_machine_program_number", "Running program number", ACQ_PROGRAM},
+    {"focas_machine_feed_rate", "Actual feed rate", ACQ_SPEED},
+    {"focas_machine_spindle_speed", "Actual spindle speed", ACQ_SPEED},
+    {"focas_machine_alarm", "1 while the control is in alarm", ACQ_ALARM},
+    {"focas_machine_late",
+     "1 if the machine missed the cycle deadline and the data is older", 0}};
+
+static long machine_gauge_value(const MachineInfo *info, MachineGauge gauge) {
+  switch (gauge) {
+    case GAUGE_RUN_STATUS:
+      return info->run_status;
+    case GAUGE_MOTION_STATUS:
+      return info->motion_status;
+    case GAUGE_PROGRAM_NUMBER:
+      return info->program_number;
+    case GAUGE_FEED_RATE:
+      return info->speed.feed_rate;
+    case GAUGE_SPINDLE_SPEED:
+      return info->speed.spindle_speed;
+    case GAUGE_ALARM:
+      return info->alarm.has_alarm ? 1 : 0;
+    default:
+      return info->late ? 1 : 0;
+  }
+}
+
+static void serialize_metric_family(OutputBuffer *buffer, const char *name,
+                                    const char *type, const char *help) {
+  output_buffer_puts(buffer, "# HELP ");
+  output_buffer_puts(buffer, name);
+  output_buffer_char(buffer, ' ');
+  output_buffer_puts(buffer, help);
+  output_buffer_puts(buffer, "\n# TYPE ");
+  output_buffer_puts(buffer, name);
+  output_buffer_char(buffer, ' ');
+  output_buffer_puts(buffer, type);
+  output_buffer_char(buffer, '\n');
+}
+
+// Start a sample line up to and including its machine label; the caller adds
+// any further labels and closes the set
+static void serialize_metric_machine(OutputBuffer *buffer, const char *name,
+                                     const char *suffix,
+                                     const char *machine) {
+  output_buffer_puts(buffer, name);
+  output_buffer_puts(buffer, suffix);
+  output_buffer_puts(buffer, "{machine=\"");
+  for (const char *c = machine; *c; c++) {
+    if (*c == '\\' || *c == '"') {
+      output_buffer_char(buffer, '\\');
+      output_buffer_char(buffer, *c);
+    } else if (*c == '\n') {
+      output_buffer_puts(buffer, "\\n");
+    } else {
+      output_buffer_char(buffer, *c);
+    }
+  }
+  output_buffer_char(buffer, '"');
+}
+
+static void serialize_metric_long(OutputBuffer *buffer, long value) {
+  output_buffer_puts(buffer, "} ");
+  output_buffer_long(buffer, value);
+  output_buffer_char(buffer, '\n');
+}
+
+static void serialize_metric_seconds(OutputBuffer *buffer, double ms) {
+  output_buffer_puts(buffer, "} ");
+  output_buffer_fixed(buffer, ms / 1000.0, 6);
+  output_buffer_char(buffer, '\n');
+}
+
+// A latency summary as quantile, _sum and _count samples. labels continues
+// the label set after the machine label, e.g. ",function=\"cnc_rdspeed\"".
+static void serialize_metric_summary(OutputBuffer *buffer, const char *name,
+                                     const char *machine, const char *labels,
+                                     const LatencySummary *summary) {
+  static const char *quantiles[] = {"0.5", "0.9", "0.99"};
+  double values[] = {summary->p50_ms, summary->p90_ms, summary->p99_ms};
+  for (int q = 0; q < 3; q++) {
+    serialize_metric_machine(buffer, name, "", machine);
+    output_buffer_puts(buffer, labels);
+    output_buffer_puts(buffer, ",quantile=\"");
+    output_buffer_puts(buffer, quantiles[q]);
+    output_buffer_char(buffer, '"');
+    serialize_metric_seconds(buffer, values[q]);
+  }
+  serialize_metric_machine(buffer, name, "_sum", machine);
+  output_buffer_puts(buffer, labels);
+  serialize_metric_seconds(buffer, summary->total_ms);
+  serialize_metric_machine(buffer, name, "_count", machine);
+  output_buffer_puts(buffer, labels);
+  serialize_metric_long(buffer, (long) summary->count);
+}
+
+static void serialize_metric_value(OutputBuffer *buffer, const char *name,
+                                   const char *type, const char *help,
+                                   double value, int decimals) {
+  serialize_metric_family(buffer, name, type, help);
+  output_buffer_puts(buffer, name);
+  output_buffer_char(buffer, ' ');
+  output_buffer_fixed(buffer, value, decimals);
+  output_buffer_char(buffer, '\n');
+}
+
+// Connection state of every configured machine and the pool counters
+// (takes the pool lock)
+static void serialize_pool_metrics(OutputBuffer *buffer, ConnectionPool *pool) {
+  platform_mutex_lock(&pool->lock);
+
+  serialize_metric_family(buffer, "focas_machine_up", "gauge",
+                          "1 while the machine's FOCAS connection is open");
+  for (int i = 0; i < pool->machine_count; i++) {
+    const MachineHandle *machine = pool->machines[i];
+    serialize_metric_machine(buffer, "focas_machine_up", "",
+                             machine->friendly_name);
+    bool up = machine->state == CONN_CONNECTED || machine->state == CONN_BUSY;
+    serialize_metric_long(buffer, up ? 1 : 0);
+  }
+
+  serialize_metric_family(buffer, "focas_machine_connection_state", "gauge",
+                          "0 disconnected, 1 connecting, 2 connected, "
+                          "3 error, 4 busy");
+  for (int i = 0; i < pool->machine_count; i++) {
+    const MachineHandle *machine = pool->machines[i];
+    serialize_metric_machine(buffer, "focas_machine_connection_state", "",
+                             machine->friendly_name);
+    serialize_metric_long(buffer, (long) machine->state);
+  }
+
+  serialize_metric_family(buffer, "focas_machine_connects_total", "counter",
+                          "Successful connects, reconnects included");
+  for (int i = 0; i < pool->machine_count; i++) {
+    const MachineHandle *machine = pool->machines[i];
+    serialize_metric_machine(buffer, "focas_machine_connects_total", "",
+                             machine->friendly_name);
+    serialize_metric_long(buffer, machine->connections);
+  }
+
+  serialize_metric_family(buffer, "focas_machine_connect_failures", "gauge",
+                          "Failed connects since the last successful one");
+  for (int i = 0; i < pool->machine_count; i++) {
+    const MachineHandle *machine = pool->machines[i];
+    serialize_metric_machine(buffer, "focas_machine_connect_failures", "",
+                             machine->friendly_name);
+    serialize_metric_long(buffer, machine->retry_count);
+  }
+
+  serialize_metric_family(buffer, "focas_machine_breaker_state", "gauge",
+                          "Circuit breaker: 0 closed, 1 open (attempts "
+                          "skipped), 2 half-open");
+  for (int i = 0; i < pool->machine_count; i++) {
+    const MachineHandle *machine = pool->machines[i];
+    serialize_metric_machine(buffer, "focas_machine_breaker_state", "",
+                             machine->friendly_name);
+    serialize_metric_long(buffer, (long) machine->breaker.state);
+  }
+
+  serialize_metric_value(buffer, "focas_machines", "gauge",
+                         "Configured machines", pool->machine_count, 0);
+  serialize_metric_value(buffer, "focas_connects_total", "counter",
+                         "Successful connects to all machines",
+                         pool->total_connections, 0);
+  serialize_metric_value(buffer, "focas_successful_operations_total",
+                         "counter", "Machine reads that returned data",
+                         pool->successful_operations, 0);
+  serialize_metric_value(buffer, "focas_failed_operations_total", "counter",
+                         "Machine reads that failed", pool->failed_operations,
+                         0);
+  serialize_metric_value(buffer, "focas_cycles_total", "counter",
+                         "Completed read cycles", pool->cycles, 0);
+  serialize_metric_value(buffer, "focas_cycle_duration_seconds", "gauge",
+                         "Duration of the latest read cycle",
+                         pool->last_cycle_ms / 1000.0, 6);
+  serialize_metric_value(buffer, "focas_cycle_duration_seconds_total",
+                         "counter", "Duration of all read cycles",
+                         pool->cycle_ms_total / 1000.0, 6);
+
+  platform_mutex_unlock(&pool->lock);
+}
+
+// The whole exposition: published machine values, latencies, then the pool
+void serialize_metrics(OutputBuffer *buffer, ConnectionPool *pool,
+                       const MultiMachineInfo *multi_info) {
+  for (int g = 0; g < GAUGE_COUNT; g++) {
+    serialize_metric_family(buffer, machine_gauges[g].name, "gauge",
+                            machine_gauges[g].help);
+    for (int i = 0; i < multi_info->machine_count; i++) {
+      const MachineInfo *info = &multi_info->machines[i];
+      const MachineHandle *machine =
+          connection_pool_get_machine(pool, multi_info->machine_ids[i]);
+      if (!machine
+          || (machine_gauges[g].group
+              && !(info->fields & machine_gauges[g].group))) {
+        continue;
+      }
+      serialize_metric_machine(buffer, machine_gauges[g].name, "",
+                               machine->friendly_name);
+      serialize_metric_long(buffer,
+                            machine_gauge_value(info, (MachineGauge) g));
+    }
+  }
+
+  serialize_metric_family(buffer, "focas_machine_read_duration_seconds",
+                          "summary",
+                          "Time to read a machine, reconnects included");
+  for (int i = 0; i < multi_info->machine_count; i++) {
+    const MachineHandle *machine =
+        connection_pool_get_machine(pool, multi_info->machine_ids[i]);
+    if (machine) {
+      serialize_metric_summary(buffer, "focas_machine_read_duration_seconds",
+                               machine->friendly_name, "",
+                               &multi_info->machines[i].read_latency);
+    }
+  }
+
+  // Both families walk the same calls, but each must be contiguous
+  for (int errors = 0; errors < 2; errors++) {
+    const char *name = errors ? "focas_call_errors_total"
+                              : "focas_call_duration_seconds";
+    if (errors) {
+      serialize_metric_family(buffer, name, "counter",
+                              "FOCAS library calls that did not return EW_OK");
+    } else {
+      serialize_metric_family(buffer, name, "summary",
+                              "FOCAS library call latency");
+    }
+    for (int i = 0; i < multi_info->machine_count; i++) {
+      const MachineHandle *machine =
+          connection_pool_get_machine(pool, multi_info->machine_ids[i]);
+      for (int f = 0; machine && f < FOCAS_FN_COUNT; f++) {
+        const LatencySummary *summary = &multi_info->machines[i].latency[f];
+        if (summary->count == 0) {
+          continue;
+        }
+        char labels[64];
+        snprintf(labels, sizeof(labels), ",function=\"%s\"",
+                 focas_function_name((FocasFunction) f));
+        if (errors) {
+          serialize_metric_machine(buffer, name, "", machine->friendly_name);
+          output_buffer_puts(buffer, labels);
+          serialize_metric_long(buffer, (long) summary->errors);
+        } else {
+          serialize_metric_summary(buffer, name, machine->friendly_name,
+                                   labels, summary);
+        }
+      }
+    }
+  }
+
+  serialize_metric_value(buffer, "focas_snapshot_successful_reads", "gauge",
+                         "Machines read successfully in the latest snapshot",
+                         multi_info->successful_reads, 0);
+  serialize_metric_value(buffer, "focas_snapshot_failed_reads", "gauge",
+                         "Machines whose read failed in the latest snapshot",
+                         multi_info->failed_reads, 0);
+  serialize_metric_value(buffer, "focas_snapshot_late_reads", "gauge",
+                         "Machines past the cycle deadline in the latest "
+                         "snapshot",
+                         multi_info->late_reads, 0);
+
+  serialize_pool_metrics(buffer, pool);
+}
@@ -0,0 +1,462 @@
+#include "focasmonitor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+// MQTT 3.1.1 publisher for --mqtt. Every machine sample becomes a retained
+// QoS 1 message on <prefix>/<machine>/state holding the NDJSON line of that
+// sample, so a subscriber gets each machine's latest state as soon as it
+// subscribes. <prefix>/status is "online" while connected and the broker
+// publishes the "offline" will when the connection is lost.
+//
+// The sink never blocks the monitor loop. The socket is non-blocking, the
+// publishes of a cycle are appended to one buffer and written together, and
+// up to MQTT_MAX_INFLIGHT are outstanding without waiting for their PUBACK.
+// When the broker falls behind, machines are skipped rather than queued;
+// as only the newest sample of a machine is ever sent, consecutive updates
+// are coalesced into one. After a reconnect every machine is published again.
+
+#define MQTT_KEEPALIVE_S 30
+#define MQTT_RECONNECT_MS 5000
+#define MQTT_MAX_INFLIGHT 256
+#define MQTT_MAX_BACKLOG (1024 * 1024) // Unsent bytes before publishing pauses
+
+#define MQTT_CONNECT 0x10
+#define MQTT_CONNACK 0x20
+#define MQTT_PUBLISH 0x30
+#define MQTT_PUBACK 0x40
+#define MQTT_PINGREQ 0xc0
+#define MQTT_PINGRESP 0xd0
+#define MQTT_DISCONNECT 0xe0
+
+#define MQTT_QOS1 0x02
+#define MQTT_RETAIN 0x01
+
+static void mqtt_put_length(OutputBuffer *buffer, size_t length) {
+  do {
+    unsigned char byte = (unsigned char) (length & 0x7f);
+    length >>= 7;
+    output_buffer_char(buffer, (char) (length > 0 ? byte | 0x80 : byte));
+  } while (length > 0);
+}
+
+static void mqtt_put_u16(OutputBuffer *buffer, unsigned int value) {
+  output_buffer_char(buffer, (char) ((value >> 8) & 0xff));
+  output_buffer_char(buffer, (char) (value & 0xff));
+}
+
+static void mqtt_put_string(OutputBuffer *buffer, const char *text,
+                            size_t length) {
+  mqtt_put_u16(buffer, (unsigned int) length);
+  output_buffer_append(buffer, text, length);
+}
+
+// Topic levels cannot hold wildcards, and a '/' would add a level
+static void mqtt_topic(char *topic, size_t size, const char *prefix,
+                       const char *machine, const char *leaf) {
+  int length = machine
+                   ? snprintf(topic, size, "%s/%s/%s", prefix, machine, leaf)
+                   : snprintf(topic, size, "%s/%s", prefix, leaf);
+  if (!machine || length < 0) {
+    return;
+  }
+  size_t start = strlen(prefix) + 1;
+  size_t end = start + strlen(machine);
+  for (size_t i = start; i < end && i < size - 1; i++) {
+    if (topic[i] == '+' || topic[i] == '#' || topic[i] == '/') {
+      topic[i] = '_';
+    }
+  }
+}
+
+static void mqtt_queue_publish(MqttSink *sink, const char *topic,
+                               const char *payload, size_t payload_length) {
+  size_t topic_length = strlen(topic);
+  output_buffer_char(&sink->outgoing,
+                     (char) (MQTT_PUBLISH | MQTT_QOS1 | MQTT_RETAIN));
+  mqtt_put_length(&sink->outgoing, 2 + topic_length + 2 + payload_length);
+  mqtt_put_string(&sink->outgoing, topic, topic_length);
+  if (sink->next_id == 0) {
+    sink->next_id = 1; // 0 is not a valid packet identifier
+  }
+  mqtt_put_u16(&sink->outgoing, sink->next_id++);
+  output_buffer_append(&sink->outgoing, payload, payload_length);
+  sink->inflight++;
+  sink->sent_ms = platform_monotonic_ms();
+}
+
+static void mqtt_queue_connect(MqttSink *sink) {
+  char will_topic[128];
+  mqtt_topic(will_topic, sizeof(will_topic), sink->prefix, NULL, "status");
+  size_t client_length = strlen(sink->client_id);
+  size_t will_length = strlen(will_topic);
+
+  OutputBuffer *out = &sink->outgoing;
+  output_buffer_char(out, (char) MQTT_CONNECT);
+  mqtt_put_length(out, 10 + 2 + client_length + 2 + will_length + 2 + 7);
+  mqtt_put_string(out, "MQTT", 4);
+  output_buffer_char(out, 4); // Protocol level 3.1.1
+  // Clean session, will flag, will QoS 1, will retain
+  output_buffer_char(out, 0x02 | 0x04 | 0x08 | 0x20);
+  mqtt_put_u16(out, MQTT_KEEPALIVE_S);
+  mqtt_put_string(out, sink->client_id, client_length);
+  mqtt_put_string(out, will_topic, will_length);
+  mqtt_put_string(out, "offline", 7);
+  sink->sent_ms = platform_monotonic_ms();
+}
+
+static void mqtt_queue_status(MqttSink *sink, const char *status) {
+  char topic[128];
+  mqtt_topic(topic, sizeof(topic), sink->prefix, NULL, "status");
+  mqtt_queue_publish(sink, topic, status, strlen(status));
+}
+
+static void mqtt_sink_reset(MqttSink *sink, MqttState state) {
+  if (sink->socket != PLATFORM_INVALID_SOCKET) {
+    platform_socket_close(sink->socket);
+    sink->socket = PLATFORM_INVALID_SOCKET;
+  }
+  output_buffer_reset(&sink->outgoing);
+  sink->outgoing_sent = 0;
+  sink->incoming_length = 0;
+  sink->inflight = 0;
+  sink->state = state;
+  sink->state_ms = platform_monotonic_ms();
+}
+
+// Drop the connection and retry after MQTT_RECONNECT_MS, reporting the first
+// failure of an outage only
+static void mqtt_sink_fail(MqttSink *sink, const char *reason) {
+  if (!sink->warned) {
+    fprintf(stderr,
+            "Warning: MQTT broker %s:%d %s, retrying every %d seconds\n",
+            sink->host, sink->port, reason, MQTT_RECONNECT_MS / 1000);
+    sink->warned = true;
+  }
+  mqtt_sink_reset(sink, MQTT_DISCONNECTED);
+}
+
+static void mqtt_sink_connect(MqttSink *sink) {
+  char ip[64];
+  if (!platform_resolve_ipv4(sink->host, ip, sizeof(ip))) {
+    mqtt_sink_fail(sink, "cannot be resolved");
+    return;
+  }
+
+  sink->socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (sink->socket == PLATFORM_INVALID_SOCKET
+      || !platform_socket_set_nonblocking(sink->socket)
+      || !platform_socket_connect(sink->socket, ip, sink->port)) {
+    mqtt_sink_fail(sink, "is unreachable");
+    return;
+  }
+  sink->state = MQTT_CONNECTING;
+  sink->state_ms = platform_monotonic_ms();
+}
+
+// Send what the socket takes of the outgoing packets
+static bool mqtt_sink_flush(MqttSink *sink) {
+  OutputBuffer *out = &sink->outgoing;
+  while (sink->outgoing_sent < out->length) {
+    long sent = platform_send(sink->socket, out->data + sink->outgoing_sent,
+                              out->length - sink->outgoing_sent);
+    if (sent < 0 && platform_socket_would_block()) {
+      return true;
+    }
+    if (sent <= 0) {
+      return false;
+    }
+    sink->outgoing_sent += (size_t) sent;
+  }
+  output_buffer_reset(out);
+  sink->outgoing_sent = 0;
+  return true;
+}
+
+// Handle complete packets from the broker. Returns false on a protocol error
+// or a refused connection.
+static bool mqtt_sink_handle(MqttSink *sink) {
+  for (;;) {
+    // Fixed header: type, then a remaining length of up to four bytes
+    size_t length = 0;
+    size_t header = 1;
+    int shift = 0;
+    for (;;) {
+      if (header >= sink->incoming_length) {
+        return true; // Incomplete
+      }
+      unsigned char byte = sink->incoming[header++];
+      length |= (size_t) (byte & 0x7f) << shift;
+      shift += 7;
+      if (!(byte & 0x80)) {
+        break;
+      }
+      if (shift > 21) {
+        return false;
+      }
+    }
+    // A publisher is only sent short acknowledgements
+    if (header + length > sizeof(sink->incoming)) {
+      return false;
+    }
+    if (header + length > sink->incoming_length) {
+      return true;
+    }
+
+    const unsigned char *body = sink->incoming + header;
+    switch (sink->incoming[0] & 0xf0) {
+      case MQTT_CONNACK:
+        if (length < 2 || body[1] != 0) {
+          fprintf(stderr, "Error: MQTT broker %s:%d refused the connection "
+                          "(return code %d)\n",
+                  sink->host, sink->port, length < 2 ? -1 : body[1]);
+          return false;
+        }
+        sink->state = MQTT_CONNECTED;
+        sink->state_ms = platform_monotonic_ms();
+        if (sink->warned) {
+          fprintf(stderr, "MQTT broker %s:%d connected\n", sink->host,
+                  sink->port);
+        }
+        sink->warned = false;
+        // Retained state may have been missed while disconnected
+        if (sink->published_ms) {
+          memset(sink->published_ms, 0,
+                 (size_t) sink->capacity * sizeof(double));
+        }
+        mqtt_queue_status(sink, "online");
+        break;
+      case MQTT_PUBACK:
+        if (sink->inflight > 0) {
+          sink->inflight--;
+        }
+        break;
+      default:
+        break; // PINGRESP
+    }
+
+    sink->incoming_length -= header + length;
+    memmove(sink->incoming, sink->incoming + header + length,
+            sink->incoming_length);
+  }
+}
+
+static bool mqtt_sink_receive(MqttSink *sink) {
+  for (;;) {
+    long received =
+        platform_recv(sink->socket, sink->incoming + sink->incoming_length,
+                      sizeof(sink->incoming) - sink->incoming_length);
+    if (received < 0 && platform_socket_would_block()) {
+      return true;
+    }
+    if (received <= 0) {
+      return false;
+    }
+    sink->incoming_length += (size_t) received;
+    sink->received_ms = platform_monotonic_ms();
+    if (!mqtt_sink_handle(sink)) {
+      return false;
+    }
+  }
+}
+
+bool mqtt_sink_open(MqttSink *sink, const Config *conf) {
+  memset(sink, 0, sizeof(MqttSink));
+  output_buffer_init(&sink->outgoing);
+  output_buffer_init(&sink->payload);
+  sink->socket = PLATFORM_INVALID_SOCKET;
+  strncpy(sink->host, conf->mqtt_host, sizeof(sink->host) - 1);
+  sink->port = conf->mqtt_port;
+  strncpy(sink->prefix, conf->mqtt_prefix, sizeof(sink->prefix) - 1);
+  strncpy(sink->client_id, conf->mqtt_client_id,
+          sizeof(sink->client_id) - 1);
+  sink->timeout_ms = conf->timeout * 1000;
+  sink->state_ms = platform_monotonic_ms() - MQTT_RECONNECT_MS;
+
+  if (!platform_socket_startup()) {
+    fprintf(stderr, "Error: Cannot initialize sockets\n");
+    return false;
+  }
+  return true;
+}
+
+void mqtt_sink_close(MqttSink *sink) {
+  if (!sink) {
+    return;
+  }
+
+  if (sink->state == MQTT_CONNECTED) {
+    // A clean disconnect suppresses the will, so say so explicitly and give
+    // the queued messages a moment to leave
+    mqtt_queue_status(sink, "offline");
+    output_buffer_char(&sink->outgoing, (char) MQTT_DISCONNECT);
+    output_buffer_char(&sink->outgoing, 0);
+    double deadline = platform_monotonic_ms() + 1000;
+    while (mqtt_sink_flush(sink) && sink->outgoing.length > 0
+           && platform_monotonic_ms() < deadline) {
+      PlatformPollFd fd = {0};
+      fd.fd = sink->socket;
+      fd.events = POLLOUT;
+      platform_poll(&fd, 1, 100);
+    }
+  }
+  mqtt_sink_reset(sink, MQTT_DISCONNECTED);
+  free(sink->published_ms);
+  output_buffer_free(&sink->outgoing);
+  output_buffer_free(&sink->payload);
+  memset(sink, 0, sizeof(MqttSink));
+  sink->socket = PLATFORM_INVALID_SOCKET;
+}
+
+// Advance the connection without blocking: connect, read acknowledgements,
+// write pending packets and keep the session alive. Call it often, at least
+// every few seconds.
+void mqtt_sink_poll(MqttSink *sink) {
+  double now = platform_monotonic_ms();
+  if (sink->state == MQTT_DISCONNECTED) {
+    if (now - sink->state_ms >= MQTT_RECONNECT_MS) {
+      mqtt_sink_connect(sink);
+    }
+    if (sink->state == MQTT_DISCONNECTED) {
+      return;
+    }
+  }
+
+  if (sink->state == MQTT_CONNECTING) {
+    PlatformPollFd fd = {0};
+    fd.fd = sink->socket;
+    fd.events = POLLOUT;
+    if (platform_poll(&fd, 1, 0) > 0) {
+      if (platform_socket_error(sink->socket) != 0) {
+        mqtt_sink_fail(sink, "refused the connection");
+        return;
+      }
+      mqtt_queue_connect(sink);
+      sink->state = MQTT_HANDSHAKE;
+      sink->state_ms = now;
+      sink->received_ms = now;
+    } else if (now - sink->state_ms > sink->timeout_ms) {
+      mqtt_sink_fail(sink, "did not answer");
+      return;
+    } else {
+      return;
+    }
+  }
+
+  if (!mqtt_sink_flush(sink) || !mqtt_sink_receive(sink)) {
+    mqtt_sink_fail(sink, "closed the connection");
+    return;
+  }
+
+  if (sink->state == MQTT_HANDSHAKE) {
+    if (now - sink->state_ms > sink->timeout_ms) {
+      mqtt_sink_fail(sink, "did not acknowledge the connection");
+    }
+    return;
+  }
+
+  // Pings keep the session alive and prove the broker is still answering
+  if (now - sink->sent_ms >= MQTT_KEEPALIVE_S * 1000 / 2) {
+    output_buffer_char(&sink->outgoing, (char) MQTT_PINGREQ);
+    output_buffer_char(&sink->outgoing, 0);
+    sink->sent_ms = now;
+    if (!mqtt_sink_flush(sink)) {
+      mqtt_sink_fail(sink, "closed the connection");
+      return;
+    }
+  }
+  if (now - sink->received_ms > MQTT_KEEPALIVE_S * 1000
+      && (sink->inflight > 0 || sink->outgoing.length > 0)) {
+    mqtt_sink_fail(sink, "stopped answering");
+  }
+}
+
+// Make room for pool machine ids below machine_count, returns false on
+// allocation failure
+static bool mqtt_sink_reserve(MqttSink *sink, int machine_count) {
+  if (machine_count <= sink->capacity) {
+    return true;
+  }
+
+  int capacity = sink->capacity > 0 ? sink->capacity
+                                    : INITIAL_MACHINE_CAPACITY;
+  while (capacity < machine_count) {
+    capacity *= 2;
+  }
+
+  double *published_ms =
+      realloc(sink->published_ms, (size_t) capacity * sizeof(double));
+  if (!published_ms) {
+    return false;
+  }
+  memset(published_ms + sink->capacity, 0,
+         (size_t) (capacity - sink->capacity) * sizeof(double));
+  sink->published_ms = published_ms;
+  sink->capacity = capacity;
+  return true;
+}
+
+// Queue the newest sample of every machine not published yet and send them
+// in one write. Returns the number of messages queued, or -1 if the samples
+// could not be tracked. Nothing is queued while disconnected; the samples are
+// published once the broker is back.
+int mqtt_sink_publish(MqttSink *sink, const ConnectionPool *pool,
+                      const MultiMachineInfo *multi_info) {
+  if (!mqtt_sink_reserve(sink, pool->machine_count)) {
+    fprintf(stderr, "Error: Out of memory publishing to MQTT\n");
+    return -1;
+  }
+  if (sink->state != MQTT_CONNECTED || multi_info->machine_count == 0) {
+    return 0;
+  }
+
+  double wall_offset_ms = platform_wall_ms() - platform_monotonic_ms();
+  int count = multi_info->machine_count;
+  int start = sink->cursor < count ? sink->cursor : 0;
+  int queued = 0;
+  for (int n = 0; n < count; n++) {
+    int i = (start + n) % count;
+    const MachineInfo *info = &multi_info->machines[i];
+    int id = multi_info->machine_ids[i];
+    const MachineHandle *machine = connection_pool_get_machine(pool, id);
+    if (!machine || info->sampled_ms == sink->published_ms[id]) {
+      continue;
+    }
+    // Under backpressure the rest waits; by then it may have newer samples
+    if (sink->inflight >= MQTT_MAX_INFLIGHT
+        || sink->outgoing.length - sink->outgoing_sent > MQTT_MAX_BACKLOG) {
+      sink->cursor = i;
+      break;
+    }
+
+    char topic[256];
+    mqtt_topic(topic, sizeof(topic), sink->prefix, machine->friendly_name,
+               "state");
+    output_buffer_reset(&sink->payload);
+    serialize_machine_info_ndjson(&sink->payload, info, machine,
+                                  wall_offset_ms);
+    if (sink->payload.failed) {
+      break;
+    }
+    // The line without its newline
+    mqtt_queue_publish(sink, topic, sink->payload.data,
+                       sink->payload.length - 1);
+    sink->published_ms[id] = info->sampled_ms;
+    queued++;
+  }
+
+  if (sink->outgoing.failed) {
+    fprintf(stderr, "Error: Out of memory publishing to MQTT\n");
+    mqtt_sink_reset(sink, MQTT_DISCONNECTED);
+    return -1;
+  }
+  if (queued > 0 && !mqtt_sink_flush(sink)) {
+    mqtt_sink_fail(sink, "closed the connection");
+  }
+  return queued;
+}
@@ -0,0 +1,283 @@
+#include "focasmonitor.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Newline-delimited JSON for log shippers and tail -f. Every line is one
+// machine sample and carries everything needed to interpret it on its own:
+// machine name and address, wall and monotonic timestamps and the groups the
+// acquisition plan read. A machine only produces a line when it has a sample
+// newer than the last one written, so cached and late entries are skipped.
+//
+// With --ndjson-file the lines go to that file. It is renamed to
+// <path>.<YYYYmmdd-HHMMSS> when it reaches --rotate-size or --rotate-interval
+// and a fresh one is started under the original name, so tail -F keeps
+// following. If the rename fails (on Windows, e.g. while a reader holds the
+// file open) writing carries on in the same file and rotation is retried after
+// NDJSON_ROTATE_RETRY_MS rather than every cycle.
+//
+// Each cycle's lines are synced to disk, but at most once per
+// --fsync-interval: lines written sooner are synced by the first cycle after
+// the interval has passed, whether or not that cycle has lines of its own.
+
+#define NDJSON_ROTATE_RETRY_MS 60000.0
+
+static bool ndjson_writer_reopen(NdjsonWriter *writer) {
+  writer->fd = platform_open_append(writer->path, &writer->file_bytes);
+  if (writer->fd < 0) {
+    fprintf(stderr, "Error: Cannot open NDJSON file '%s'\n", writer->path);
+    return false;
+  }
+  writer->opened_ms = platform_monotonic_ms();
+  writer->synced_ms = writer->opened_ms;
+  writer->opened_stamp = time(NULL);
+  return true;
+}
+
+bool ndjson_writer_open(NdjsonWriter *writer, const Config *conf) {
+  memset(writer, 0, sizeof(NdjsonWriter));
+  output_buffer_init(&writer->output);
+  writer->fd = -1;
+  strncpy(writer->path, conf->ndjson_file, sizeof(writer->path) - 1);
+  writer->rotate_bytes = (long long) conf->rotate_size_mb * 1024 * 1024;
+  writer->rotate_ms = conf->rotate_interval * 1000.0;
+  writer->fsync_interval_ms = conf->fsync_interval_ms;
+
+  if (strlen(writer->path) == 0) {
+    return true;
+  }
+  return ndjson_writer_reopen(writer);
+}
+
+static void ndjson_writer_sync(NdjsonWriter *writer, double now) {
+  if (writer->unsynced && !platform_sync(writer->fd)) {
+    fprintf(stderr, "Warning: fsync of NDJSON file '%s' failed\n",
+            writer->path);
+  }
+  writer->unsynced = false;
+  writer->synced_ms = now;
+}
+
+void ndjson_writer_close(NdjsonWriter *writer) {
+  if (!writer) {
+    return;
+  }
+
+  if (writer->fd >= 0) {
+    ndjson_writer_sync(writer, platform_monotonic_ms());
+    platform_close(writer->fd);
+  }
+  free(writer->written_ms);
+  output_buffer_free(&writer->output);
+  memset(writer, 0, sizeof(NdjsonWriter));
+  writer->fd = -1;
+}
+
+// Move the active file aside under its opening time and start a new one.
+// Rotations within the same second get a numeric suffix.
+static bool ndjson_writer_rotate(NdjsonWriter *writer, double now) {
+  ndjson_writer_sync(writer, now);
+  platform_close(writer->fd);
+  writer->fd = -1;
+
+  char stamp[32];
+  struct tm *opened = localtime(&writer->opened_stamp);
+  if (!opened
+      || strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", opened) == 0) {
+    snprintf(stamp, sizeof(stamp), "%ld", (long) writer->opened_stamp);
+  }
+
+  char rotated[sizeof(writer->path) + 48];
+  snprintf(rotated, sizeof(rotated), "%s.%s", writer->path, stamp);
+  for (int n = 1; n < 1000; n++) {
+    FILE *existing = fopen(rotated, "r");
+    if (!existing) {
+      break;
+    }
+    fclose(existing);
+    snprintf(rotated, sizeof(rotated), "%s.%s.%d", writer->path, stamp, n);
+  }
+  if (rename(writer->path, rotated) != 0) {
+    fprintf(stderr,
+            "Warning: Cannot rotate NDJSON file '%s' to '%s', retrying in "
+            "%.0f s\n",
+            writer->path, rotated, NDJSON_ROTATE_RETRY_MS / 1000.0);
+    writer->rotate_retry_ms = now + NDJSON_ROTATE_RETRY_MS;
+  }
+
+  return ndjson_writer_reopen(writer);
+}
+
+// Make room for pool machine ids below machine_count, returns false on
+// allocation failure
+static bool ndjson_writer_reserve(NdjsonWriter *writer, int machine_count) {
+  if (machine_count <= writer->capacity) {
+    return true;
+  }
+
+  int capacity = writer->capacity > 0 ? writer->capacity
+                                      : INITIAL_MACHINE_CAPACITY;
+  while (capacity < machine_count) {
+    capacity *= 2;
+  }
+
+  double *written_ms =
+      realloc(writer->written_ms, (size_t) capacity * sizeof(double));
+  if (!written_ms) {
+    return false;
+  }
+  // Monotonic time is positive, so 0 means nothing written yet
+  memset(written_ms + writer->capacity, 0,
+         (size_t) (capacity - writer->capacity) * sizeof(double));
+  writer->written_ms = written_ms;
+  writer->capacity = capacity;
+  return true;
+}
+
+static void serialize_ndjson_key(OutputBuffer *buffer, const char *key) {
+  output_buffer_puts(buffer, ",\"");
+  output_buffer_puts(buffer, key);
+  output_buffer_puts(buffer, "\":");
+}
+
+// One sample as a single line. wall_offset_ms converts the monotonic sample
+// time to milliseconds since the Unix epoch.
+void serialize_machine_info_ndjson(OutputBuffer *buffer,
+                                   const MachineInfo *info,
+                                   const MachineHandle *machine,
+                                   double wall_offset_ms) {
+  output_buffer_puts(buffer, "{\"time_ms\":");
+  output_buffer_llong(buffer, llround(info->sampled_ms + wall_offset_ms));
+  serialize_ndjson_key(buffer, "monotonic_ms");
+  output_buffer_fixed(buffer, info->sampled_ms, 3);
+  serialize_ndjson_key(buffer, "machine");
+  output_buffer_json_string(buffer, machine->friendly_name);
+  serialize_ndjson_key(buffer, "ip");
+  output_buffer_json_string(buffer, machine->ip);
+  serialize_ndjson_key(buffer, "port");
+  output_buffer_long(buffer, machine->port);
+  if (info->fields & ACQ_ID) {
+    serialize_ndjson_key(buffer, "machine_id");
+    output_buffer_json_string(buffer, info->machine_id);
+  }
+  if (info->fields & ACQ_PROGRAM) {
+    serialize_ndjson_key(buffer, "program_name");
+    output_buffer_json_string(buffer, info->program_name);
+    serialize_ndjson_key(buffer, "program_number");
+    output_buffer_long(buffer, info->program_number);
+  }
+  if (info->fields & ACQ_STATUS) {
+    serialize_ndjson_key(buffer, "status");
+    output_buffer_json_string(buffer, info->status);
+  }
+  if (info->fields & ACQ_SEQUENCE) {
+    serialize_ndjson_key(buffer, "sequence_number");
+    output_buffer_long(buffer, info->sequence_number);
+  }
+  if (info->fields & ACQ_POSITION) {
+    serialize_ndjson_key(buffer, "position");
+    output_buffer_char(buffer, '[');
+    for (int i = 0; i < info->position.axis_count; i++) {
+      const AxisPosition *axis = &info->position.axes[i];
+      output_buffer_puts(buffer, i > 0 ? ",{\"axis\":" : "{\"axis\":");
+      output_buffer_json_string(buffer, axis->name);
+      output_buffer_puts(buffer, ",\"absolute\":");
+      output_buffer_fixed(buffer, axis->absolute, 3);
+      output_buffer_puts(buffer, ",\"relative\":");
+      output_buffer_fixed(buffer, axis->relative, 3);
+      output_buffer_puts(buffer, ",\"machine\":");
+      output_buffer_fixed(buffer, axis->machine, 3);
+      output_buffer_puts(buffer, ",\"distance\":");
+      output_buffer_fixed(buffer, axis->distance, 3);
+      output_buffer_char(buffer, '}');
+    }
+    output_buffer_char(buffer, ']');
+  }
+  if (info->fields & ACQ_SPEED) {
+    serialize_ndjson_key(buffer, "feed_rate");
+    output_buffer_long(buffer, info->speed.feed_rate);
+    serialize_ndjson_key(buffer, "spindle_speed");
+    output_buffer_long(buffer, info->speed.spindle_speed);
+  }
+  if (info->fields & ACQ_ALARM) {
+    serialize_ndjson_key(buffer, "has_alarm");
+    output_buffer_puts(buffer, info->alarm.has_alarm ? "true" : "false");
+    serialize_ndjson_key(buffer, "alarm_status");
+    output_buffer_long(buffer, info->alarm.alarm_status);
+  }
+  output_buffer_puts(buffer, "}\n");
+}
+
+// Write a line for every machine with a new sample, in one write. Returns the
+// number of lines written, or -1 if they could not be formatted or written.
+int ndjson_writer_write(NdjsonWriter *writer, const ConnectionPool *pool,
+                        const MultiMachineInfo *multi_info) {
+  if (!ndjson_writer_reserve(writer, pool->machine_count)) {
+    fprintf(stderr, "Error: Out of memory formatting NDJSON output\n");
+    return -1;
+  }
+
+  double wall_offset_ms = platform_wall_ms() - platform_monotonic_ms();
+  OutputBuffer *buffer = &writer->output;
+  output_buffer_reset(buffer);
+
+  int lines = 0;
+  for (int i = 0; i < multi_info->machine_count; i++) {
+    const MachineInfo *info = &multi_info->machines[i];
+    int id = multi_info->machine_ids[i];
+    const MachineHandle *machine = connection_pool_get_machine(pool, id);
+    if (!machine || info->sampled_ms == writer->written_ms[id]) {
+      continue;
+    }
+    serialize_machine_info_ndjson(buffer, info, machine, wall_offset_ms);
+    writer->written_ms[id] = info->sampled_ms;
+    lines++;
+  }
+  if (buffer->failed) {
+    fprintf(stderr, "Error: Out of memory formatting NDJSON output\n");
+    return -1;
+  }
+
+  if (strlen(writer->path) == 0) {
+    return lines == 0 || output_buffer_write(buffer, 1) ? lines : -1;
+  }
+
+  // A cycle without new samples still syncs what earlier cycles left pending
+  double now = platform_monotonic_ms();
+  if (lines == 0) {
+    if (writer->unsynced
+        && now - writer->synced_ms >= writer->fsync_interval_ms) {
+      ndjson_writer_sync(writer, now);
+    }
+    return 0;
+  }
+
+  // Rotate before a write that would cross a limit, so a cycle's lines stay
+  // together in one file
+  bool full = writer->rotate_bytes > 0
+              && writer->file_bytes + (long long) buffer->length
+                     > writer->rotate_bytes;
+  bool old = writer->rotate_ms > 0
+             && now - writer->opened_ms >= writer->rotate_ms;
+  if (writer->fd >= 0 && writer->file_bytes > 0 && (full || old)
+      && now >= writer->rotate_retry_ms) {
+    ndjson_writer_rotate(writer, now);
+  }
+  if (writer->fd < 0 && !ndjson_writer_reopen(writer)) {
+    return -1;
+  }
+
+  if (!output_buffer_write(buffer, writer->fd)) {
+    fprintf(stderr, "Error: Failed to write NDJSON file '%s'\n", writer->path);
+    return -1;
+  }
+  writer->file_bytes += (long long) buffer->length;
+  writer->unsynced = true;
+  if (now - writer->synced_ms >= writer->fsync_interval_ms) {
+    ndjson_writer_sync(writer, now);
+  }
+  return lines;
+}
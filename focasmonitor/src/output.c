@@ -57,6 +57,8 @@ OutputFormat parse_output_format(const char *format_str) {
     return OUTPUT_JSON;
   } else if (strcmp(format_str, "csv") == 0) {
     return OUTPUT_CSV;
+  } else if (strcmp(format_str, "ndjson") == 0) {
+    return OUTPUT_NDJSON;
   } else {
     return OUTPUT_CONSOLE;
   }
@@ -64,48 +66,108 @@ OutputFormat parse_output_format(const char *format_str) {
 
 void print_machine_info(const MachineInfo *info, const char *machine_name) {
   printf("=== %s ===\n", machine_name);
-  printf("Machine ID: %s\n", info->machine_id);
-  printf("Current Program: %s", info->program_name);
-  if (info->program_number > 0) {
-    printf(" (Number: %d)", info->program_number);
+  if (info->fields & ACQ_ID) {
+    printf("Machine ID: %s\n", info->machine_id);
+  }
+  if (info->fields & ACQ_PROGRAM) {
+    printf("Current Program: %s", info->program_name);
+    if (info->program_number > 0) {
+      printf(" (Number: %d)", info->program_number);
+    }
+    printf("\n");
+  }
+  if (info->fields & ACQ_STATUS) {
+    printf("Machine Status: %s\n", info->status);
   }
-  printf("\n");
-  printf("Machine Status: %s\n", info->status);
 
-  if (info->sequence_number > 0) {
+  if ((info->fields & ACQ_SEQUENCE) && info->sequence_number > 0) {
     printf("Current Sequence: N%ld\n", info->sequence_number);
   }
 
   // Position information
-  printf("\n--- Position Information ---\n");
-  printf("Absolute Position:\n");
-  printf("  X: %8.3f mm\n", info->position.x_abs);
-  printf("  Y: %8.3f mm\n", info->position.y_abs);
-  printf("  Z: %8.3f mm\n", info->position.z_abs);
-  printf("Relative Position:\n");
-  printf("  X: %8.3f mm\n", info->position.x_rel);
-  printf("  Y: %8.3f mm\n", info->position.y_rel);
-  printf("  Z: %8.3f mm\n", info->position.z_rel);
+  if (info->fields & ACQ_POSITION) {
+    printf("\n--- Position Information (%d axes) ---\n",
+           info->position.axis_count);
+    printf("  %-4s %12s %12s %12s %12s\n", "Axis", "Absolute", "Relative",
+           "Machine", "To Go");
+    for (int i = 0; i < info->position.axis_count; i++) {
+      const AxisPosition *axis = &info->position.axes[i];
+      printf("  %-4s %12.3f %12.3f %12.3f %12.3f\n", axis->name,
+             axis->absolute, axis->relative, axis->machine, axis->distance);
+    }
+  }
 
   // Speed information
-  printf("\n--- Speed Information ---\n");
-  printf("Feed Rate: %d mm/min\n", info->speed.feed_rate);
-  printf("Spindle Speed: %d RPM\n", info->speed.spindle_speed);
+  if (info->fields & ACQ_SPEED) {
+    printf("\n--- Speed Information ---\n");
+    printf("Feed Rate: %d mm/min\n", info->speed.feed_rate);
+    printf("Spindle Speed: %d RPM\n", info->speed.spindle_speed);
+  }
 
   // Alarm information
-  printf("\n--- Alarm Information ---\n");
-  printf("Alarm Status: %s\n", info->alarm.has_alarm ? "ACTIVE" : "NONE");
-  if (info->alarm.has_alarm) {
-    printf("Alarm Code: %d\n", info->alarm.alarm_status);
+  if (info->fields & ACQ_ALARM) {
+    printf("\n--- Alarm Information ---\n");
+    printf("Alarm Status: %s\n", info->alarm.has_alarm ? "ACTIVE" : "NONE");
+    if (info->alarm.has_alarm) {
+      printf("Alarm Code: %d\n", info->alarm.alarm_status);
+    }
   }
 
   printf("Last Updated: %s", ctime(&info->last_updated));
+  if (info->late) {
+    printf("Data Age: LATE (machine missed the cycle deadline)\n");
+  }
   printf("\n");
 }
 
+void print_machine_identity(FILE *stream, const MachineIdentity *identity,
+                            const char *indent) {
+  fprintf(stream, "%sCNC: Series %s %s (software %s version %s)\n", indent,
+          identity->cnc_type, identity->mt_type, identity->series,
+          identity->version);
+  fprintf(stream, "%sAxes (%d):", indent, identity->axis_count);
+  for (int i = 0; i < identity->axis_count; i++) {
+    fprintf(stream, " %s", identity->axis_names[i]);
+  }
+  fprintf(stream, "\n%sSpindles (%d):", indent, identity->spindle_count);
+  for (int i = 0; i < identity->spindle_count; i++) {
+    fprintf(stream, " %s", identity->spindle_names[i]);
+  }
+  fprintf(stream, "\n");
+}
+
+// Percentiles of every FOCAS function the machine has called
+void print_machine_latency(const LatencyHistogram *latency,
+                           const char *indent) {
+  bool header = false;
+  for (int f = 0; f < FOCAS_FN_COUNT; f++) {
+    if (latency[f].count == 0) {
+      continue;
+    }
+    if (!header) {
+      printf("%sFOCAS call latency (ms):\n", indent);
+      printf("%s  %-16s %7s %6s %8s %8s %8s %8s\n", indent, "Function",
+             "Calls", "Errors", "p50", "p90", "p99", "Max");
+      header = true;
+    }
+    LatencySummary summary;
+    latency_histogram_summarize(&latency[f], &summary);
+    printf("%s  %-16s %7u %6u %8.2f %8.2f %8.2f %8.2f\n", indent,
+           focas_function_name((FocasFunction) f), summary.count,
+           summary.errors, summary.p50_ms, summary.p90_ms, summary.p99_ms,
+           summary.max_ms);
+  }
+}
+
 void print_selective_machine_info(const MachineInfo *info,
                                   const char *machine_name,
                                   const char *info_type) {
+  char name_buf[64];
+  if (info->late && strcmp(info_type, "all") != 0) {
+    snprintf(name_buf, sizeof(name_buf), "%s*", machine_name);
+    machine_name = name_buf;
+  }
+
   if (strcmp(info_type, "basic") == 0) {
     printf("%-15s | %-35s | %s\n", machine_name, info->machine_id,
            info->status);
@@ -113,9 +175,12 @@ void print_selective_machine_info(const MachineInfo *info,
     printf("%-15s | %-10s | N%-8ld | %s\n", machine_name, info->program_name,
            info->sequence_number, info->status);
   } else if (strcmp(info_type, "position") == 0) {
-    printf("%-15s | X:%8.3f | Y:%8.3f | Z:%8.3f | %s\n", machine_name,
-           info->position.x_abs, info->position.y_abs, info->position.z_abs,
-           info->status);
+    printf("%-15s | %-16s |", machine_name, info->status);
+    for (int i = 0; i < info->position.axis_count; i++) {
+      printf(" %s:%9.3f", info->position.axes[i].name,
+             info->position.axes[i].absolute);
+    }
+    printf("\n");
   } else if (strcmp(info_type, "speed") == 0) {
     printf("%-15s | Feed:%5d mm/min | Spindle:%5d RPM | %s\n", machine_name,
            info->speed.feed_rate, info->speed.spindle_speed, info->status);
@@ -132,86 +197,36 @@ void print_selective_machine_info(const MachineInfo *info,
   }
 }
 
+// JSON and CSV are formatted by serialize.c and written in one piece; this
+// buffer is reused across cycles so monitor mode does not allocate per cycle
+static OutputBuffer output_buffer;
+
 void print_machine_info_json(const MachineInfo *info,
                              const char *machine_name) {
-  printf("    {\n");
-  printf("      \"name\": \"%s\",\n", machine_name);
-  printf("      \"machine_id\": \"%s\",\n", info->machine_id);
-  printf("      \"program_name\": \"%s\",\n", info->program_name);
-  printf("      \"program_number\": %d,\n", info->program_number);
-  printf("      \"status\": \"%s\",\n", info->status);
-  printf("      \"sequence_number\": %ld,\n", info->sequence_number);
-  printf("      \"position\": {\n");
-  printf("        \"x_abs\": %.3f,\n", info->position.x_abs);
-  printf("        \"y_abs\": %.3f,\n", info->position.y_abs);
-  printf("        \"z_abs\": %.3f,\n", info->position.z_abs);
-  printf("        \"x_rel\": %.3f,\n", info->position.x_rel);
-  printf("        \"y_rel\": %.3f,\n", info->position.y_rel);
-  printf("        \"z_rel\": %.3f\n", info->position.z_rel);
-  printf("      },\n");
-  printf("      \"speed\": {\n");
-  printf("        \"feed_rate\": %d,\n", info->speed.feed_rate);
-  printf("        \"spindle_speed\": %d\n", info->speed.spindle_speed);
-  printf("      },\n");
-  printf("      \"alarm\": {\n");
-  printf("        \"has_alarm\": %s,\n",
-         info->alarm.has_alarm ? "true" : "false");
-  printf("        \"alarm_status\": %d\n", info->alarm.alarm_status);
-  printf("      },\n");
-  printf("      \"last_updated\": %ld\n", info->last_updated);
-  printf("    }");
+  output_buffer_reset(&output_buffer);
+  serialize_machine_info_json(&output_buffer, info, machine_name, -1);
+  output_buffer_write(&output_buffer, 1);
 }
 
 void print_machine_info_csv(const MachineInfo *info, const char *machine_name,
                             bool header) {
+  output_buffer_reset(&output_buffer);
   if (header) {
-    printf("machine_name,machine_id,program_name,program_number,status,"
-           "sequence_number,");
-    printf("x_abs,y_abs,z_abs,x_rel,y_rel,z_rel,feed_rate,spindle_speed,has_"
-           "alarm,alarm_status,last_updated\n");
+    serialize_csv_header(&output_buffer);
   } else {
-    printf("%s,%s,%s,%d,%s,%ld,", machine_name, info->machine_id,
-           info->program_name, info->program_number, info->status,
-           info->sequence_number);
-    printf("%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,", info->position.x_abs,
-           info->position.y_abs, info->position.z_abs, info->position.x_rel,
-           info->position.y_rel, info->position.z_rel);
-    printf("%d,%d,%s,%d,%ld\n", info->speed.feed_rate,
-           info->speed.spindle_speed, info->alarm.has_alarm ? "true" : "false",
-           info->alarm.alarm_status, info->last_updated);
+    serialize_machine_info_csv(&output_buffer, info, machine_name, -1);
   }
+  output_buffer_write(&output_buffer, 1);
 }
 
 void print_multi_machine_info(const MultiMachineInfo *multi_info,
                               const char *info_type, OutputFormat format) {
-  if (format == OUTPUT_JSON) {
-    printf("{\n");
-    printf("  \"collection_time\": %ld,\n", multi_info->collection_time);
-    printf("  \"machine_count\": %d,\n", multi_info->machine_count);
-    printf("  \"successful_reads\": %d,\n", multi_info->successful_reads);
-    printf("  \"failed_reads\": %d,\n", multi_info->failed_reads);
-    printf("  \"machines\": [\n");
-
-    for (int i = 0; i < multi_info->machine_count; i++) {
-      char machine_name[64];
-      snprintf(machine_name, sizeof(machine_name), "Machine_%d", i + 1);
-      print_machine_info_json(&multi_info->machines[i], machine_name);
-      if (i < multi_info->machine_count - 1) {
-        printf(",");
-      }
-      printf("\n");
-    }
-
-    printf("  ]\n");
-    printf("}\n");
-
-  } else if (format == OUTPUT_CSV) {
-    print_machine_info_csv(NULL, NULL, true); // Print header
-
-    for (int i = 0; i < multi_info->machine_count; i++) {
-      char machine_name[64];
-      snprintf(machine_name, sizeof(machine_name), "Machine_%d", i + 1);
-      print_machine_info_csv(&multi_info->machines[i], machine_name, false);
+  if (format == OUTPUT_JSON || format == OUTPUT_CSV) {
+    output_buffer_reset(&output_buffer);
+    serialize_multi_machine_info(&output_buffer, multi_info, format);
+    if (!output_buffer_write(&output_buffer, 1)) {
+      fprintf(stderr, "Error: Failed to write %s output\n",
+              format == OUTPUT_JSON ? "JSON" : "CSV");
     }
 
   } else {
@@ -226,10 +241,10 @@ void print_multi_machine_info(const MultiMachineInfo *multi_info,
       printf("%-15s-+-%-10s-+-%-10s-+-%s\n", "---------------", "----------",
              "----------", "----------");
     } else if (strcmp(info_type, "position") == 0) {
-      printf("%-15s | %-10s | %-10s | %-10s | %s\n", "Machine", "X (mm)",
-             "Y (mm)", "Z (mm)", "Status");
-      printf("%-15s-+-%-10s-+-%-10s-+-%-10s-+-%s\n", "---------------",
-             "----------", "----------", "----------", "----------");
+      printf("%-15s | %-16s | %s\n", "Machine", "Status",
+             "Absolute Position");
+      printf("%-15s-+-%-16s-+-%s\n", "---------------", "----------------",
+             "-----------------");
     } else if (strcmp(info_type, "speed") == 0) {
       printf("%-15s | %-15s | %-15s | %s\n", "Machine", "Feed (mm/min)",
              "Spindle (RPM)", "Status");
@@ -244,7 +259,8 @@ void print_multi_machine_info(const MultiMachineInfo *multi_info,
 
     for (int i = 0; i < multi_info->machine_count; i++) {
       char machine_name[64];
-      snprintf(machine_name, sizeof(machine_name), "Machine_%d", i + 1);
+      snprintf(machine_name, sizeof(machine_name), "Machine_%d",
+               multi_info->machine_ids[i] + 1);
       print_selective_machine_info(&multi_info->machines[i], machine_name,
                                    info_type);
     }
@@ -252,6 +268,11 @@ void print_multi_machine_info(const MultiMachineInfo *multi_info,
     printf("\nSummary: %d machines, %d successful reads, %d failed reads\n",
            multi_info->machine_count, multi_info->successful_reads,
            multi_info->failed_reads);
+    if (multi_info->late_reads > 0) {
+      printf("Late: %d machines missed the cycle deadline (marked *, showing "
+             "previous data)\n",
+             multi_info->late_reads);
+    }
     printf("Collection time: %s", ctime(&multi_info->collection_time));
   }
 }
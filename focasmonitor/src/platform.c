@@ -0,0 +1,620 @@
+#include "platform.h"
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#include <sys/stat.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+typedef struct {
+  PlatformThreadFunc func;
+  void *arg;
+} ThreadStart;
+
+#ifdef _WIN32
+
+static unsigned __stdcall thread_trampoline(void *param) {
+  ThreadStart start = *(ThreadStart *) param;
+  free(param);
+  start.func(start.arg);
+  return 0;
+}
+
+bool platform_thread_create(PlatformThread *thread, PlatformThreadFunc func,
+                            void *arg) {
+  ThreadStart *start = malloc(sizeof(ThreadStart));
+  if (!start)
+    return false;
+  start->func = func;
+  start->arg = arg;
+
+  uintptr_t handle = _beginthreadex(NULL, 0, thread_trampoline, start, 0, NULL);
+  if (handle == 0) {
+    free(start);
+    return false;
+  }
+  *thread = (HANDLE) handle;
+  return true;
+}
+
+void platform_thread_join(PlatformThread thread) {
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+}
+
+void platform_mutex_init(PlatformMutex *mutex) {
+  InitializeCriticalSection(mutex);
+}
+
+void platform_mutex_destroy(PlatformMutex *mutex) {
+  DeleteCriticalSection(mutex);
+}
+
+void platform_mutex_lock(PlatformMutex *mutex) {
+  EnterCriticalSection(mutex);
+}
+
+void platform_mutex_unlock(PlatformMutex *mutex) {
+  LeaveCriticalSection(mutex);
+}
+
+void platform_cond_init(PlatformCond *cond) {
+  InitializeConditionVariable(cond);
+}
+
+void platform_cond_destroy(PlatformCond *cond) {
+  (void) cond; // Win32 condition variables need no cleanup
+}
+
+void platform_cond_wait(PlatformCond *cond, PlatformMutex *mutex) {
+  SleepConditionVariableCS(cond, mutex, INFINITE);
+}
+
+bool platform_cond_timedwait(PlatformCond *cond, PlatformMutex *mutex,
+                             long timeout_ms) {
+  if (timeout_ms < 0)
+    timeout_ms = 0;
+  return SleepConditionVariableCS(cond, mutex, (DWORD) timeout_ms) != 0;
+}
+
+void platform_cond_signal(PlatformCond *cond) {
+  WakeConditionVariable(cond);
+}
+
+void platform_cond_broadcast(PlatformCond *cond) {
+  WakeAllConditionVariable(cond);
+}
+
+double platform_monotonic_ms(void) {
+  static LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  if (frequency.QuadPart == 0) {
+    QueryPerformanceFrequency(&frequency);
+  }
+  QueryPerformanceCounter(&counter);
+  return (double) counter.QuadPart * 1000.0 / (double) frequency.QuadPart;
+}
+
+double platform_wall_ms(void) {
+  FILETIME now;
+  GetSystemTimeAsFileTime(&now);
+  // 100 ns ticks since 1601
+  ULONGLONG ticks = ((ULONGLONG) now.dwHighDateTime << 32) | now.dwLowDateTime;
+  return (double) (ticks - 116444736000000000ULL) / 10000.0;
+}
+
+void platform_sleep_ms(long ms) {
+  Sleep((DWORD) ms);
+}
+
+bool platform_write(int fd, const void *data, size_t length) {
+  const char *next = data;
+  while (length > 0) {
+    unsigned int chunk = length > 0x40000000 ? 0x40000000 : (unsigned) length;
+    int written = _write(fd, next, chunk);
+    if (written <= 0) {
+      return false;
+    }
+    next += written;
+    length -= (size_t) written;
+  }
+  return true;
+}
+
+int platform_open_append(const char *path, long long *size) {
+  int fd = _open(path, _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY,
+                 _S_IREAD | _S_IWRITE);
+  if (fd >= 0) {
+    *size = _lseeki64(fd, 0, SEEK_END);
+  }
+  return fd;
+}
+
+bool platform_sync(int fd) {
+  return _commit(fd) == 0;
+}
+
+void platform_close(int fd) {
+  _close(fd);
+}
+
+static bool platform_map_view(PlatformMap *map) {
+  map->data = NULL;
+  map->mapping = NULL;
+  if (map->size == 0) {
+    return true;
+  }
+
+  ULONGLONG size = map->size;
+  map->mapping = CreateFileMappingA(
+      map->file, NULL, map->writable ? PAGE_READWRITE : PAGE_READONLY,
+      (DWORD) (size >> 32), (DWORD) size, NULL);
+  if (!map->mapping) {
+    return false;
+  }
+  map->data = MapViewOfFile(map->mapping,
+                            map->writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0,
+                            0, map->size);
+  if (!map->data) {
+    CloseHandle(map->mapping);
+    map->mapping = NULL;
+    return false;
+  }
+  return true;
+}
+
+static void platform_unmap_view(PlatformMap *map) {
+  if (map->data) {
+    UnmapViewOfFile(map->data);
+    map->data = NULL;
+  }
+  if (map->mapping) {
+    CloseHandle(map->mapping);
+    map->mapping = NULL;
+  }
+}
+
+bool platform_map_open(PlatformMap *map, const char *path, bool writable) {
+  memset(map, 0, sizeof(PlatformMap));
+  map->writable = writable;
+  map->file = CreateFileA(path,
+                          writable ? GENERIC_READ | GENERIC_WRITE
+                                   : GENERIC_READ,
+                          FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                          writable ? OPEN_ALWAYS : OPEN_EXISTING,
+                          FILE_ATTRIBUTE_NORMAL, NULL);
+  if (map->file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(map->file, &size)) {
+    CloseHandle(map->file);
+    return false;
+  }
+  map->size = (size_t) size.QuadPart;
+  if (!platform_map_view(map)) {
+    CloseHandle(map->file);
+    return false;
+  }
+  return true;
+}
+
+bool platform_map_resize(PlatformMap *map, size_t size) {
+  platform_unmap_view(map);
+  // A larger mapping extends the file; a smaller one needs an explicit end
+  LARGE_INTEGER end;
+  end.QuadPart = (LONGLONG) size;
+  if (size < map->size
+      && (!SetFilePointerEx(map->file, end, NULL, FILE_BEGIN)
+          || !SetEndOfFile(map->file))) {
+    return false;
+  }
+  map->size = size;
+  return platform_map_view(map);
+}
+
+bool platform_map_sync(PlatformMap *map) {
+  if (!map->data) {
+    return true;
+  }
+  return FlushViewOfFile(map->data, 0) && FlushFileBuffers(map->file);
+}
+
+void platform_map_close(PlatformMap *map) {
+  platform_unmap_view(map);
+  CloseHandle(map->file);
+  memset(map, 0, sizeof(PlatformMap));
+}
+
+bool platform_socket_startup(void) {
+  WSADATA data;
+  return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+}
+
+void platform_socket_close(PlatformSocket socket) {
+  closesocket(socket);
+}
+
+bool platform_socket_set_nonblocking(PlatformSocket socket) {
+  u_long enabled = 1;
+  return ioctlsocket(socket, FIONBIO, &enabled) == 0;
+}
+
+bool platform_socket_would_block(void) {
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+int platform_poll(PlatformPollFd *fds, int count, int timeout_ms) {
+  return WSAPoll(fds, (ULONG) count, timeout_ms);
+}
+
+long platform_send(PlatformSocket socket, const void *data, size_t length) {
+  int chunk = length > 0x40000000 ? 0x40000000 : (int) length;
+  return send(socket, data, chunk, 0);
+}
+
+long platform_recv(PlatformSocket socket, void *data, size_t length) {
+  int chunk = length > 0x40000000 ? 0x40000000 : (int) length;
+  return recv(socket, data, chunk, 0);
+}
+
+bool platform_socket_connect(PlatformSocket socket, const char *ip, int port) {
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons((unsigned short) port);
+  if (inet_pton(AF_INET, ip, &address.sin_addr) != 1) {
+    return false;
+  }
+  return connect(socket, (struct sockaddr *) &address, sizeof(address)) == 0
+         || WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+int platform_socket_error(PlatformSocket socket) {
+  int error = 0;
+  int length = sizeof(error);
+  if (getsockopt(socket, SOL_SOCKET, SO_ERROR, (char *) &error, &length)
+      != 0) {
+    return WSAGetLastError();
+  }
+  return error;
+}
+
+bool platform_connect_refused(int error) {
+  return error == WSAECONNREFUSED;
+}
+
+bool platform_terminal_ansi(void) {
+  HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+  DWORD mode;
+  if (console == INVALID_HANDLE_VALUE || !GetConsoleMode(console, &mode)) {
+    return false; // Redirected
+  }
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+  // Fails on consoles older than Windows 10
+  return SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING)
+         != 0;
+}
+
+bool platform_terminal_size(int *rows, int *columns) {
+  CONSOLE_SCREEN_BUFFER_INFO info;
+  if (!GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+    return false;
+  }
+  *rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+  *columns = info.srWindow.Right - info.srWindow.Left + 1;
+  return true;
+}
+
+#else
+
+static void *thread_trampoline(void *param) {
+  ThreadStart start = *(ThreadStart *) param;
+  free(param);
+  start.func(start.arg);
+  return NULL;
+}
+
+bool platform_thread_create(PlatformThread *thread, PlatformThreadFunc func,
+                            void *arg) {
+  ThreadStart *start = malloc(sizeof(ThreadStart));
+  if (!start)
+    return false;
+  start->func = func;
+  start->arg = arg;
+
+  if (pthread_create(thread, NULL, thread_trampoline, start) != 0) {
+    free(start);
+    return false;
+  }
+  return true;
+}
+
+void platform_thread_join(PlatformThread thread) {
+  pthread_join(thread, NULL);
+}
+
+void platform_mutex_init(PlatformMutex *mutex) {
+  pthread_mutex_init(mutex, NULL);
+}
+
+void platform_mutex_destroy(PlatformMutex *mutex) {
+  pthread_mutex_destroy(mutex);
+}
+
+void platform_mutex_lock(PlatformMutex *mutex) {
+  pthread_mutex_lock(mutex);
+}
+
+void platform_mutex_unlock(PlatformMutex *mutex) {
+  pthread_mutex_unlock(mutex);
+}
+
+void platform_cond_init(PlatformCond *cond) {
+  // Use the monotonic clock so wall clock adjustments cannot stretch or
+  // shorten cycle deadlines
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+void platform_cond_destroy(PlatformCond *cond) {
+  pthread_cond_destroy(cond);
+}
+
+void platform_cond_wait(PlatformCond *cond, PlatformMutex *mutex) {
+  pthread_cond_wait(cond, mutex);
+}
+
+bool platform_cond_timedwait(PlatformCond *cond, PlatformMutex *mutex,
+                             long timeout_ms) {
+  struct timespec deadline;
+  if (timeout_ms < 0)
+    timeout_ms = 0;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += timeout_ms / 1000;
+  deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+  return pthread_cond_timedwait(cond, mutex, &deadline) != ETIMEDOUT;
+}
+
+void platform_cond_signal(PlatformCond *cond) {
+  pthread_cond_signal(cond);
+}
+
+void platform_cond_broadcast(PlatformCond *cond) {
+  pthread_cond_broadcast(cond);
+}
+
+double platform_monotonic_ms(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+double platform_wall_ms(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+void platform_sleep_ms(long ms) {
+  struct timespec delay;
+  delay.tv_sec = ms / 1000;
+  delay.tv_nsec = (ms % 1000) * 1000000L;
+  while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {
+  }
+}
+
+bool platform_write(int fd, const void *data, size_t length) {
+  const char *next = data;
+  while (length > 0) {
+    ssize_t written = write(fd, next, length);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    next += written;
+    length -= (size_t) written;
+  }
+  return true;
+}
+
+int platform_open_append(const char *path, long long *size) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd >= 0) {
+    *size = (long long) lseek(fd, 0, SEEK_END);
+  }
+  return fd;
+}
+
+bool platform_sync(int fd) {
+  return fsync(fd) == 0;
+}
+
+void platform_close(int fd) {
+  close(fd);
+}
+
+static bool platform_map_view(PlatformMap *map) {
+  map->data = NULL;
+  if (map->size == 0) {
+    return true;
+  }
+
+  int protection = map->writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void *data = mmap(NULL, map->size, protection, MAP_SHARED, map->fd, 0);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  map->data = data;
+  return true;
+}
+
+bool platform_map_open(PlatformMap *map, const char *path, bool writable) {
+  memset(map, 0, sizeof(PlatformMap));
+  map->writable = writable;
+  map->fd = writable ? open(path, O_RDWR | O_CREAT, 0644)
+                     : open(path, O_RDONLY);
+  if (map->fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(map->fd, &info) != 0) {
+    close(map->fd);
+    return false;
+  }
+  map->size = (size_t) info.st_size;
+  if (!platform_map_view(map)) {
+    close(map->fd);
+    return false;
+  }
+  return true;
+}
+
+bool platform_map_resize(PlatformMap *map, size_t size) {
+  if (map->data) {
+    munmap(map->data, map->size);
+    map->data = NULL;
+  }
+  if (ftruncate(map->fd, (off_t) size) != 0) {
+    map->size = 0;
+    return false;
+  }
+  map->size = size;
+  return platform_map_view(map);
+}
+
+bool platform_map_sync(PlatformMap *map) {
+  if (!map->data) {
+    return true;
+  }
+  return msync(map->data, map->size, MS_SYNC) == 0;
+}
+
+void platform_map_close(PlatformMap *map) {
+  if (map->data) {
+    munmap(map->data, map->size);
+  }
+  close(map->fd);
+  memset(map, 0, sizeof(PlatformMap));
+  map->fd = -1;
+}
+
+bool platform_socket_startup(void) {
+  return true;
+}
+
+void platform_socket_close(PlatformSocket socket) {
+  close(socket);
+}
+
+bool platform_socket_set_nonblocking(PlatformSocket socket) {
+  int flags = fcntl(socket, F_GETFL, 0);
+  return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool platform_socket_would_block(void) {
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+int platform_poll(PlatformPollFd *fds, int count, int timeout_ms) {
+  int ready = poll(fds, (nfds_t) count, timeout_ms);
+  return ready < 0 && errno == EINTR ? 0 : ready;
+}
+
+long platform_send(PlatformSocket socket, const void *data, size_t length) {
+  return (long) send(socket, data, length, MSG_NOSIGNAL);
+}
+
+long platform_recv(PlatformSocket socket, void *data, size_t length) {
+  return (long) recv(socket, data, length, 0);
+}
+
+bool platform_socket_connect(PlatformSocket socket, const char *ip, int port) {
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons((unsigned short) port);
+  if (inet_pton(AF_INET, ip, &address.sin_addr) != 1) {
+    return false;
+  }
+  return connect(socket, (struct sockaddr *) &address, sizeof(address)) == 0
+         || errno == EINPROGRESS;
+}
+
+int platform_socket_error(PlatformSocket socket) {
+  int error = 0;
+  socklen_t length = sizeof(error);
+  if (getsockopt(socket, SOL_SOCKET, SO_ERROR, &error, &length) != 0) {
+    return errno;
+  }
+  return error;
+}
+
+bool platform_connect_refused(int error) {
+  return error == ECONNREFUSED;
+}
+
+bool platform_terminal_ansi(void) {
+  const char *term = getenv("TERM");
+  return isatty(STDOUT_FILENO) && !(term && strcmp(term, "dumb") == 0);
+}
+
+bool platform_terminal_size(int *rows, int *columns) {
+  struct winsize size;
+  if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_row == 0
+      || size.ws_col == 0) {
+    return false;
+  }
+  *rows = size.ws_row;
+  *columns = size.ws_col;
+  return true;
+}
+
+#endif
+
+// Both APIs share getaddrinfo, so one version serves both platforms
+bool platform_resolve_ipv4(const char *host, char *ip, size_t size) {
+  struct addrinfo hints;
+  struct addrinfo *result;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host, NULL, &hints, &result) != 0) {
+    return false;
+  }
+  const struct sockaddr_in *address =
+      (const struct sockaddr_in *) result->ai_addr;
+  bool ok = inet_ntop(AF_INET, &address->sin_addr, ip, (socklen_t) size)
+            != NULL;
+  freeaddrinfo(result);
+  return ok;
+}
@@ -0,0 +1,125 @@
+#ifndef FOCAS_PLATFORM_H
+#define FOCAS_PLATFORM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Thin portability layer over Win32 and POSIX threading, file and socket
+// primitives so the collection engine can be shared between the Windows and
+// Linux builds.
+
+#ifdef _WIN32
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600 // Condition variables need Vista or later
+#endif
+#include <winsock2.h> // Must come before windows.h
+#include <windows.h>
+typedef HANDLE PlatformThread;
+typedef CRITICAL_SECTION PlatformMutex;
+typedef CONDITION_VARIABLE PlatformCond;
+typedef SOCKET PlatformSocket;
+typedef WSAPOLLFD PlatformPollFd;
+#define PLATFORM_INVALID_SOCKET INVALID_SOCKET
+#else
+#include <poll.h>
+#include <pthread.h>
+typedef pthread_t PlatformThread;
+typedef pthread_mutex_t PlatformMutex;
+typedef pthread_cond_t PlatformCond;
+typedef int PlatformSocket;
+typedef struct pollfd PlatformPollFd;
+#define PLATFORM_INVALID_SOCKET (-1)
+#endif
+
+typedef void (*PlatformThreadFunc)(void *arg);
+
+// A file mapped into memory in full
+typedef struct {
+  void *data; // NULL while the file is empty
+  size_t size;
+  bool writable;
+#ifdef _WIN32
+  HANDLE file;
+  HANDLE mapping;
+#else
+  int fd;
+#endif
+} PlatformMap;
+
+// Threads
+bool platform_thread_create(PlatformThread *thread, PlatformThreadFunc func,
+                            void *arg);
+void platform_thread_join(PlatformThread thread);
+
+// Mutexes
+void platform_mutex_init(PlatformMutex *mutex);
+void platform_mutex_destroy(PlatformMutex *mutex);
+void platform_mutex_lock(PlatformMutex *mutex);
+void platform_mutex_unlock(PlatformMutex *mutex);
+
+// Condition variables
+void platform_cond_init(PlatformCond *cond);
+void platform_cond_destroy(PlatformCond *cond);
+void platform_cond_wait(PlatformCond *cond, PlatformMutex *mutex);
+// Returns false if the timeout expired before the condition was signalled
+bool platform_cond_timedwait(PlatformCond *cond, PlatformMutex *mutex,
+                             long timeout_ms);
+void platform_cond_signal(PlatformCond *cond);
+void platform_cond_broadcast(PlatformCond *cond);
+
+// Time
+double platform_monotonic_ms(void);
+double platform_wall_ms(void); // Milliseconds since the Unix epoch
+void platform_sleep_ms(long ms);
+
+// Output
+// Write all of data to a file descriptor, retrying short writes
+bool platform_write(int fd, const void *data, size_t length);
+// Open path for appending, creating it if needed. Returns the descriptor and
+// sets size to the current file length, or returns -1.
+int platform_open_append(const char *path, long long *size);
+// Flush written data to the storage device
+bool platform_sync(int fd);
+void platform_close(int fd);
+
+// Memory-mapped files
+// Map path, creating it when writable. Returns false if it cannot be opened.
+bool platform_map_open(PlatformMap *map, const char *path, bool writable);
+// Grow or shrink a writable mapping's file to size bytes and map it again;
+// data may move
+bool platform_map_resize(PlatformMap *map, size_t size);
+// Flush modified pages of a writable mapping to the file
+bool platform_map_sync(PlatformMap *map);
+void platform_map_close(PlatformMap *map);
+
+// Sockets
+// Load the socket library; call before any other socket function
+bool platform_socket_startup(void);
+void platform_socket_close(PlatformSocket socket);
+bool platform_socket_set_nonblocking(PlatformSocket socket);
+// Whether the last socket call failed only because it would have blocked
+bool platform_socket_would_block(void);
+// poll() over sockets; returns the number ready, 0 on timeout, -1 on error
+int platform_poll(PlatformPollFd *fds, int count, int timeout_ms);
+// send() that never raises SIGPIPE; returns bytes sent or -1
+long platform_send(PlatformSocket socket, const void *data, size_t length);
+// recv(); returns bytes received, 0 once the peer closed, or -1
+long platform_recv(PlatformSocket socket, void *data, size_t length);
+// Start connecting a non-blocking socket to an IPv4 address; false if it
+// failed at once. Completion is signalled by poll() reporting it writable.
+bool platform_socket_connect(PlatformSocket socket, const char *ip, int port);
+// Pending error of a socket (SO_ERROR), 0 once a connect has succeeded
+int platform_socket_error(PlatformSocket socket);
+// Whether a platform_socket_error() means the peer refused the connection
+bool platform_connect_refused(int error);
+// Dotted IPv4 address of a host name or address
+bool platform_resolve_ipv4(const char *host, char *ip, size_t size);
+
+// Terminal
+// Whether stdout is a terminal that takes ANSI escape sequences, enabling
+// them on Windows consoles that need it
+bool platform_terminal_ansi(void);
+// Visible size of the stdout terminal; false if it is not a terminal
+bool platform_terminal_size(int *rows, int *columns);
+
+#endif // FOCAS_PLATFORM_H
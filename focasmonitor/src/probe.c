@@ -0,0 +1,157 @@
+#include "focasmonitor.h"
+
+#include <stdlib.h>
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+// TCP reachability of the machines' FOCAS ports. A non-blocking connect is
+// started to every machine at once and poll() waits for them together, so a
+// whole floor is checked in about one round trip; unreachable machines cost
+// PROBE_TIMEOUT_MS in total, not each. The connection is closed as soon as it
+// is established, before any FOCAS traffic.
+//
+// cnc_allclibhndl3 holds its caller for the full connect timeout when a host
+// does not answer, so connects are gated on a recent probe having found the
+// port open (see connection_pool_connect_machine).
+//
+// WSAPoll on Windows before 10 version 2004 does not report refused connects;
+// they show up as timeouts there.
+
+#define PROBE_MAX_SOCKETS 256 // Connects in flight at once
+
+typedef struct {
+  MachineHandle *machine;
+  double started;
+} ProbeSlot;
+
+const char *probe_result_to_string(ProbeResult result) {
+  switch (result) {
+    case PROBE_OPEN:
+      return "open";
+    case PROBE_REFUSED:
+      return "refused";
+    case PROBE_TIMEOUT:
+      return "timeout";
+    case PROBE_UNREACHABLE:
+      return "unreachable";
+    default:
+      return "unknown";
+  }
+}
+
+// Start a connect to the machine's port. Returns PROBE_UNKNOWN with the
+// socket in *socket_out while it is pending, or the result if it is already
+// known.
+static ProbeResult probe_start(const MachineHandle *machine,
+                               PlatformSocket *socket_out) {
+  char ip[64];
+  if (!platform_resolve_ipv4(machine->ip, ip, sizeof(ip))) {
+    return PROBE_UNREACHABLE;
+  }
+  PlatformSocket sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (sock == PLATFORM_INVALID_SOCKET) {
+    return PROBE_UNREACHABLE;
+  }
+  if (!platform_socket_set_nonblocking(sock)
+      || !platform_socket_connect(sock, ip, machine->port)) {
+    platform_socket_close(sock);
+    return PROBE_UNREACHABLE;
+  }
+  *socket_out = sock;
+  return PROBE_UNKNOWN;
+}
+
+static void probe_finish(MachineHandle *machine, ProbeResult result,
+                         double rtt_ms) {
+  machine->probe = result;
+  machine->probe_rtt_ms = rtt_ms;
+}
+
+int network_probe(ConnectionPool *pool, const int *machine_ids, int count,
+                  int timeout_ms) {
+  int window = count < PROBE_MAX_SOCKETS ? count : PROBE_MAX_SOCKETS;
+  if (window <= 0) {
+    return 0;
+  }
+  PlatformPollFd *fds = malloc((size_t) window * sizeof(PlatformPollFd));
+  ProbeSlot *slots = malloc((size_t) window * sizeof(ProbeSlot));
+  if (!fds || !slots) {
+    free(fds);
+    free(slots);
+    return -1;
+  }
+
+  int next = 0;
+  int active = 0;
+  int open = 0;
+  while (next < count || active > 0) {
+    // Keep the window full
+    while (active < window && next < count) {
+      MachineHandle *machine = pool->machines[machine_ids[next++]];
+      double now = platform_monotonic_ms();
+      machine->probe_time_ms = now;
+      ProbeResult result = probe_start(machine, &fds[active].fd);
+      if (result != PROBE_UNKNOWN) {
+        probe_finish(machine, result, 0.0);
+        continue;
+      }
+      fds[active].events = POLLOUT;
+      fds[active].revents = 0;
+      slots[active].machine = machine;
+      slots[active].started = now;
+      active++;
+    }
+    if (active == 0) {
+      break;
+    }
+
+    // Sleep until a connect completes or the oldest one times out
+    double oldest = slots[0].started;
+    for (int i = 1; i < active; i++) {
+      oldest = slots[i].started < oldest ? slots[i].started : oldest;
+    }
+    double wait = oldest + timeout_ms - platform_monotonic_ms();
+    if (platform_poll(fds, active, wait > 0 ? (int) wait + 1 : 0) < 0) {
+      for (int i = 0; i < active; i++) {
+        platform_socket_close(fds[i].fd);
+        probe_finish(slots[i].machine, PROBE_UNREACHABLE, 0.0);
+      }
+      break;
+    }
+
+    double now = platform_monotonic_ms();
+    for (int i = 0; i < active;) {
+      ProbeResult result = PROBE_UNKNOWN;
+      if (fds[i].revents != 0) {
+        int error = platform_socket_error(fds[i].fd);
+        if (error == 0) {
+          result = PROBE_OPEN;
+        } else if (platform_connect_refused(error)) {
+          result = PROBE_REFUSED;
+        } else {
+          result = PROBE_UNREACHABLE;
+        }
+      } else if (now - slots[i].started >= timeout_ms) {
+        result = PROBE_TIMEOUT;
+      }
+      if (result == PROBE_UNKNOWN) {
+        i++;
+        continue;
+      }
+
+      platform_socket_close(fds[i].fd);
+      probe_finish(slots[i].machine, result, now - slots[i].started);
+      open += result == PROBE_OPEN ? 1 : 0;
+      // Fill the hole with the last pending connect
+      active--;
+      fds[i] = fds[active];
+      slots[i] = slots[active];
+    }
+  }
+
+  free(fds);
+  free(slots);
+  return open;
+}
@@ -0,0 +1,166 @@
+#include "focasmonitor.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fwlib32.h"
+
+// Deadline scheduler for monitor mode. Every machine has one entry in a binary
+// min-heap keyed by the time its next read is due; each pass takes the due
+// machines off the heap, reads them and pushes them back with an interval
+// chosen from the state the read left them in. Cutting machines are polled
+// fast while idle and unreachable controllers are left alone for longer, at
+// least until their circuit breaker admits another attempt.
+
+static void heap_swap(ScheduleEntry *a, ScheduleEntry *b) {
+  ScheduleEntry tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+static void heap_push(Scheduler *scheduler, double due_ms, int machine_id) {
+  int i = scheduler->heap_count++;
+  scheduler->heap[i].due_ms = due_ms;
+  scheduler->heap[i].machine_id = machine_id;
+
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (scheduler->heap[parent].due_ms <= scheduler->heap[i].due_ms) {
+      break;
+    }
+    heap_swap(&scheduler->heap[parent], &scheduler->heap[i]);
+    i = parent;
+  }
+}
+
+static ScheduleEntry heap_pop(Scheduler *scheduler) {
+  ScheduleEntry top = scheduler->heap[0];
+  scheduler->heap[0] = scheduler->heap[--scheduler->heap_count];
+
+  int i = 0;
+  while (true) {
+    int left = 2 * i + 1;
+    int right = left + 1;
+    int smallest = i;
+    if (left < scheduler->heap_count
+        && scheduler->heap[left].due_ms < scheduler->heap[smallest].due_ms) {
+      smallest = left;
+    }
+    if (right < scheduler->heap_count
+        && scheduler->heap[right].due_ms < scheduler->heap[smallest].due_ms) {
+      smallest = right;
+    }
+    if (smallest == i) {
+      break;
+    }
+    heap_swap(&scheduler->heap[i], &scheduler->heap[smallest]);
+    i = smallest;
+  }
+
+  return top;
+}
+
+void scheduler_init(Scheduler *scheduler, int active_ms, int idle_ms,
+                    int offline_ms) {
+  memset(scheduler, 0, sizeof(Scheduler));
+  scheduler->interval_ms[POLL_ACTIVE] = active_ms;
+  scheduler->interval_ms[POLL_IDLE] = idle_ms;
+  scheduler->interval_ms[POLL_OFFLINE] = offline_ms;
+}
+
+void scheduler_free(Scheduler *scheduler) {
+  if (!scheduler) {
+    return;
+  }
+
+  free(scheduler->heap);
+  free(scheduler->due_ids);
+  memset(scheduler, 0, sizeof(Scheduler));
+}
+
+// Add machines registered since the last call, due immediately. Returns false
+// on allocation failure.
+bool scheduler_sync(Scheduler *scheduler, const ConnectionPool *pool,
+                    double now_ms) {
+  if (pool->machine_count > scheduler->capacity) {
+    int capacity = scheduler->capacity > 0 ? scheduler->capacity
+                                           : INITIAL_MACHINE_CAPACITY;
+    while (capacity < pool->machine_count) {
+      capacity *= 2;
+    }
+
+    ScheduleEntry *heap =
+        realloc(scheduler->heap, (size_t) capacity * sizeof(ScheduleEntry));
+    if (!heap) {
+      return false;
+    }
+    scheduler->heap = heap;
+
+    int *due_ids = realloc(scheduler->due_ids, (size_t) capacity * sizeof(int));
+    if (!due_ids) {
+      return false;
+    }
+    scheduler->due_ids = due_ids;
+    scheduler->capacity = capacity;
+  }
+
+  while (scheduler->tracked_count < pool->machine_count) {
+    heap_push(scheduler, now_ms, scheduler->tracked_count++);
+  }
+  return true;
+}
+
+// Take every machine due at now_ms off the heap. The ids stay valid until the
+// next call and are handed back with scheduler_complete().
+int scheduler_take_due(Scheduler *scheduler, double now_ms,
+                       const int **machine_ids) {
+  int count = 0;
+  while (scheduler->heap_count > 0 && scheduler->heap[0].due_ms <= now_ms) {
+    scheduler->due_ids[count++] = heap_pop(scheduler).machine_id;
+  }
+  scheduler->due_count = count;
+  *machine_ids = scheduler->due_ids;
+  return count;
+}
+
+// Polling class from the last published read (caller holds the pool lock)
+static PollClass classify_machine(const MachineHandle *machine) {
+  if (!machine->info_valid || machine->last_result != FOCAS_OK) {
+    return POLL_OFFLINE;
+  }
+
+  const MachineInfo *info = &machine->last_info;
+  if (strncmp(info->status, "RUNNING", 7) == 0
+      || strncmp(info->status, "ALARM", 5) == 0 || info->alarm.has_alarm) {
+    return POLL_ACTIVE;
+  }
+  return POLL_IDLE;
+}
+
+// Reschedule the machines of the last scheduler_take_due() from the state
+// their reads left them in. A machine still being read after a cycle deadline
+// is classified from its previous result.
+void scheduler_complete(Scheduler *scheduler, ConnectionPool *pool,
+                        double now_ms) {
+  platform_mutex_lock(&pool->lock);
+  for (int i = 0; i < scheduler->due_count; i++) {
+    int machine_id = scheduler->due_ids[i];
+    const MachineHandle *machine = pool->machines[machine_id];
+    const CircuitBreaker *breaker = &machine->breaker;
+    double due_ms = now_ms + scheduler->interval_ms[classify_machine(machine)];
+    // A busy control is asked again as soon as its breaker allows; otherwise
+    // nothing is due before an open breaker's backoff has passed
+    if (breaker->state == BREAKER_OPEN
+        && (breaker->last_error == EW_BUSY || breaker->retry_at_ms > due_ms)) {
+      due_ms = breaker->retry_at_ms;
+    }
+    heap_push(scheduler, due_ms, machine_id);
+  }
+  platform_mutex_unlock(&pool->lock);
+  scheduler->due_count = 0;
+}
+
+// Time the next machine is due, or now_ms when nothing is scheduled
+double scheduler_next_due(const Scheduler *scheduler, double now_ms) {
+  return scheduler->heap_count > 0 ? scheduler->heap[0].due_ms : now_ms;
+}
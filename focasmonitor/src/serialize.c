@@ -0,0 +1,414 @@
+#include "focasmonitor.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// JSON and CSV serialization into a growable byte buffer. A whole document is
+// formatted in memory with hand-rolled integer and fixed-point conversion and
+// then handed to the kernel in one write, instead of dozens of printf calls
+// per machine. Buffers are reset rather than freed between documents, so
+// steady-state output allocates nothing.
+
+void output_buffer_init(OutputBuffer *buffer) {
+  memset(buffer, 0, sizeof(OutputBuffer));
+}
+
+void output_buffer_free(OutputBuffer *buffer) {
+  if (!buffer) {
+    return;
+  }
+
+  free(buffer->data);
+  memset(buffer, 0, sizeof(OutputBuffer));
+}
+
+void output_buffer_reset(OutputBuffer *buffer) {
+  buffer->length = 0;
+  buffer->failed = false;
+}
+
+// Make room for extra more bytes. On allocation failure the buffer is marked
+// failed and further appends are dropped.
+static bool output_buffer_reserve(OutputBuffer *buffer, size_t extra) {
+  if (buffer->failed) {
+    return false;
+  }
+  if (buffer->length + extra <= buffer->capacity) {
+    return true;
+  }
+
+  // Past half the address space doubling would wrap
+  if (extra > SIZE_MAX / 2 - buffer->length) {
+    buffer->failed = true;
+    return false;
+  }
+  size_t capacity = buffer->capacity > 0 ? buffer->capacity : 4096;
+  while (capacity < buffer->length + extra) {
+    capacity *= 2;
+  }
+  char *data = realloc(buffer->data, capacity);
+  if (!data) {
+    buffer->failed = true;
+    return false;
+  }
+  buffer->data = data;
+  buffer->capacity = capacity;
+  return true;
+}
+
+void output_buffer_append(OutputBuffer *buffer, const char *data,
+                          size_t length) {
+  if (output_buffer_reserve(buffer, length)) {
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+  }
+}
+
+void output_buffer_puts(OutputBuffer *buffer, const char *text) {
+  output_buffer_append(buffer, text, strlen(text));
+}
+
+void output_buffer_char(OutputBuffer *buffer, char c) {
+  if (output_buffer_reserve(buffer, 1)) {
+    buffer->data[buffer->length++] = c;
+  }
+}
+
+void output_buffer_llong(OutputBuffer *buffer, long long value) {
+  char digits[24];
+  int pos = sizeof(digits);
+  // Negate in unsigned arithmetic so LLONG_MIN converts too
+  unsigned long long magnitude = value < 0 ? 0ull - (unsigned long long) value
+                                           : (unsigned long long) value;
+
+  do {
+    digits[--pos] = (char) ('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude > 0);
+  if (value < 0) {
+    digits[--pos] = '-';
+  }
+  output_buffer_append(buffer, digits + pos, sizeof(digits) - (size_t) pos);
+}
+
+void output_buffer_long(OutputBuffer *buffer, long value) {
+  output_buffer_llong(buffer, value);
+}
+
+// Same text as printf("%.*f"). Values whose scaled form lies within rounding
+// error of a half, is too large, or is not finite go through snprintf, so the
+// fast path never rounds differently from the C library.
+void output_buffer_fixed(OutputBuffer *buffer, double value, int decimals) {
+  static const double scales[] = {1.0, 10.0, 100.0, 1e3, 1e4, 1e5, 1e6};
+  double scaled = decimals >= 0 && decimals <= 6
+                      ? fabs(value) * scales[decimals]
+                      : HUGE_VAL;
+  // Below 2^32 the product is exact to within 1e-6
+  if (!(scaled < 4294967296.0)
+      || fabs(scaled - floor(scaled) - 0.5) < 1e-6) {
+    char text[350];
+    int length = snprintf(text, sizeof(text), "%.*f", decimals, value);
+    if (length > 0 && (size_t) length < sizeof(text)) {
+      output_buffer_append(buffer, text, (size_t) length);
+    }
+    return;
+  }
+
+  long long rounded = llround(scaled);
+  long long unit = (long long) scales[decimals];
+  if (signbit(value)) {
+    output_buffer_char(buffer, '-');
+  }
+  output_buffer_llong(buffer, rounded / unit);
+  if (decimals > 0) {
+    char fraction[8];
+    long long rest = rounded % unit;
+    for (int i = decimals - 1; i >= 0; i--) {
+      fraction[i] = (char) ('0' + rest % 10);
+      rest /= 10;
+    }
+    output_buffer_char(buffer, '.');
+    output_buffer_append(buffer, fraction, (size_t) decimals);
+  }
+}
+
+// A JSON string literal; quotes, backslashes and control characters are
+// escaped
+void output_buffer_json_string(OutputBuffer *buffer, const char *text) {
+  static const char hex[] = "0123456789abcdef";
+  output_buffer_char(buffer, '"');
+  for (const char *c = text; *c; c++) {
+    unsigned char ch = (unsigned char) *c;
+    if (ch == '"' || ch == '\\') {
+      output_buffer_char(buffer, '\\');
+      output_buffer_char(buffer, (char) ch);
+    } else if (ch < 0x20) {
+      char escape[6] = {'\\', 'u', '0', '0', hex[ch >> 4], hex[ch & 0xf]};
+      output_buffer_append(buffer, escape, sizeof(escape));
+    } else {
+      output_buffer_char(buffer, (char) ch);
+    }
+  }
+  output_buffer_char(buffer, '"');
+}
+
+// Writes the buffer to fd. stdout is flushed first so the document lands after
+// anything already printed through stdio.
+bool output_buffer_write(const OutputBuffer *buffer, int fd) {
+  if (buffer->failed) {
+    return false;
+  }
+  if (fd == 1) {
+    fflush(stdout);
+  }
+  return platform_write(fd, buffer->data, buffer->length);
+}
+
+// Name a machine is published under in snapshot output. It follows the pool
+// machine id, so it stays the same while other machines drop out.
+void serialize_machine_name(OutputBuffer *buffer, int machine_id) {
+  output_buffer_puts(buffer, "Machine_");
+  output_buffer_long(buffer, machine_id + 1);
+}
+
+static void serialize_json_field(OutputBuffer *buffer, const char *key) {
+  output_buffer_puts(buffer, "      \"");
+  output_buffer_puts(buffer, key);
+  output_buffer_puts(buffer, "\": ");
+}
+
+static void serialize_bool(OutputBuffer *buffer, bool value) {
+  output_buffer_puts(buffer, value ? "true" : "false");
+}
+
+// Only the groups the acquisition plan requested are emitted. The name is
+// written by serialize_machine_name when machine_id is not negative.
+void serialize_machine_info_json(OutputBuffer *buffer, const MachineInfo *info,
+                                 const char *machine_name, int machine_id) {
+  output_buffer_puts(buffer, "    {\n");
+  serialize_json_field(buffer, "name");
+  if (machine_id >= 0) {
+    output_buffer_char(buffer, '"');
+    serialize_machine_name(buffer, machine_id);
+    output_buffer_char(buffer, '"');
+  } else {
+    output_buffer_json_string(buffer, machine_name);
+  }
+  output_buffer_puts(buffer, ",\n");
+  if (info->fields & ACQ_ID) {
+    serialize_json_field(buffer, "machine_id");
+    output_buffer_json_string(buffer, info->machine_id);
+    output_buffer_puts(buffer, ",\n");
+  }
+  if (info->fields & ACQ_PROGRAM) {
+    serialize_json_field(buffer, "program_name");
+    output_buffer_json_string(buffer, info->program_name);
+    output_buffer_puts(buffer, ",\n");
+    serialize_json_field(buffer, "program_number");
+    output_buffer_long(buffer, info->program_number);
+    output_buffer_puts(buffer, ",\n");
+  }
+  if (info->fields & ACQ_STATUS) {
+    serialize_json_field(buffer, "status");
+    output_buffer_json_string(buffer, info->status);
+    output_buffer_puts(buffer, ",\n");
+  }
+  if (info->fields & ACQ_SEQUENCE) {
+    serialize_json_field(buffer, "sequence_number");
+    output_buffer_long(buffer, info->sequence_number);
+    output_buffer_puts(buffer, ",\n");
+  }
+  if (info->fields & ACQ_POSITION) {
+    serialize_json_field(buffer, "position");
+    output_buffer_char(buffer, '[');
+    for (int i = 0; i < info->position.axis_count; i++) {
+      const AxisPosition *axis = &info->position.axes[i];
+      output_buffer_puts(buffer, i > 0 ? ",\n        {\"axis\": "
+                                       : "\n        {\"axis\": ");
+      output_buffer_json_string(buffer, axis->name);
+      output_buffer_puts(buffer, ", \"absolute\": ");
+      output_buffer_fixed(buffer, axis->absolute, 3);
+      output_buffer_puts(buffer, ", \"relative\": ");
+      output_buffer_fixed(buffer, axis->relative, 3);
+      output_buffer_puts(buffer, ", \"machine\": ");
+      output_buffer_fixed(buffer, axis->machine, 3);
+      output_buffer_puts(buffer, ", \"distance\": ");
+      output_buffer_fixed(buffer, axis->distance, 3);
+      output_buffer_char(buffer, '}');
+    }
+    output_buffer_puts(buffer,
+                       info->position.axis_count > 0 ? "\n      ],\n" : "],\n");
+  }
+  if (info->fields & ACQ_SPEED) {
+    output_buffer_puts(buffer, "      \"speed\": {\n        \"feed_rate\": ");
+    output_buffer_long(buffer, info->speed.feed_rate);
+    output_buffer_puts(buffer, ",\n        \"spindle_speed\": ");
+    output_buffer_long(buffer, info->speed.spindle_speed);
+    output_buffer_puts(buffer, "\n      },\n");
+  }
+  if (info->fields & ACQ_ALARM) {
+    output_buffer_puts(buffer, "      \"alarm\": {\n        \"has_alarm\": ");
+    serialize_bool(buffer, info->alarm.has_alarm);
+    output_buffer_puts(buffer, ",\n        \"alarm_status\": ");
+    output_buffer_long(buffer, info->alarm.alarm_status);
+    output_buffer_puts(buffer, "\n      },\n");
+  }
+  serialize_json_field(buffer, "latency");
+  output_buffer_char(buffer, '{');
+  bool first = true;
+  for (int f = 0; f < FOCAS_FN_COUNT; f++) {
+    const LatencySummary *latency = &info->latency[f];
+    if (latency->count == 0) {
+      continue;
+    }
+    output_buffer_puts(buffer, first ? "\n        \"" : ",\n        \"");
+    output_buffer_puts(buffer, focas_function_name((FocasFunction) f));
+    output_buffer_puts(buffer, "\": {\"calls\": ");
+    output_buffer_long(buffer, (long) latency->count);
+    output_buffer_puts(buffer, ", \"errors\": ");
+    output_buffer_long(buffer, (long) latency->errors);
+    output_buffer_puts(buffer, ", \"p50_ms\": ");
+    output_buffer_fixed(buffer, latency->p50_ms, 3);
+    output_buffer_puts(buffer, ", \"p90_ms\": ");
+    output_buffer_fixed(buffer, latency->p90_ms, 3);
+    output_buffer_puts(buffer, ", \"p99_ms\": ");
+    output_buffer_fixed(buffer, latency->p99_ms, 3);
+    output_buffer_puts(buffer, ", \"max_ms\": ");
+    output_buffer_fixed(buffer, latency->max_ms, 3);
+    output_buffer_char(buffer, '}');
+    first = false;
+  }
+  output_buffer_puts(buffer, first ? "},\n" : "\n      },\n");
+  serialize_json_field(buffer, "last_updated");
+  output_buffer_long(buffer, (long) info->last_updated);
+  output_buffer_puts(buffer, ",\n");
+  serialize_json_field(buffer, "late");
+  serialize_bool(buffer, info->late);
+  output_buffer_puts(buffer, "\n    }");
+}
+
+void serialize_csv_header(OutputBuffer *buffer) {
+  output_buffer_puts(buffer,
+                     "machine_name,machine_id,program_name,program_number,"
+                     "status,sequence_number,absolute,relative,feed_rate,"
+                     "spindle_speed,has_alarm,alarm_status,last_updated,"
+                     "late\n");
+}
+
+// Axis count varies by machine, so each position type is one column of space
+// separated NAME=value pairs
+static void serialize_csv_axes(OutputBuffer *buffer, const MachineInfo *info,
+                               bool relative) {
+  for (int i = 0; i < info->position.axis_count; i++) {
+    const AxisPosition *axis = &info->position.axes[i];
+    if (i > 0) {
+      output_buffer_char(buffer, ' ');
+    }
+    output_buffer_puts(buffer, axis->name);
+    output_buffer_char(buffer, '=');
+    output_buffer_fixed(buffer, relative ? axis->relative : axis->absolute, 3);
+  }
+  output_buffer_char(buffer, ',');
+}
+
+// The column set is fixed; groups outside the acquisition plan are left
+// empty. The name is written by serialize_machine_name when machine_id is not
+// negative.
+void serialize_machine_info_csv(OutputBuffer *buffer, const MachineInfo *info,
+                                const char *machine_name, int machine_id) {
+  if (machine_id >= 0) {
+    serialize_machine_name(buffer, machine_id);
+  } else {
+    output_buffer_puts(buffer, machine_name);
+  }
+  output_buffer_char(buffer, ',');
+  if (info->fields & ACQ_ID) {
+    output_buffer_puts(buffer, info->machine_id);
+  }
+  if (info->fields & ACQ_PROGRAM) {
+    output_buffer_char(buffer, ',');
+    output_buffer_puts(buffer, info->program_name);
+    output_buffer_char(buffer, ',');
+    output_buffer_long(buffer, info->program_number);
+    output_buffer_char(buffer, ',');
+  } else {
+    output_buffer_puts(buffer, ",,,");
+  }
+  if (info->fields & ACQ_STATUS) {
+    output_buffer_puts(buffer, info->status);
+  }
+  if (info->fields & ACQ_SEQUENCE) {
+    output_buffer_char(buffer, ',');
+    output_buffer_long(buffer, info->sequence_number);
+    output_buffer_char(buffer, ',');
+  } else {
+    output_buffer_puts(buffer, ",,");
+  }
+  if (info->fields & ACQ_POSITION) {
+    serialize_csv_axes(buffer, info, false);
+    serialize_csv_axes(buffer, info, true);
+  } else {
+    output_buffer_puts(buffer, ",,");
+  }
+  if (info->fields & ACQ_SPEED) {
+    output_buffer_long(buffer, info->speed.feed_rate);
+    output_buffer_char(buffer, ',');
+    output_buffer_long(buffer, info->speed.spindle_speed);
+    output_buffer_char(buffer, ',');
+  } else {
+    output_buffer_puts(buffer, ",,");
+  }
+  if (info->fields & ACQ_ALARM) {
+    serialize_bool(buffer, info->alarm.has_alarm);
+    output_buffer_char(buffer, ',');
+    output_buffer_long(buffer, info->alarm.alarm_status);
+    output_buffer_char(buffer, ',');
+  } else {
+    output_buffer_puts(buffer, ",,");
+  }
+  output_buffer_long(buffer, (long) info->last_updated);
+  output_buffer_char(buffer, ',');
+  serialize_bool(buffer, info->late);
+  output_buffer_char(buffer, '\n');
+}
+
+// Opening of a snapshot JSON document, up to the machines array
+void serialize_json_header(OutputBuffer *buffer,
+                           const MultiMachineInfo *multi_info) {
+  output_buffer_puts(buffer, "{\n  \"collection_time\": ");
+  output_buffer_long(buffer, (long) multi_info->collection_time);
+  output_buffer_puts(buffer, ",\n  \"machine_count\": ");
+  output_buffer_long(buffer, multi_info->machine_count);
+  output_buffer_puts(buffer, ",\n  \"successful_reads\": ");
+  output_buffer_long(buffer, multi_info->successful_reads);
+  output_buffer_puts(buffer, ",\n  \"failed_reads\": ");
+  output_buffer_long(buffer, multi_info->failed_reads);
+  output_buffer_puts(buffer, ",\n  \"late_reads\": ");
+  output_buffer_long(buffer, multi_info->late_reads);
+  output_buffer_puts(buffer, ",\n  \"machines\": [\n");
+}
+
+// A whole snapshot as one JSON document or CSV table
+void serialize_multi_machine_info(OutputBuffer *buffer,
+                                  const MultiMachineInfo *multi_info,
+                                  OutputFormat format) {
+  if (format == OUTPUT_JSON) {
+    serialize_json_header(buffer, multi_info);
+    for (int i = 0; i < multi_info->machine_count; i++) {
+      serialize_machine_info_json(buffer, &multi_info->machines[i], NULL,
+                                  multi_info->machine_ids[i]);
+      output_buffer_puts(buffer,
+                         i < multi_info->machine_count - 1 ? ",\n" : "\n");
+    }
+    output_buffer_puts(buffer, "  ]\n}\n");
+  } else if (format == OUTPUT_CSV) {
+    serialize_csv_header(buffer);
+    for (int i = 0; i < multi_info->machine_count; i++) {
+      serialize_machine_info_csv(buffer, &multi_info->machines[i], NULL,
+                                 multi_info->machine_ids[i]);
+    }
+  }
+}
@@ -0,0 +1,423 @@
+#include "focasmonitor.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Console view for monitor mode. Each cycle is laid out as a grid of cells
+// the size of the terminal and compared with the grid already on screen;
+// only the span of each row that differs is rewritten, placed with ANSI
+// cursor addressing, and the whole update goes out in one write. A quiet
+// floor costs a few bytes per cycle and nothing is spawned or cleared, so the
+// screen does not flicker.
+//
+// Anything else printed to stdout scrolls the screen out from under the
+// grid, so it is repainted in full every TERMINAL_REPAINT_FRAMES frames and
+// whenever the terminal is resized. When stdout is not a terminal the caller
+// prints the plain console table instead.
+
+#define TERMINAL_REPAINT_FRAMES 30
+#define TERMINAL_MAX_COLUMNS 512
+#define TERMINAL_MAX_ROWS 1000
+#define TERMINAL_HEADER_ROWS 5 // Title, summary, blank, heading, rule
+
+// Status classes, in the order --sort=status lists them
+typedef enum {
+  TERMINAL_ALARM = 0,
+  TERMINAL_OFFLINE = 1, // No fresh data: unreachable or the read failed
+  TERMINAL_PAUSED = 2,
+  TERMINAL_RUNNING = 3,
+  TERMINAL_STOPPED = 4,
+  TERMINAL_UNKNOWN = 5, // Status not read or not recognized
+  TERMINAL_STATUS_COUNT
+} TerminalStatus;
+
+static const char *status_names[TERMINAL_STATUS_COUNT] = {
+    "alarm", "offline", "paused", "running", "stopped", "unknown"};
+
+typedef enum {
+  TERMINAL_SORT_POOL = 0, // Order of the machines file
+  TERMINAL_SORT_NAME = 1,
+  TERMINAL_SORT_STATUS = 2 // Alarms first, then by name
+} TerminalSort;
+
+static const char *sort_names[] = {"pool", "name", "status"};
+
+// Sort order by name, pool order when empty
+bool terminal_sort_parse(const char *sort, int *order) {
+  *order = TERMINAL_SORT_POOL;
+  for (int i = 0; i < 3; i++) {
+    if (strcmp(sort, sort_names[i]) == 0) {
+      *order = i;
+      return true;
+    }
+  }
+  return strlen(sort) == 0;
+}
+
+// Comma-separated status class names, all when empty
+bool terminal_filter_parse(const char *filter, unsigned *statuses) {
+  *statuses = 0;
+  const char *item = filter;
+  while (*item) {
+    size_t length = strcspn(item, ",");
+    int status = -1;
+    for (int i = 0; i < TERMINAL_STATUS_COUNT; i++) {
+      if (strlen(status_names[i]) == length
+          && strncmp(item, status_names[i], length) == 0) {
+        status = i;
+      }
+    }
+    if (status < 0) {
+      return false;
+    }
+    *statuses |= 1u << status;
+    item += length;
+    if (*item == ',') {
+      item++;
+    }
+  }
+  return true;
+}
+
+// sort and filter have been checked with the parse functions above
+void terminal_renderer_init(TerminalRenderer *renderer, const char *sort,
+                            const char *filter) {
+  memset(renderer, 0, sizeof(TerminalRenderer));
+  output_buffer_init(&renderer->output);
+  renderer->ansi = platform_terminal_ansi();
+  terminal_sort_parse(sort, &renderer->sort);
+  terminal_filter_parse(filter, &renderer->filter);
+}
+
+void terminal_renderer_free(TerminalRenderer *renderer) {
+  if (!renderer) {
+    return;
+  }
+
+  if (renderer->drawn) {
+    // Leave the cursor below the last frame, visible again
+    output_buffer_reset(&renderer->output);
+    char move[32];
+    snprintf(move, sizeof(move), "\x1b[%d;1H\n\x1b[?25h", renderer->rows);
+    output_buffer_puts(&renderer->output, move);
+    output_buffer_write(&renderer->output, 1);
+  }
+  free(renderer->screen);
+  free(renderer->frame);
+  free(renderer->lines);
+  output_buffer_free(&renderer->output);
+  memset(renderer, 0, sizeof(TerminalRenderer));
+}
+
+static TerminalStatus terminal_status(const MultiMachineInfo *multi_info,
+                                      int machine_id, int *entry) {
+  *entry = -1;
+  if (machine_id >= multi_info->tracked_count) {
+    return TERMINAL_OFFLINE;
+  }
+  *entry = multi_info->entry_index[machine_id];
+  MachineReadStatus read = multi_info->read_status[machine_id];
+  if (*entry < 0 || (read != READ_OK && read != READ_LATE)) {
+    return TERMINAL_OFFLINE;
+  }
+
+  const MachineInfo *info = &multi_info->machines[*entry];
+  if (info->alarm.has_alarm || info->run_status == 3) {
+    return TERMINAL_ALARM;
+  }
+  if (!(info->fields & ACQ_STATUS)) {
+    return TERMINAL_UNKNOWN;
+  }
+  switch (info->run_status) {
+    case 0:
+      return TERMINAL_STOPPED;
+    case 1:
+      return TERMINAL_RUNNING;
+    case 2:
+      return TERMINAL_PAUSED;
+    default:
+      return TERMINAL_UNKNOWN;
+  }
+}
+
+static int terminal_compare_name(const void *a, const void *b) {
+  const TerminalRow *left = a;
+  const TerminalRow *right = b;
+  int order = strcmp(left->name, right->name);
+  return order != 0 ? order : left->machine_id - right->machine_id;
+}
+
+static int terminal_compare_status(const void *a, const void *b) {
+  const TerminalRow *left = a;
+  const TerminalRow *right = b;
+  if (left->status != right->status) {
+    return left->status - right->status;
+  }
+  return terminal_compare_name(a, b);
+}
+
+// Lay out one row of the frame. Text past the last usable column is cut and
+// control characters are blanked so they cannot move the cursor.
+static void terminal_line(TerminalRenderer *renderer, int row,
+                          const char *format, ...) {
+  if (row >= renderer->rows) {
+    return;
+  }
+
+  char text[TERMINAL_MAX_COLUMNS + 1];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+
+  // The last column is left empty so a full row never wraps
+  char *cells = renderer->frame + (size_t) row * renderer->columns;
+  for (int i = 0; text[i] && i < renderer->columns - 1; i++) {
+    unsigned char c = (unsigned char) text[i];
+    cells[i] = c < 0x20 || c == 0x7f ? ' ' : (char) c;
+  }
+}
+
+static void terminal_machine_line(TerminalRenderer *renderer, int row,
+                                  const TerminalRow *line,
+                                  const ConnectionPool *pool,
+                                  const MultiMachineInfo *multi_info,
+                                  time_t now) {
+  const MachineHandle *machine =
+      connection_pool_get_machine(pool, line->machine_id);
+  if (line->entry < 0) {
+    terminal_line(renderer, row, "%-16.16s %-20s", machine->friendly_name,
+                  connection_state_to_string(machine->state));
+    return;
+  }
+
+  const MachineInfo *info = &multi_info->machines[line->entry];
+  char name[20];
+  snprintf(name, sizeof(name), "%.15s%s", machine->friendly_name,
+           info->late ? "*" : "");
+  char status[32] = "-";
+  if (line->status == TERMINAL_OFFLINE) {
+    strcpy(status, "OFFLINE");
+  } else if (info->fields & ACQ_STATUS) {
+    snprintf(status, sizeof(status), "%s", info->status);
+  }
+  char sequence[16] = "-";
+  if (info->fields & ACQ_SEQUENCE) {
+    snprintf(sequence, sizeof(sequence), "N%ld", info->sequence_number);
+  }
+  char feed[16] = "-";
+  char spindle[16] = "-";
+  if (info->fields & ACQ_SPEED) {
+    snprintf(feed, sizeof(feed), "%d", info->speed.feed_rate);
+    snprintf(spindle, sizeof(spindle), "%d", info->speed.spindle_speed);
+  }
+  char alarm[16] = "-";
+  if (info->fields & ACQ_ALARM) {
+    if (info->alarm.has_alarm) {
+      snprintf(alarm, sizeof(alarm), "ACTIVE %d", info->alarm.alarm_status);
+    } else {
+      strcpy(alarm, "none");
+    }
+  }
+
+  terminal_line(renderer, row,
+                "%-16s %-20.20s %-8.8s %-9s %8s %8s %-12s %lds", name, status,
+                (info->fields & ACQ_PROGRAM) ? info->program_name : "-",
+                sequence, feed, spindle, alarm,
+                (long) (now - info->last_updated));
+}
+
+// Size the grids to the terminal. A new size starts from an unknown screen.
+static bool terminal_resize(TerminalRenderer *renderer) {
+  int rows = 24;
+  int columns = 80;
+  platform_terminal_size(&rows, &columns);
+  rows = rows > TERMINAL_MAX_ROWS ? TERMINAL_MAX_ROWS : rows;
+  columns = columns > TERMINAL_MAX_COLUMNS ? TERMINAL_MAX_COLUMNS : columns;
+  if (renderer->screen && rows == renderer->rows
+      && columns == renderer->columns) {
+    return true;
+  }
+
+  size_t cells = (size_t) rows * (size_t) columns;
+  char *screen = realloc(renderer->screen, cells);
+  if (screen) {
+    renderer->screen = screen;
+  }
+  char *frame = realloc(renderer->frame, cells);
+  if (frame) {
+    renderer->frame = frame;
+  }
+  if (!screen || !frame) {
+    renderer->rows = 0; // Neither grid has a known size any more
+    renderer->columns = 0;
+    return false;
+  }
+  renderer->rows = rows;
+  renderer->columns = columns;
+  renderer->drawn = false;
+  return true;
+}
+
+// Machines to show, filtered and in display order
+static int terminal_select(TerminalRenderer *renderer,
+                           const ConnectionPool *pool,
+                           const MultiMachineInfo *multi_info) {
+  if (pool->machine_count > renderer->capacity) {
+    int capacity = renderer->capacity > 0 ? renderer->capacity
+                                          : INITIAL_MACHINE_CAPACITY;
+    while (capacity < pool->machine_count) {
+      capacity *= 2;
+    }
+    TerminalRow *lines =
+        realloc(renderer->lines, (size_t) capacity * sizeof(TerminalRow));
+    if (!lines) {
+      return -1;
+    }
+    renderer->lines = lines;
+    renderer->capacity = capacity;
+  }
+
+  int count = 0;
+  for (int id = 0; id < pool->machine_count; id++) {
+    const MachineHandle *machine = pool->machines[id];
+    if (!machine->enabled) {
+      continue;
+    }
+    TerminalRow *line = &renderer->lines[count];
+    line->machine_id = id;
+    line->status = (int) terminal_status(multi_info, id, &line->entry);
+    line->name = machine->friendly_name;
+    if (renderer->filter == 0 || (renderer->filter & (1u << line->status))) {
+      count++;
+    }
+  }
+
+  if (renderer->sort == TERMINAL_SORT_NAME) {
+    qsort(renderer->lines, (size_t) count, sizeof(TerminalRow),
+          terminal_compare_name);
+  } else if (renderer->sort == TERMINAL_SORT_STATUS) {
+    qsort(renderer->lines, (size_t) count, sizeof(TerminalRow),
+          terminal_compare_status);
+  }
+  return count;
+}
+
+static void terminal_move(OutputBuffer *output, int row, int column) {
+  char move[32];
+  snprintf(move, sizeof(move), "\x1b[%d;%dH", row + 1, column + 1);
+  output_buffer_puts(output, move);
+}
+
+// Draw the snapshot, rewriting only what changed on screen. Returns the
+// number of cells written, or -1 if the frame could not be allocated or
+// written.
+int terminal_renderer_draw(TerminalRenderer *renderer, ConnectionPool *pool,
+                           const MultiMachineInfo *multi_info) {
+  if (!terminal_resize(renderer)) {
+    return -1;
+  }
+  int count = terminal_select(renderer, pool, multi_info);
+  if (count < 0) {
+    return -1;
+  }
+
+  memset(renderer->frame, ' ',
+         (size_t) renderer->rows * (size_t) renderer->columns);
+  time_t now = time(NULL);
+  terminal_line(renderer, 0, "FOCAS Monitor - %s",
+                ctime(&multi_info->collection_time));
+  char filter[64] = "all";
+  if (renderer->filter != 0) {
+    filter[0] = '\0';
+    for (int i = 0; i < TERMINAL_STATUS_COUNT; i++) {
+      if (renderer->filter & (1u << i)) {
+        if (filter[0]) {
+          strcat(filter, ",");
+        }
+        strcat(filter, status_names[i]);
+      }
+    }
+  }
+  terminal_line(renderer, 1,
+                "Machines: %d shown of %d | %d successful, %d failed, %d late "
+                "| sort: %s | filter: %s",
+                count, pool->machine_count, multi_info->successful_reads,
+                multi_info->failed_reads, multi_info->late_reads,
+                sort_names[renderer->sort], filter);
+  terminal_line(renderer, 3, "%-16s %-20s %-8s %-9s %8s %8s %-12s %s",
+                "Machine", "Status", "Program", "Sequence", "Feed", "Spindle",
+                "Alarm", "Age");
+  terminal_line(renderer, 4, "%.*s", renderer->columns,
+                "-------------------------------------------------------------"
+                "---------------------------------------------");
+
+  // Machines that do not fit leave a note on the last row
+  int room = renderer->rows - TERMINAL_HEADER_ROWS;
+  // Unread machines show their connection state, which workers publish
+  int shown = count <= room ? count : room - 1;
+  platform_mutex_lock(&pool->lock);
+  for (int i = 0; i < shown; i++) {
+    terminal_machine_line(renderer, TERMINAL_HEADER_ROWS + i,
+                          &renderer->lines[i], pool, multi_info, now);
+  }
+  platform_mutex_unlock(&pool->lock);
+  if (shown >= 0 && shown < count) {
+    terminal_line(renderer, TERMINAL_HEADER_ROWS + shown,
+                  "... %d more machines, enlarge the window or use --filter",
+                  count - shown);
+  }
+
+  OutputBuffer *output = &renderer->output;
+  output_buffer_reset(output);
+  bool repaint = !renderer->drawn
+                 || renderer->frames >= TERMINAL_REPAINT_FRAMES;
+  if (repaint) {
+    // Hide the cursor and clear once; from here on cells are overwritten
+    output_buffer_puts(output, "\x1b[?25l\x1b[H\x1b[2J");
+    memset(renderer->screen, ' ',
+           (size_t) renderer->rows * (size_t) renderer->columns);
+    renderer->frames = 0;
+  }
+
+  int written = 0;
+  for (int row = 0; row < renderer->rows; row++) {
+    size_t offset = (size_t) row * (size_t) renderer->columns;
+    const char *now_cells = renderer->frame + offset;
+    const char *old_cells = renderer->screen + offset;
+    int first = 0;
+    while (first < renderer->columns && now_cells[first] == old_cells[first]) {
+      first++;
+    }
+    if (first == renderer->columns) {
+      continue;
+    }
+    int last = renderer->columns - 1;
+    while (now_cells[last] == old_cells[last]) {
+      last--;
+    }
+    terminal_move(output, row, first);
+    output_buffer_append(output, now_cells + first,
+                         (size_t) (last - first + 1));
+    written += last - first + 1;
+  }
+  if (output->length == 0) {
+    renderer->frames++;
+    return 0;
+  }
+  // Park the cursor on the last row, where stray output does least harm
+  terminal_move(output, renderer->rows - 1, 0);
+
+  if (output->failed || !output_buffer_write(output, 1)) {
+    renderer->drawn = false;
+    return -1;
+  }
+  char *screen = renderer->screen;
+  renderer->screen = renderer->frame;
+  renderer->frame = screen;
+  renderer->drawn = true;
+  renderer->frames++;
+  return written;
+}
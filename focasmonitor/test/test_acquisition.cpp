@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+extern "C" {
+  #include "focasmonitor.h"
+  #include "fwlib32.h"
+  #include "fake_focas.h"
+}
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PLAN (ACQ_USE_DYNAMIC2 | ACQ_DYNAMIC_GROUPS | ACQ_STATUS)
+
+class AcquisitionTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    if (handle) {
+      cnc_freelibhndl(handle);
+    }
+    if (script[0]) {
+      unlink(script);
+    }
+  }
+
+  // Load a one-line script for 10.0.0.1 and connect to it
+  void connect(const char *options) {
+    FakeFocasProfile profile;
+    memset(&profile, 0, sizeof(profile));
+    fake_focas_configure(&profile);
+
+    strcpy(script, "/tmp/test_acquisition_XXXXXX");
+    int fd = mkstemp(script);
+    ASSERT_GE(fd, 0);
+    FILE *file = fdopen(fd, "w");
+    ASSERT_NE(file, nullptr);
+    fprintf(file, "10.0.0.1 %s\n", options);
+    fclose(file);
+    ASSERT_TRUE(fake_focas_load_script(script));
+
+    ASSERT_EQ(cnc_allclibhndl3("10.0.0.1", 8193, 10, &handle), EW_OK);
+    memset(&identity, 0, sizeof(identity));
+    ASSERT_EQ(read_machine_identity(handle, &identity, NULL), FOCAS_OK);
+  }
+
+  char script[64] = "";
+  unsigned short handle = 0;
+  MachineIdentity identity;
+  MachineInfo info;
+};
+
+TEST_F(AcquisitionTest, RejectedDynamic2FallsBackToIndividualReads) {
+  connect("dynamic2=5");  // EW_DATA
+  EXPECT_EQ(read_machine_info_from_handle(handle, &identity, PLAN, &info, NULL),
+            FOCAS_OK);
+  EXPECT_TRUE(identity.no_dynamic2);
+  EXPECT_EQ(info.program_number, 1001) << "cnc_rdprgnum should fill it";
+  EXPECT_GE(info.run_status, 0) << "cnc_statinfo should fill it";
+
+  // Later reads go straight to the individual calls
+  EXPECT_EQ(read_machine_info_from_handle(handle, &identity, PLAN, &info, NULL),
+            FOCAS_OK);
+  EXPECT_EQ(info.program_number, 1001);
+}
+
+TEST_F(AcquisitionTest, UnsupportedDynamic2FallsBackToIndividualReads) {
+  connect("dynamic2=2");  // EW_LENGTH
+  EXPECT_EQ(read_machine_info_from_handle(handle, &identity, PLAN, &info, NULL),
+            FOCAS_OK);
+  EXPECT_TRUE(identity.no_dynamic2);
+}
+
+TEST_F(AcquisitionTest, TransportErrorFailsTheRead) {
+  connect("dynamic2=-16");  // EW_SOCKET
+  EXPECT_EQ(read_machine_info_from_handle(handle, &identity, PLAN, &info, NULL),
+            FOCAS_CONNECTION_FAILED);
+  EXPECT_FALSE(identity.no_dynamic2)
+      << "a lost connection says nothing about cnc_rddynamic2 support";
+}
+
+TEST_F(AcquisitionTest, Dynamic2IsUsedWhenAccepted) {
+  connect("state=running");
+  EXPECT_EQ(read_machine_info_from_handle(handle, &identity, PLAN, &info, NULL),
+            FOCAS_OK);
+  EXPECT_FALSE(identity.no_dynamic2);
+  EXPECT_EQ(info.program_number, 1001);
+}
+
+TEST_F(AcquisitionTest, LivenessCheckFindsDeadHandle) {
+  connect("drop-after=6");
+  // --fields=id is served from the identity and never reaches the control
+  for (int i = 0; i < 10; i++) {
+    ASSERT_EQ(read_machine_info_from_handle(handle, &identity, ACQ_ID, &info,
+                                            NULL),
+              FOCAS_OK);
+  }
+
+  FocasResult result = FOCAS_OK;
+  for (int i = 0; i < 10 && result == FOCAS_OK; i++) {
+    result = read_machine_info_from_handle(handle, &identity,
+                                           ACQ_ID | ACQ_LIVENESS, &info, NULL);
+    EXPECT_EQ(info.fields, (AcquisitionPlan) ACQ_ID);
+  }
+  EXPECT_EQ(result, FOCAS_CONNECTION_FAILED)
+      << "the liveness check should notice the connection is gone";
+}
+
+TEST_F(AcquisitionTest, LivenessCheckOnlyWhenNothingElseIsRead) {
+  connect("state=running");
+  LatencyLog log;
+  log.count = 0;
+  double before = identity.answered_ms;
+  EXPECT_EQ(read_machine_info_from_handle(handle, &identity,
+                                          ACQ_ID | ACQ_LIVENESS, &info, &log),
+            FOCAS_OK);
+  ASSERT_EQ(log.count, 1);
+  EXPECT_EQ(log.calls[0].function, FOCAS_FN_STATINFO);
+  EXPECT_GE(identity.answered_ms, before);
+
+  log.count = 0;
+  EXPECT_EQ(read_machine_info_from_handle(handle, &identity,
+                                          ACQ_PROGRAM | ACQ_LIVENESS, &info,
+                                          &log),
+            FOCAS_OK);
+  ASSERT_EQ(log.count, 1) << "a planned call already checks the handle";
+  EXPECT_EQ(log.calls[0].function, FOCAS_FN_RDPRGNUM);
+}
@@ -0,0 +1,93 @@
+#include "gtest/gtest.h"
+extern "C" {
+  #include "focasmonitor.h"
+  #include "fwlib32.h"
+}
+
+TEST(Breaker, StartsClosed) {
+  CircuitBreaker breaker;
+  breaker_init(&breaker, 7);
+
+  EXPECT_EQ(breaker.state, BREAKER_CLOSED);
+  EXPECT_EQ(breaker.failures, 0);
+  EXPECT_TRUE(breaker_admit(&breaker, 0.0)) << "closed breaker should admit";
+  EXPECT_STREQ(breaker_state_to_string(breaker.state), "closed");
+}
+
+TEST(Breaker, FailureOpensUntilBackoffPassed) {
+  CircuitBreaker breaker;
+  breaker_init(&breaker, 7);
+
+  double backoff = breaker_fail(&breaker, EW_SOCKET, 1000.0);
+  EXPECT_GE(backoff, BREAKER_BACKOFF_MS / 2.0);
+  EXPECT_LE(backoff, BREAKER_BACKOFF_MS);
+  EXPECT_EQ(breaker.state, BREAKER_OPEN);
+  EXPECT_EQ(breaker.failures, 1);
+  EXPECT_EQ(breaker.last_error, EW_SOCKET);
+  EXPECT_DOUBLE_EQ(breaker.retry_at_ms, 1000.0 + backoff);
+
+  EXPECT_FALSE(breaker_admit(&breaker, breaker.retry_at_ms - 1.0))
+      << "open breaker should skip attempts during its backoff";
+  EXPECT_EQ(breaker.state, BREAKER_OPEN);
+  EXPECT_TRUE(breaker_admit(&breaker, breaker.retry_at_ms))
+      << "open breaker should admit a trial after its backoff";
+  EXPECT_EQ(breaker.state, BREAKER_HALF_OPEN);
+}
+
+TEST(Breaker, BackoffDoublesUpToMax) {
+  CircuitBreaker breaker;
+  breaker_init(&breaker, 7);
+
+  double limit = BREAKER_BACKOFF_MS;
+  for (int i = 0; i < 12; i++) {
+    double backoff = breaker_fail(&breaker, EW_SOCKET, 0.0);
+    EXPECT_GE(backoff, limit / 2) << "failure " << i + 1;
+    EXPECT_LE(backoff, limit) << "failure " << i + 1;
+    limit = limit * 2 < BREAKER_MAX_BACKOFF_MS ? limit * 2
+                                               : BREAKER_MAX_BACKOFF_MS;
+  }
+  EXPECT_EQ(breaker.failures, 12);
+}
+
+TEST(Breaker, BusyBacksOffBriefly) {
+  CircuitBreaker breaker;
+  breaker_init(&breaker, 7);
+
+  double backoff = breaker_fail(&breaker, EW_BUSY, 0.0);
+  EXPECT_GE(backoff, BREAKER_BUSY_BACKOFF_MS / 2.0);
+  EXPECT_LE(backoff, BREAKER_BUSY_BACKOFF_MS);
+  EXPECT_EQ(breaker.last_error, EW_BUSY);
+}
+
+TEST(Breaker, SuccessCloses) {
+  CircuitBreaker breaker;
+  breaker_init(&breaker, 7);
+
+  breaker_fail(&breaker, EW_SOCKET, 0.0);
+  breaker_fail(&breaker, EW_SOCKET, 0.0);
+  breaker_succeed(&breaker);
+  EXPECT_EQ(breaker.state, BREAKER_CLOSED);
+  EXPECT_EQ(breaker.failures, 0);
+  EXPECT_EQ(breaker.last_error, EW_OK);
+
+  // The next failure starts from the base backoff again
+  double backoff = breaker_fail(&breaker, EW_SOCKET, 0.0);
+  EXPECT_LE(backoff, BREAKER_BACKOFF_MS);
+}
+
+TEST(Breaker, JitterSpreadsMachines) {
+  // Machines that fail together should not all retry at the same time
+  double first = 0.0;
+  bool spread = false;
+  for (unsigned int seed = 1; seed <= 8; seed++) {
+    CircuitBreaker breaker;
+    breaker_init(&breaker, seed);
+    double backoff = breaker_fail(&breaker, EW_SOCKET, 0.0);
+    if (seed == 1) {
+      first = backoff;
+    } else if (backoff != first) {
+      spread = true;
+    }
+  }
+  EXPECT_TRUE(spread) << "every seed gave the same backoff";
+}
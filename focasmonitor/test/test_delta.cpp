@@ -0,0 +1,148 @@
+#include "gtest/gtest.h"
+extern "C" {
+  #include "focasmonitor.h"
+}
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+class DeltaTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(&previous, 0, sizeof(previous));
+    previous.fields = ACQ_STATUS | ACQ_SPEED | ACQ_ALARM;
+    strcpy(previous.status, "RUNNING");
+    previous.speed.feed_rate = 1000;
+    previous.speed.spindle_speed = 3000;
+    current = previous;
+
+    delta_tracker_init(&tracker, 0);
+  }
+
+  void TearDown() override {
+    delta_tracker_free(&tracker);
+  }
+
+  // One cycle of JSON delta output for a snapshot holding the given pool
+  // machine ids, each with the info in current
+  std::string write_cycle(const std::vector<int> &ids) {
+    int tracked = 0;
+    for (int id : ids) {
+      tracked = std::max(tracked, id + 1);
+    }
+    std::vector<MachineInfo> machines(ids.size(), current);
+    std::vector<int> machine_ids(ids);
+    std::vector<int> entry_index(tracked, -1);
+    for (size_t i = 0; i < ids.size(); i++) {
+      entry_index[ids[i]] = (int) i;
+    }
+
+    MultiMachineInfo snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    snapshot.machine_count = (int) ids.size();
+    snapshot.machines = machines.data();
+    snapshot.machine_ids = machine_ids.data();
+    snapshot.tracked_count = tracked;
+    snapshot.capacity = tracked;
+    snapshot.entry_index = entry_index.data();
+
+    testing::internal::CaptureStdout();
+    written = print_multi_machine_delta(&tracker, &snapshot, "all",
+                                        OUTPUT_JSON);
+    return testing::internal::GetCapturedStdout();
+  }
+
+  MachineInfo previous;
+  MachineInfo current;
+  DeltaTracker tracker;
+  int written;
+};
+
+TEST_F(DeltaTest, UnchangedInfoHasNoChanges) {
+  current.last_updated = previous.last_updated + 10;
+  current.sampled_ms = previous.sampled_ms + 10.0;
+  current.latency[FOCAS_FN_STATINFO].count = 5;
+
+  EXPECT_EQ(machine_info_changes(&previous, &current), 0u)
+      << "timestamps and latency should not count as changes";
+}
+
+TEST_F(DeltaTest, ChangesNameOnlyDifferingGroups) {
+  current.speed.feed_rate = 500;
+  EXPECT_EQ(machine_info_changes(&previous, &current),
+            (AcquisitionPlan) ACQ_SPEED);
+
+  strcpy(current.status, "STOPPED");
+  current.alarm.has_alarm = 1;
+  EXPECT_EQ(machine_info_changes(&previous, &current),
+            (AcquisitionPlan) (ACQ_STATUS | ACQ_SPEED | ACQ_ALARM));
+}
+
+TEST_F(DeltaTest, NewGroupsCountAsChanged) {
+  current.fields |= ACQ_SEQUENCE;
+  EXPECT_EQ(machine_info_changes(&previous, &current),
+            (AcquisitionPlan) ACQ_SEQUENCE);
+}
+
+TEST_F(DeltaTest, GroupsNotReadAreIgnored) {
+  current.fields = ACQ_STATUS;
+  current.speed.feed_rate = 500;
+  EXPECT_EQ(machine_info_changes(&previous, &current), 0u);
+}
+
+TEST_F(DeltaTest, FirstCycleIsKeyframe) {
+  std::string output = write_cycle({0, 2});
+
+  EXPECT_EQ(written, 2);
+  EXPECT_NE(output.find("\"keyframe\": true"), std::string::npos);
+  EXPECT_NE(output.find("\"changed_count\": 2"), std::string::npos);
+  // Names follow the pool machine id, not the position in the snapshot
+  EXPECT_NE(output.find("Machine_1"), std::string::npos);
+  EXPECT_NE(output.find("Machine_3"), std::string::npos);
+  EXPECT_EQ(output.find("Machine_2"), std::string::npos);
+}
+
+TEST_F(DeltaTest, UnchangedMachinesAreSkipped) {
+  write_cycle({0, 1});
+  std::string output = write_cycle({0, 1});
+
+  EXPECT_EQ(written, 0);
+  EXPECT_NE(output.find("\"keyframe\": false"), std::string::npos);
+  EXPECT_NE(output.find("\"changed_count\": 0"), std::string::npos);
+
+  current.speed.spindle_speed = 0;
+  output = write_cycle({0, 1});
+  EXPECT_EQ(written, 2);
+  EXPECT_NE(output.find("\"spindle_speed\": 0"), std::string::npos);
+  EXPECT_EQ(output.find("\"status\""), std::string::npos)
+      << "unchanged groups should be left out";
+}
+
+TEST_F(DeltaTest, DroppedMachineWrittenOnceAsOffline) {
+  write_cycle({0, 2});
+
+  std::string output = write_cycle({0});
+  EXPECT_EQ(written, 1);
+  EXPECT_NE(output.find("\"changed_count\": 1"), std::string::npos);
+  EXPECT_NE(output.find("Machine_3"), std::string::npos);
+  EXPECT_NE(output.find("OFFLINE"), std::string::npos);
+
+  output = write_cycle({0});
+  EXPECT_EQ(written, 0);
+  EXPECT_EQ(output.find("Machine_3"), std::string::npos)
+      << "a dropped machine should be reported once";
+}
+
+TEST_F(DeltaTest, KeyframeInterval) {
+  delta_tracker_free(&tracker);
+  delta_tracker_init(&tracker, 2);
+
+  write_cycle({0});
+  std::string output = write_cycle({0});
+  EXPECT_NE(output.find("\"keyframe\": false"), std::string::npos);
+  output = write_cycle({0});
+  EXPECT_NE(output.find("\"keyframe\": true"), std::string::npos);
+  EXPECT_EQ(written, 1) << "keyframes should hold every machine";
+}
@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+extern "C" {
+  #include "focasmonitor.h"
+  #include "fwlib32.h"
+}
+
+#include <string.h>
+
+class LatencyTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    memset(&histogram, 0, sizeof(histogram));
+  }
+
+  LatencyHistogram histogram;
+  LatencySummary summary;
+};
+
+TEST_F(LatencyTest, EmptySummaryIsZero) {
+  latency_histogram_summarize(&histogram, &summary);
+
+  EXPECT_EQ(summary.count, 0u);
+  EXPECT_EQ(summary.p50_ms, 0.0);
+  EXPECT_EQ(summary.p99_ms, 0.0);
+  EXPECT_EQ(summary.max_ms, 0.0);
+}
+
+TEST_F(LatencyTest, PercentilesWithinBucketWidth) {
+  for (int ms = 1; ms <= 1000; ms++) {
+    latency_histogram_add(&histogram, ms, false);
+  }
+  latency_histogram_summarize(&histogram, &summary);
+
+  EXPECT_EQ(summary.count, 1000u);
+  EXPECT_EQ(summary.errors, 0u);
+  EXPECT_DOUBLE_EQ(summary.total_ms, 500500.0);
+  EXPECT_DOUBLE_EQ(summary.max_ms, 1000.0);
+
+  // Percentiles report a bucket limit, at most 25% above the true value
+  EXPECT_GE(summary.p50_ms, 500.0);
+  EXPECT_LE(summary.p50_ms, 500.0 * 1.25);
+  EXPECT_GE(summary.p90_ms, 900.0);
+  EXPECT_LE(summary.p90_ms, 1000.0);
+  EXPECT_GE(summary.p99_ms, 990.0);
+  EXPECT_LE(summary.p99_ms, 1000.0);
+}
+
+TEST_F(LatencyTest, PercentilesClampedToMax) {
+  latency_histogram_add(&histogram, 3.3, false);
+  latency_histogram_summarize(&histogram, &summary);
+
+  EXPECT_DOUBLE_EQ(summary.p50_ms, 3.3);
+  EXPECT_DOUBLE_EQ(summary.p99_ms, 3.3);
+  EXPECT_DOUBLE_EQ(summary.max_ms, 3.3);
+}
+
+TEST_F(LatencyTest, SubMicrosecondAndHugeCalls) {
+  latency_histogram_add(&histogram, 0.0, false);
+  latency_histogram_add(&histogram, 1e9, true);
+  latency_histogram_summarize(&histogram, &summary);
+
+  EXPECT_EQ(summary.count, 2u);
+  EXPECT_EQ(summary.errors, 1u);
+  EXPECT_LE(summary.p50_ms, 0.001);
+  EXPECT_DOUBLE_EQ(summary.max_ms, 1e9);
+}
+
+TEST_F(LatencyTest, MergeAddsCalls) {
+  LatencyHistogram other;
+  memset(&other, 0, sizeof(other));
+  latency_histogram_add(&histogram, 10.0, false);
+  latency_histogram_add(&other, 20.0, true);
+  latency_histogram_add(&other, 30.0, false);
+
+  latency_histogram_merge(&histogram, &other);
+  latency_histogram_summarize(&histogram, &summary);
+
+  EXPECT_EQ(summary.count, 3u);
+  EXPECT_EQ(summary.errors, 1u);
+  EXPECT_DOUBLE_EQ(summary.total_ms, 60.0);
+  EXPECT_DOUBLE_EQ(summary.max_ms, 30.0);
+  EXPECT_GE(summary.p50_ms, 20.0);
+  EXPECT_LE(summary.p50_ms, 25.0);
+}
+
+TEST_F(LatencyTest, LogMergesIntoFunctionHistograms) {
+  LatencyHistogram histograms[FOCAS_FN_COUNT];
+  memset(histograms, 0, sizeof(histograms));
+  LatencyLog log;
+  log.count = 0;
+
+  latency_log_add(&log, FOCAS_FN_STATINFO, platform_monotonic_ms(), EW_OK);
+  latency_log_add(&log, FOCAS_FN_STATINFO, platform_monotonic_ms(), EW_SOCKET);
+  latency_log_add(&log, FOCAS_FN_ALARM, platform_monotonic_ms(), EW_OK);
+  ASSERT_EQ(log.count, 3);
+
+  latency_log_merge(&log, histograms);
+  EXPECT_EQ(log.count, 0) << "merge should empty the log";
+  EXPECT_EQ(histograms[FOCAS_FN_STATINFO].count, 2u);
+  EXPECT_EQ(histograms[FOCAS_FN_STATINFO].errors, 1u);
+  EXPECT_EQ(histograms[FOCAS_FN_ALARM].count, 1u);
+  EXPECT_EQ(histograms[FOCAS_FN_RDSPEED].count, 0u);
+}
+
+TEST_F(LatencyTest, FullLogDropsCalls) {
+  LatencyLog log;
+  log.count = 0;
+  for (int i = 0; i < LATENCY_LOG_SIZE + 4; i++) {
+    latency_log_add(&log, FOCAS_FN_RDSPEED, platform_monotonic_ms(), EW_OK);
+  }
+  EXPECT_EQ(log.count, LATENCY_LOG_SIZE);
+
+  latency_log_add(NULL, FOCAS_FN_RDSPEED, platform_monotonic_ms(), EW_OK);
+}
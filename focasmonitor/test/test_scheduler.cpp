@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+extern "C" {
+  #include "focasmonitor.h"
+  #include "fwlib32.h"
+}
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#define ACTIVE_MS 100
+#define IDLE_MS 1000
+#define OFFLINE_MS 5000
+
+class SchedulerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(connection_pool_init(&pool), FOCAS_OK);
+    ASSERT_EQ(connection_pool_add_machine(&pool, "running", "127.0.0.1", 8193),
+              FOCAS_OK);
+    ASSERT_EQ(connection_pool_add_machine(&pool, "stopped", "127.0.0.2", 8193),
+              FOCAS_OK);
+    ASSERT_EQ(connection_pool_add_machine(&pool, "offline", "127.0.0.3", 8193),
+              FOCAS_OK);
+    scheduler_init(&scheduler, ACTIVE_MS, IDLE_MS, OFFLINE_MS);
+    ASSERT_TRUE(scheduler_sync(&scheduler, &pool, 0.0));
+  }
+
+  void TearDown() override {
+    scheduler_free(&scheduler);
+    connection_pool_cleanup(&pool);
+  }
+
+  // Publish a successful read with the given status
+  void publish(int machine_id, const char *status) {
+    MachineHandle *machine = pool.machines[machine_id];
+    machine->info_valid = true;
+    machine->last_result = FOCAS_OK;
+    strcpy(machine->last_info.status, status);
+  }
+
+  // Machines due at now_ms, in the order they were taken
+  std::vector<int> take_due(double now_ms) {
+    const int *ids;
+    int count = scheduler_take_due(&scheduler, now_ms, &ids);
+    return std::vector<int>(ids, ids + count);
+  }
+
+  ConnectionPool pool;
+  Scheduler scheduler;
+};
+
+TEST_F(SchedulerTest, NewMachinesAreDueImmediately) {
+  EXPECT_DOUBLE_EQ(scheduler_next_due(&scheduler, 50.0), 0.0);
+  EXPECT_EQ(take_due(0.0).size(), 3u);
+  EXPECT_TRUE(take_due(0.0).empty()) << "taken machines should leave the heap";
+  EXPECT_DOUBLE_EQ(scheduler_next_due(&scheduler, 50.0), 50.0)
+      << "an empty scheduler should be due now";
+}
+
+TEST_F(SchedulerTest, IntervalFollowsPollClass) {
+  publish(0, "RUNNING");
+  publish(1, "STOPPED");
+  pool.machines[2]->last_result = FOCAS_CONNECTION_FAILED;
+
+  take_due(0.0);
+  scheduler_complete(&scheduler, &pool, 0.0);
+
+  EXPECT_DOUBLE_EQ(scheduler_next_due(&scheduler, 0.0), ACTIVE_MS);
+  EXPECT_TRUE(take_due(ACTIVE_MS - 1).empty());
+  EXPECT_EQ(take_due(ACTIVE_MS), std::vector<int>({0}));
+  EXPECT_EQ(take_due(IDLE_MS), std::vector<int>({1}));
+  EXPECT_EQ(take_due(OFFLINE_MS), std::vector<int>({2}));
+}
+
+TEST_F(SchedulerTest, AlarmIsActive) {
+  publish(0, "STOPPED");
+  pool.machines[0]->last_info.alarm.has_alarm = 1;
+  publish(1, "ALARM");
+  publish(2, "STOPPED");
+
+  take_due(0.0);
+  scheduler_complete(&scheduler, &pool, 0.0);
+
+  std::vector<int> due = take_due(ACTIVE_MS);
+  std::sort(due.begin(), due.end());
+  EXPECT_EQ(due, std::vector<int>({0, 1}));
+}
+
+TEST_F(SchedulerTest, OpenBreakerDefersMachine) {
+  MachineHandle *machine = pool.machines[2];
+  machine->last_result = FOCAS_CONNECTION_FAILED;
+  machine->breaker.state = BREAKER_OPEN;
+  machine->breaker.last_error = EW_SOCKET;
+  machine->breaker.retry_at_ms = 3 * OFFLINE_MS;
+
+  take_due(0.0);
+  scheduler_complete(&scheduler, &pool, 0.0);
+
+  std::vector<int> due = take_due(3 * OFFLINE_MS - 1);
+  EXPECT_EQ(std::count(due.begin(), due.end(), 2), 0)
+      << "machine should not be due before its breaker admits a trial";
+  EXPECT_EQ(take_due(3 * OFFLINE_MS), std::vector<int>({2}));
+}
+
+TEST_F(SchedulerTest, BusyMachineRetriedWhenBreakerAllows) {
+  MachineHandle *machine = pool.machines[1];
+  publish(1, "STOPPED");
+  machine->breaker.state = BREAKER_OPEN;
+  machine->breaker.last_error = EW_BUSY;
+  machine->breaker.retry_at_ms = 50.0;
+
+  take_due(0.0);
+  scheduler_complete(&scheduler, &pool, 0.0);
+
+  EXPECT_EQ(take_due(50.0), std::vector<int>({1}));
+}
+
+TEST_F(SchedulerTest, SyncAddsNewMachines) {
+  take_due(0.0);
+  scheduler_complete(&scheduler, &pool, 0.0);
+
+  ASSERT_EQ(connection_pool_add_machine(&pool, "added", "127.0.0.4", 8193),
+            FOCAS_OK);
+  ASSERT_TRUE(scheduler_sync(&scheduler, &pool, 10.0));
+  EXPECT_EQ(take_due(10.0), std::vector<int>({3}));
+}
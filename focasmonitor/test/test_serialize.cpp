@@ -0,0 +1,148 @@
+#include "gtest/gtest.h"
+extern "C" {
+  #include "focasmonitor.h"
+  #include "fwlib32.h"
+}
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+class SerializeTest : public ::testing::Test {
+ protected:
+  void SetUp() override { output_buffer_init(&buffer); }
+  void TearDown() override { output_buffer_free(&buffer); }
+
+  std::string text() { return std::string(buffer.data, buffer.length); }
+
+  std::string fixed(double value, int decimals) {
+    output_buffer_reset(&buffer);
+    output_buffer_fixed(&buffer, value, decimals);
+    return text();
+  }
+
+  std::string printf_fixed(double value, int decimals) {
+    char expected[400];
+    snprintf(expected, sizeof(expected), "%.*f", decimals, value);
+    return expected;
+  }
+
+  std::string llong(long long value) {
+    output_buffer_reset(&buffer);
+    output_buffer_llong(&buffer, value);
+    return text();
+  }
+
+  OutputBuffer buffer;
+};
+
+TEST_F(SerializeTest, FixedMatchesPrintf) {
+  const double values[] = {0.0,      -0.0,     1.0,       -1.0,     0.5,
+                           1.5,      2.5,      -2.5,      0.0005,   0.0015,
+                           123.456,  -123.456, 0.1,       -0.1,     1e9,
+                           -1e9,     4294967295.5,        1e20,     -1e20,
+                           0.9995,   -0.9995,  9.9995,    99.9999,  -0.0004};
+  for (double value : values) {
+    for (int decimals = 0; decimals <= 6; decimals++) {
+      EXPECT_EQ(fixed(value, decimals), printf_fixed(value, decimals))
+          << "value " << value << " decimals " << decimals;
+    }
+  }
+}
+
+TEST_F(SerializeTest, FixedCarriesRounding) {
+  EXPECT_EQ(fixed(0.9995, 3), printf_fixed(0.9995, 3));
+  EXPECT_EQ(fixed(0.99951, 3), "1.000");
+  EXPECT_EQ(fixed(-0.99951, 3), "-1.000");
+  EXPECT_EQ(fixed(9.99999, 3), "10.000");
+  EXPECT_EQ(fixed(-99.9996, 3), "-100.000");
+}
+
+TEST_F(SerializeTest, FixedKeepsSignOfNegativeValuesThatRoundToZero) {
+  EXPECT_EQ(fixed(-0.0004, 3), printf_fixed(-0.0004, 3));
+  EXPECT_EQ(fixed(-0.0004, 3), "-0.000");
+}
+
+TEST_F(SerializeTest, FixedMatchesPrintfOverASweep) {
+  // Positions as the CNC reports them: integers scaled by 10^-decimals
+  for (long step = -200000; step <= 200000; step += 7) {
+    double value = step / 1000.0 + step * 1e-7;
+    ASSERT_EQ(fixed(value, 3), printf_fixed(value, 3)) << "value " << value;
+  }
+}
+
+TEST_F(SerializeTest, FixedHandlesNonFiniteValues) {
+  EXPECT_EQ(fixed(INFINITY, 3), printf_fixed(INFINITY, 3));
+  EXPECT_EQ(fixed(-INFINITY, 3), printf_fixed(-INFINITY, 3));
+  EXPECT_EQ(fixed(NAN, 3), printf_fixed(NAN, 3));
+}
+
+TEST_F(SerializeTest, LongMatchesPrintf) {
+  const long values[] = {0, 1, -1, 9, 10, -10, 123456789, -987654321,
+                         LONG_MAX, LONG_MIN};
+  for (long value : values) {
+    char expected[32];
+    snprintf(expected, sizeof(expected), "%ld", value);
+    output_buffer_reset(&buffer);
+    output_buffer_long(&buffer, value);
+    EXPECT_EQ(text(), expected);
+  }
+}
+
+TEST_F(SerializeTest, LLongMatchesPrintf) {
+  const long long values[] = {0, -1, 1000000000000LL, -1000000000000LL,
+                              LLONG_MAX, LLONG_MIN};
+  for (long long value : values) {
+    char expected[32];
+    snprintf(expected, sizeof(expected), "%lld", value);
+    EXPECT_EQ(llong(value), expected);
+  }
+}
+
+TEST_F(SerializeTest, JsonStringEscapes) {
+  output_buffer_json_string(&buffer, "plain");
+  EXPECT_EQ(text(), "\"plain\"");
+
+  output_buffer_reset(&buffer);
+  output_buffer_json_string(&buffer, "a\"b\\c");
+  EXPECT_EQ(text(), "\"a\\\"b\\\\c\"");
+
+  output_buffer_reset(&buffer);
+  output_buffer_json_string(&buffer, "tab\there\nnew\x01\x1f");
+  EXPECT_EQ(text(), "\"tab\\u0009here\\u000anew\\u0001\\u001f\"");
+
+  output_buffer_reset(&buffer);
+  output_buffer_json_string(&buffer, "");
+  EXPECT_EQ(text(), "\"\"");
+
+  // Bytes above 0x7f pass through so UTF-8 survives
+  output_buffer_reset(&buffer);
+  output_buffer_json_string(&buffer, "\xc3\xa9");
+  EXPECT_EQ(text(), "\"\xc3\xa9\"");
+}
+
+TEST_F(SerializeTest, FailedAllocationDropsAppends) {
+  output_buffer_puts(&buffer, "kept");
+  ASSERT_FALSE(buffer.failed);
+
+  // No allocator can satisfy this, so the buffer is marked failed
+  output_buffer_append(&buffer, "x", SIZE_MAX / 2 + 1);
+  EXPECT_TRUE(buffer.failed);
+  EXPECT_EQ(text(), "kept");
+
+  output_buffer_puts(&buffer, "dropped");
+  output_buffer_long(&buffer, 42);
+  output_buffer_fixed(&buffer, 1.5, 3);
+  output_buffer_json_string(&buffer, "dropped");
+  EXPECT_EQ(text(), "kept") << "appends after a failure should be dropped";
+  EXPECT_FALSE(output_buffer_write(&buffer, -1))
+      << "a failed buffer should never be written";
+
+  output_buffer_reset(&buffer);
+  EXPECT_FALSE(buffer.failed);
+  output_buffer_puts(&buffer, "again");
+  EXPECT_EQ(text(), "again");
+}